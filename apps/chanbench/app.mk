@@ -0,0 +1,26 @@
+LOCAL_DIR := $(GET_LOCAL_DIR)
+#$(warning LOCAL_DIR $(LOCAL_DIR))
+
+# two processes talking over a pair of channels in shared memory: chanbench
+# spawns chanbench-rx, streams messages at it for throughput and bounces
+# messages off it for round trip latency
+APP_NAME := chanbench
+APP_BUILDDIR := $(call TOBUILDDIR, $(LOCAL_DIR))
+APP := $(APP_BUILDDIR)/$(APP_NAME)
+
+APP_LIBS := $(call TOBUILDDIR, lib/lku/lku.a)
+
+APP_CFLAGS :=
+APP_SRCS := $(LOCAL_DIR)/chanbench.c
+
+include make/app.mk
+
+APP_NAME := chanbench-rx
+APP := $(APP_BUILDDIR)/$(APP_NAME)
+
+APP_LIBS := $(call TOBUILDDIR, lib/lku/lku.a)
+
+APP_CFLAGS :=
+APP_SRCS := $(LOCAL_DIR)/chanbench_rx.c
+
+include make/app.mk
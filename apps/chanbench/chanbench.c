@@ -0,0 +1,186 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <lku/channel.h>
+#include <lku/mman.h>
+#include <lku/spawn.h>
+#include <lku/thread.h>
+#include <lku/timer.h>
+
+#include "chanbench.h"
+
+#define DEFAULT_MESSAGES    100000
+#define DEFAULT_SIZE        64
+#define ROUND_TRIPS         10000
+
+static unsigned int messages = DEFAULT_MESSAGES;
+static unsigned int msg_size = DEFAULT_SIZE;
+static uint64_t latency[ROUND_TRIPS];
+
+static int compare(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t percentile(unsigned int per_mille)
+{
+    unsigned int i = (unsigned int)((uint64_t)ROUND_TRIPS * per_mille / 1000);
+    if (i >= ROUND_TRIPS) {
+        i = ROUND_TRIPS - 1;
+    }
+    return latency[i];
+}
+
+/* write a message in place in the ring */
+static int post(struct lku_channel *to, uint32_t kind, uint32_t seq, size_t len)
+{
+    struct chanbench_msg *msg = lku_channel_reserve(to, len, LKU_FUTEX_INFINITE);
+    if (!msg) {
+        perror("lku_channel_reserve");
+        return -1;
+    }
+
+    msg->kind = kind;
+    msg->seq = seq;
+    memset(msg + 1, (int)seq, len - sizeof(*msg));
+    lku_channel_commit(to);
+    return 0;
+}
+
+/* post an echo and wait for it to come back */
+static int round_trip(struct lku_channel *to, struct lku_channel *back, uint32_t seq)
+{
+    if (post(to, CHANBENCH_ECHO, seq, sizeof(struct chanbench_msg)) < 0) {
+        return -1;
+    }
+
+    size_t len;
+    const struct chanbench_msg *reply = lku_channel_receive(back, &len, LKU_FUTEX_INFINITE);
+    if (!reply) {
+        perror("lku_channel_receive");
+        return -1;
+    }
+    int ok = (reply->seq == seq);
+    lku_channel_release(back);
+
+    if (!ok) {
+        printf("chanbench: echo %u came back out of order\n", seq);
+        return -1;
+    }
+    return 0;
+}
+
+/* one way stream, timed until an echo behind it shows it has all been read */
+static int run_throughput(struct lku_channel *to, struct lku_channel *back)
+{
+    uint64_t start = lku_now_ns();
+    for (unsigned int i = 0; i < messages; i++) {
+        if (post(to, CHANBENCH_STREAM, i, msg_size) < 0) {
+            return -1;
+        }
+    }
+    if (round_trip(to, back, messages) < 0) {
+        return -1;
+    }
+    uint64_t ns = lku_now_ns() - start;
+
+    uint64_t bytes = (uint64_t)messages * msg_size;
+    printf("chanbench: %u messages of %u bytes in %llu usec: %llu msgs/sec, %llu MB/sec\n",
+           messages, msg_size, (unsigned long long)(ns / 1000),
+           (unsigned long long)(messages * 1000000000ULL / ns),
+           (unsigned long long)(bytes * 1000ULL / ns));
+    return 0;
+}
+
+static int run_latency(struct lku_channel *to, struct lku_channel *back)
+{
+    for (unsigned int i = 0; i < ROUND_TRIPS; i++) {
+        uint64_t before = lku_now_ns();
+        if (round_trip(to, back, i) < 0) {
+            return -1;
+        }
+        latency[i] = lku_now_ns() - before;
+    }
+
+    qsort(latency, ROUND_TRIPS, sizeof(latency[0]), compare);
+    printf("chanbench: round trip nsec: p50 %llu, p90 %llu, p99 %llu, p99.9 %llu, max %llu\n",
+           (unsigned long long)percentile(500),
+           (unsigned long long)percentile(900),
+           (unsigned long long)percentile(990),
+           (unsigned long long)percentile(999),
+           (unsigned long long)latency[ROUND_TRIPS - 1]);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        printf("usage: %s <path to chanbench-rx> [messages] [size]\n", argv[0]);
+        return 1;
+    }
+    if (argc > 2) {
+        messages = strtoul(argv[2], NULL, 0);
+    }
+    if (argc > 3) {
+        msg_size = strtoul(argv[3], NULL, 0);
+    }
+
+    /* a run that died earlier may have left the object behind */
+    lku_shm_unlink(CHANBENCH_SHM);
+    int fd = lku_shm_open(CHANBENCH_SHM, CHANBENCH_SHM_SIZE, O_RDWR | O_CREAT | O_EXCL);
+    if (fd < 0) {
+        perror("lku_shm_open");
+        return 1;
+    }
+
+    uint8_t *mem = mmap(NULL, CHANBENCH_SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        perror("mmap");
+        lku_shm_unlink(CHANBENCH_SHM);
+        return 1;
+    }
+
+    struct lku_channel to, back;
+    lku_channel_init(&to, mem, CHANBENCH_RING_SIZE);
+    lku_channel_init(&back, mem + lku_channel_footprint(CHANBENCH_RING_SIZE), CHANBENCH_RING_SIZE);
+
+    if (msg_size < sizeof(struct chanbench_msg) || msg_size > lku_channel_max_message(&to) ||
+            messages == 0) {
+        printf("chanbench: size must be between %zu and %zu bytes\n",
+               sizeof(struct chanbench_msg), lku_channel_max_message(&to));
+        lku_shm_unlink(CHANBENCH_SHM);
+        return 1;
+    }
+
+    const char *rx_argv[] = { argv[1], NULL };
+    pid_t pid = lku_spawn(argv[1], rx_argv);
+    if (pid < 0) {
+        perror("lku_spawn");
+        lku_shm_unlink(CHANBENCH_SHM);
+        return 1;
+    }
+
+    printf("chanbench: %u byte rings, sending to pid %d\n", CHANBENCH_RING_SIZE, pid);
+
+    int ret = 0;
+    if (run_throughput(&to, &back) < 0 || run_latency(&to, &back) < 0) {
+        ret = 1;
+    }
+
+    post(&to, CHANBENCH_QUIT, 0, sizeof(struct chanbench_msg));
+
+    int status;
+    waitpid(pid, &status, 0);
+
+    munmap(mem, CHANBENCH_SHM_SIZE);
+    lku_shm_unlink(CHANBENCH_SHM);
+    return ret;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+#include <lku/channel.h>
+
+/* shared between chanbench and chanbench-rx */
+
+#define CHANBENCH_SHM       "chanbench"
+#define CHANBENCH_RING_SIZE (64 * 1024)
+
+/* the object holds the channel to rx followed by the one back */
+#define CHANBENCH_SHM_SIZE  (2 * lku_channel_footprint(CHANBENCH_RING_SIZE))
+
+enum {
+    CHANBENCH_STREAM,   /* consume and drop */
+    CHANBENCH_ECHO,     /* send straight back */
+    CHANBENCH_QUIT,
+};
+
+/* at the start of every message */
+struct chanbench_msg {
+    uint32_t kind;
+    uint32_t seq;
+};
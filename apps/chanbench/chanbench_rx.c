@@ -0,0 +1,64 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <lku/channel.h>
+#include <lku/mman.h>
+#include <lku/thread.h>
+
+#include "chanbench.h"
+
+/* the far end of chanbench: copy every message out, as a consumer that keeps
+ * the data would, and echo the ones that ask for it */
+int main(int argc, char **argv)
+{
+    int fd = lku_shm_open(CHANBENCH_SHM, 0, O_RDWR);
+    if (fd < 0) {
+        perror("lku_shm_open");
+        return 1;
+    }
+
+    uint8_t *mem = mmap(NULL, CHANBENCH_SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    struct lku_channel in, out;
+    if (lku_channel_attach(&in, mem) < 0 ||
+            lku_channel_attach(&out, mem + lku_channel_footprint(CHANBENCH_RING_SIZE)) < 0) {
+        printf("chanbench-rx: channels are not set up\n");
+        return 1;
+    }
+
+    size_t max = lku_channel_max_message(&in);
+    uint8_t *buf = malloc(max);
+    if (!buf) {
+        printf("out of memory\n");
+        return 1;
+    }
+
+    for (;;) {
+        ssize_t len = lku_channel_recv(&in, buf, max, LKU_FUTEX_INFINITE);
+        if (len < (ssize_t)sizeof(struct chanbench_msg)) {
+            printf("chanbench-rx: bad message, len %zd errno %d\n", len, errno);
+            return 1;
+        }
+
+        const struct chanbench_msg *msg = (const struct chanbench_msg *)buf;
+        if (msg->kind == CHANBENCH_QUIT) {
+            break;
+        }
+        if (msg->kind == CHANBENCH_ECHO &&
+                lku_channel_send(&out, buf, len, LKU_FUTEX_INFINITE) < 0) {
+            perror("lku_channel_send");
+            return 1;
+        }
+    }
+
+    free(buf);
+    munmap(mem, CHANBENCH_SHM_SIZE);
+    return 0;
+}
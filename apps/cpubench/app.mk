@@ -0,0 +1,15 @@
+LOCAL_DIR := $(GET_LOCAL_DIR)
+#$(warning LOCAL_DIR $(LOCAL_DIR))
+
+# fixed amount of cpu bound work, run several copies at once with
+# "lkuser bench cpu" to see how processes scale across cpus
+APP_NAME := cpubench
+APP_BUILDDIR := $(call TOBUILDDIR, $(LOCAL_DIR))
+APP := $(APP_BUILDDIR)/$(APP_NAME)
+
+APP_LIBS := $(call TOBUILDDIR, lib/lku/lku.a)
+
+APP_CFLAGS :=
+APP_SRCS := $(LOCAL_DIR)/cpubench.c
+
+include make/app.mk
@@ -0,0 +1,44 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <lku/timer.h>
+
+/* small enough to stay in the cache, so copies running on different cpus
+ * only compete for cycles and not for memory bandwidth */
+#define TABLE_SIZE  1024
+#define ROUNDS      20000
+
+static uint32_t table[TABLE_SIZE];
+
+static inline uint32_t xorshift(uint32_t x)
+{
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+int main(void)
+{
+    uint32_t x = 2463534242u;
+    for (int i = 0; i < TABLE_SIZE; i++) {
+        x = xorshift(x);
+        table[i] = x;
+    }
+
+    uint64_t start = lku_now_ns();
+    uint32_t sum = 0;
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < TABLE_SIZE; i++) {
+            uint32_t v = xorshift(table[i] + sum);
+            table[i] = v;
+            sum += v >> 3;
+        }
+    }
+    uint64_t ns = lku_now_ns() - start;
+
+    printf("cpubench: %u rounds in %llu usec, checksum %#x\n",
+           ROUNDS, (unsigned long long)(ns / 1000), sum);
+
+    return 0;
+}
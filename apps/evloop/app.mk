@@ -0,0 +1,15 @@
+LOCAL_DIR := $(GET_LOCAL_DIR)
+#$(warning LOCAL_DIR $(LOCAL_DIR))
+
+# a single threaded event loop over a pipe, a timer, the console and a child
+# process, sleeping in epoll_wait between events
+APP_NAME := evloop
+APP_BUILDDIR := $(call TOBUILDDIR, $(LOCAL_DIR))
+APP := $(APP_BUILDDIR)/$(APP_NAME)
+
+APP_LIBS := $(call TOBUILDDIR, lib/lku/lku.a)
+
+APP_CFLAGS :=
+APP_SRCS := $(LOCAL_DIR)/evloop.c
+
+include make/app.mk
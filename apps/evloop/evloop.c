@@ -0,0 +1,145 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <lku/poll.h>
+#include <lku/timer.h>
+
+#define MESSAGES        5
+#define MESSAGE_USEC    100000
+#define TICK_NSEC       250000000ULL
+
+enum {
+    SRC_PIPE,
+    SRC_TIMER,
+    SRC_CHILD,
+    SRC_CONSOLE,
+};
+
+static int add(int epfd, int fd, uint32_t events, int src)
+{
+    struct epoll_event ev = { .events = events, .data.u32 = src };
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        perror("epoll_ctl");
+        return -1;
+    }
+    return 0;
+}
+
+/* writes a few messages into the pipe at a leisurely pace, then exits */
+static void producer(int wfd)
+{
+    for (int i = 0; i < MESSAGES; i++) {
+        usleep(MESSAGE_USEC);
+
+        char msg[32];
+        int len = snprintf(msg, sizeof(msg), "message %d", i);
+        write(wfd, msg, len);
+    }
+    _exit(7);
+}
+
+int main(void)
+{
+    int fds[2];
+    if (pipe(fds) < 0) {
+        perror("pipe");
+        return 1;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        producer(fds[1]);
+    }
+    close(fds[1]);
+
+    int pidfd = lku_pid_open(pid);
+    int timer = lku_timer_create(CLOCK_MONOTONIC, LKU_TIMER_NONBLOCK);
+    int epfd = epoll_create1(0);
+    if (pidfd < 0 || timer < 0 || epfd < 0) {
+        perror("evloop setup");
+        return 1;
+    }
+    lku_timer_set(timer, 0, TICK_NSEC, TICK_NSEC);
+
+    if (add(epfd, fds[0], EPOLLIN, SRC_PIPE) < 0 || add(epfd, timer, EPOLLIN, SRC_TIMER) < 0 ||
+        add(epfd, pidfd, EPOLLIN, SRC_CHILD) < 0 || add(epfd, STDIN_FILENO, EPOLLIN, SRC_CONSOLE) < 0) {
+        return 1;
+    }
+
+    printf("evloop: waiting on a pipe, a timer, child %d and the console\n", (int)pid);
+
+    int wakeups = 0;
+    int ticks = 0;
+    int pipe_open = 1;
+    int child_running = 1;
+    while (pipe_open || child_running) {
+        struct epoll_event events[4];
+        int n = epoll_wait(epfd, events, 4, -1);
+        if (n < 0) {
+            perror("epoll_wait");
+            return 1;
+        }
+        wakeups++;
+
+        for (int i = 0; i < n; i++) {
+            switch (events[i].data.u32) {
+                case SRC_PIPE: {
+                    char buf[64];
+                    ssize_t len = read(fds[0], buf, sizeof(buf) - 1);
+                    if (len > 0) {
+                        buf[len] = 0;
+                        printf("evloop: pipe: %s\n", buf);
+                    } else {
+                        printf("evloop: pipe closed\n");
+                        epoll_ctl(epfd, EPOLL_CTL_DEL, fds[0], NULL);
+                        pipe_open = 0;
+                    }
+                    break;
+                }
+                case SRC_TIMER: {
+                    uint64_t count;
+                    if (lku_timer_wait(timer, &count) == 0) {
+                        ticks += count;
+                    }
+                    break;
+                }
+                case SRC_CHILD: {
+                    int code;
+                    read(pidfd, &code, sizeof(code));
+                    printf("evloop: child exited with %d\n", code);
+                    epoll_ctl(epfd, EPOLL_CTL_DEL, pidfd, NULL);
+                    child_running = 0;
+                    break;
+                }
+                case SRC_CONSOLE: {
+                    char buf[64];
+                    ssize_t len = read(STDIN_FILENO, buf, sizeof(buf) - 1);
+                    if (len > 0) {
+                        buf[len] = 0;
+                        printf("evloop: console: %s", buf);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    int status;
+    waitpid(pid, &status, 0);
+
+    printf("evloop: %d wakeups, %d timer ticks\n", wakeups, ticks);
+
+    close(epfd);
+    close(timer);
+    close(pidfd);
+    close(fds[0]);
+    return 0;
+}
@@ -0,0 +1,14 @@
+LOCAL_DIR := $(GET_LOCAL_DIR)
+#$(warning LOCAL_DIR $(LOCAL_DIR))
+
+# wakeup latency of periodic sleeps and timers, as percentiles
+APP_NAME := jitter
+APP_BUILDDIR := $(call TOBUILDDIR, $(LOCAL_DIR))
+APP := $(APP_BUILDDIR)/$(APP_NAME)
+
+APP_LIBS := $(call TOBUILDDIR, lib/lku/lku.a)
+
+APP_CFLAGS :=
+APP_SRCS := $(LOCAL_DIR)/jitter.c
+
+include make/app.mk
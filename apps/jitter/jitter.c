@@ -0,0 +1,153 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <lku/timer.h>
+
+#define DEFAULT_PERIOD_USEC 500
+#define DEFAULT_SAMPLES     2000
+
+static unsigned int period_usec = DEFAULT_PERIOD_USEC;
+static unsigned int samples = DEFAULT_SAMPLES;
+static uint64_t *latency;
+
+static int compare(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t percentile(unsigned int per_mille)
+{
+    unsigned int i = (unsigned int)((uint64_t)samples * per_mille / 1000);
+    if (i >= samples) {
+        i = samples - 1;
+    }
+    return latency[i];
+}
+
+/* how late each wakeup was, plus how far the whole run drifted from where
+ * the deadlines said it should have ended */
+static void report(const char *what, uint64_t start, uint64_t end)
+{
+    qsort(latency, samples, sizeof(latency[0]), compare);
+
+    uint64_t expected = start + (uint64_t)samples * period_usec * 1000;
+    int64_t drift = (int64_t)(end - expected);
+
+    printf("%-10s late by usec: p50 %llu, p90 %llu, p99 %llu, p99.9 %llu, max %llu; drift %lld usec\n",
+           what,
+           (unsigned long long)(percentile(500) / 1000),
+           (unsigned long long)(percentile(900) / 1000),
+           (unsigned long long)(percentile(990) / 1000),
+           (unsigned long long)(percentile(999) / 1000),
+           (unsigned long long)(latency[samples - 1] / 1000),
+           (long long)(drift / 1000));
+}
+
+/* sleeping for the period each time, the way a naive loop does */
+static void run_usleep(void)
+{
+    uint64_t start = lku_now_ns();
+    for (unsigned int i = 0; i < samples; i++) {
+        uint64_t before = lku_now_ns();
+        usleep(period_usec);
+        uint64_t after = lku_now_ns();
+
+        uint64_t want = before + (uint64_t)period_usec * 1000;
+        latency[i] = (after > want) ? after - want : 0;
+    }
+    report("usleep", start, lku_now_ns());
+}
+
+/* sleeping until absolute deadlines, which does not accumulate drift */
+static void run_abstime(void)
+{
+    uint64_t start = lku_now_ns();
+    uint64_t deadline = start;
+    for (unsigned int i = 0; i < samples; i++) {
+        deadline += (uint64_t)period_usec * 1000;
+
+        struct timespec ts = {
+            .tv_sec = deadline / 1000000000ULL,
+            .tv_nsec = deadline % 1000000000ULL,
+        };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+
+        uint64_t now = lku_now_ns();
+        latency[i] = (now > deadline) ? now - deadline : 0;
+    }
+    report("abstime", start, lku_now_ns());
+}
+
+/* blocking on a periodic timer */
+static int run_timer(void)
+{
+    int fd = lku_timer_create(CLOCK_MONOTONIC, 0);
+    if (fd < 0) {
+        perror("lku_timer_create");
+        return -1;
+    }
+
+    uint64_t period_ns = (uint64_t)period_usec * 1000;
+    uint64_t start = lku_now_ns();
+    if (lku_timer_set(fd, TIMER_ABSTIME, start + period_ns, period_ns) < 0) {
+        perror("lku_timer_set");
+        close(fd);
+        return -1;
+    }
+
+    uint64_t deadline = start;
+    for (unsigned int i = 0; i < samples; ) {
+        uint64_t count;
+        if (lku_timer_wait(fd, &count) < 0) {
+            perror("lku_timer_wait");
+            close(fd);
+            return -1;
+        }
+        uint64_t now = lku_now_ns();
+
+        /* missed periods count as samples, each as late as it turned out */
+        for (uint64_t c = 0; c < count && i < samples; c++, i++) {
+            deadline += period_ns;
+            latency[i] = (now > deadline) ? now - deadline : 0;
+        }
+    }
+    report("timer", start, lku_now_ns());
+
+    close(fd);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1) {
+        period_usec = strtoul(argv[1], NULL, 0);
+    }
+    if (argc > 2) {
+        samples = strtoul(argv[2], NULL, 0);
+    }
+    if (period_usec == 0 || samples == 0) {
+        printf("usage: %s [period usec] [samples]\n", argv[0]);
+        return 1;
+    }
+
+    latency = malloc(samples * sizeof(latency[0]));
+    if (!latency) {
+        printf("out of memory\n");
+        return 1;
+    }
+
+    printf("jitter: %u samples at a %u usec period\n", samples, period_usec);
+
+    run_usleep();
+    run_abstime();
+    if (run_timer() < 0) {
+        return 1;
+    }
+
+    free(latency);
+    return 0;
+}
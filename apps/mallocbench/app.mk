@@ -0,0 +1,25 @@
+LOCAL_DIR := $(GET_LOCAL_DIR)
+#$(warning LOCAL_DIR $(LOCAL_DIR))
+
+# the same benchmark built against newlib's malloc and against lkumalloc
+APP_NAME := mallocbench
+APP_BUILDDIR := $(call TOBUILDDIR, $(LOCAL_DIR))
+APP := $(APP_BUILDDIR)/$(APP_NAME)
+
+APP_LIBS := $(call TOBUILDDIR, lib/lku/lku.a)
+
+APP_CFLAGS :=
+APP_SRCS := $(LOCAL_DIR)/mallocbench.c
+
+include make/app.mk
+
+APP_NAME := mallocbench-lk
+APP := $(APP_BUILDDIR)/$(APP_NAME)
+
+APP_LIBS := $(call TOBUILDDIR, lib/lku/lkumalloc.a)
+APP_LIBS += $(call TOBUILDDIR, lib/lku/lku.a)
+
+APP_CFLAGS :=
+APP_SRCS := $(LOCAL_DIR)/mallocbench_lk.c
+
+include make/app.mk
@@ -0,0 +1,103 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <lku/timer.h>
+
+#ifndef BENCH_ALLOCATOR
+#define BENCH_ALLOCATOR "newlib"
+#endif
+
+#define SLOTS 1024
+
+static void *slots[SLOTS];
+
+static uint32_t rand_state = 1;
+
+static inline uint32_t next_rand(void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return rand_state >> 8;
+}
+
+static void report(const char *name, unsigned long ops, uint64_t ns)
+{
+    unsigned long per_sec = ns ? (unsigned long)((uint64_t)ops * 1000000000ULL / ns) : 0;
+    printf("%-24s %8lu ops %10llu ns %6llu ns/op %10lu ops/sec\n",
+           name, ops, (unsigned long long)ns, (unsigned long long)(ns / ops), per_sec);
+}
+
+/* allocate and immediately free the same size over and over */
+static void bench_pairs(size_t size, unsigned long iterations)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "pairs %zu", size);
+
+    uint64_t start = lku_now_ns();
+    for (unsigned long i = 0; i < iterations; i++) {
+        void *p = malloc(size);
+        *(volatile char *)p = 0;
+        free(p);
+    }
+    report(name, iterations * 2, lku_now_ns() - start);
+}
+
+/* fill a batch of slots, then free them all, like building and dropping a
+ * data structure */
+static void bench_batch(size_t size, unsigned long rounds)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "batch %zu", size);
+
+    uint64_t start = lku_now_ns();
+    for (unsigned long r = 0; r < rounds; r++) {
+        for (int i = 0; i < SLOTS; i++) {
+            slots[i] = malloc(size);
+        }
+        for (int i = 0; i < SLOTS; i++) {
+            free(slots[i]);
+        }
+    }
+    report(name, rounds * SLOTS * 2, lku_now_ns() - start);
+}
+
+/* replace random slots with random sizes, a long running mixed workload */
+static void bench_random(size_t max_size, unsigned long iterations)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "random <= %zu", max_size);
+
+    memset(slots, 0, sizeof(slots));
+
+    uint64_t start = lku_now_ns();
+    for (unsigned long i = 0; i < iterations; i++) {
+        uint32_t r = next_rand();
+        int slot = r % SLOTS;
+        free(slots[slot]);
+        slots[slot] = malloc(1 + (r >> 10) % max_size);
+    }
+    for (int i = 0; i < SLOTS; i++) {
+        free(slots[i]);
+        slots[i] = NULL;
+    }
+    report(name, iterations * 2, lku_now_ns() - start);
+}
+
+int main(void)
+{
+    printf("malloc benchmark, %s allocator\n", BENCH_ALLOCATOR);
+
+    static const size_t sizes[] = { 16, 64, 256, 1024, 4096 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        bench_pairs(sizes[i], 100000);
+    }
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        bench_batch(sizes[i], 50);
+    }
+    bench_random(128, 200000);
+    bench_random(2048, 200000);
+    bench_random(65536, 20000);
+
+    return 0;
+}
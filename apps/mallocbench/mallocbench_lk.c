@@ -0,0 +1,3 @@
+/* built the same as mallocbench.c but linked against lkumalloc.a */
+#define BENCH_ALLOCATOR "lkumalloc"
+#include "mallocbench.c"
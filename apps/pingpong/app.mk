@@ -0,0 +1,16 @@
+LOCAL_DIR := $(GET_LOCAL_DIR)
+#$(warning LOCAL_DIR $(LOCAL_DIR))
+
+# two processes, then two threads of one process, pinned to the same cpu and
+# handing it back and forth, to time a context switch with and without an
+# address space change
+APP_NAME := pingpong
+APP_BUILDDIR := $(call TOBUILDDIR, $(LOCAL_DIR))
+APP := $(APP_BUILDDIR)/$(APP_NAME)
+
+APP_LIBS := $(call TOBUILDDIR, lib/lku/lku.a)
+
+APP_CFLAGS :=
+APP_SRCS := $(LOCAL_DIR)/pingpong.c
+
+include make/app.mk
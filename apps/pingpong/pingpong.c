@@ -0,0 +1,96 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <lku/thread.h>
+#include <lku/timer.h>
+
+#define DEFAULT_ROUNDS  100000
+
+static unsigned int rounds = DEFAULT_ROUNDS;
+
+/* with only the two of us runnable on the cpu, every yield switches to the
+ * other side */
+static int bounce(void *arg)
+{
+    for (unsigned int i = 0; i < rounds; i++) {
+        lku_yield();
+    }
+    return 0;
+}
+
+static void report(const char *what, uint64_t ns)
+{
+    /* both sides yield once per round */
+    uint64_t switches = 2ULL * rounds;
+    printf("pingpong: %-10s %llu switches in %llu usec, %llu ns per switch\n",
+           what, (unsigned long long)switches, (unsigned long long)(ns / 1000),
+           (unsigned long long)(ns / switches));
+}
+
+static int run_procs(void)
+{
+    uint64_t start = lku_now_ns();
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0) {
+        bounce(NULL);
+        _exit(0);
+    }
+
+    bounce(NULL);
+
+    int status;
+    if (waitpid(pid, &status, 0) < 0) {
+        perror("waitpid");
+        return -1;
+    }
+
+    report("processes", lku_now_ns() - start);
+    return 0;
+}
+
+static int run_threads(void)
+{
+    uint64_t start = lku_now_ns();
+
+    lku_thread_t *t;
+    if (lku_thread_create(&t, bounce, NULL, 0) < 0) {
+        perror("lku_thread_create");
+        return -1;
+    }
+
+    bounce(NULL);
+    lku_thread_join(t, NULL);
+
+    report("threads", lku_now_ns() - start);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1) {
+        rounds = strtoul(argv[1], NULL, 0);
+        if (rounds == 0) {
+            rounds = DEFAULT_ROUNDS;
+        }
+    }
+
+    /* everything we start inherits the single cpu */
+    if (lku_set_affinity(LKU_AFFINITY_PROCESS, 1) < 0) {
+        perror("lku_set_affinity");
+        return 1;
+    }
+
+    if (run_procs() < 0 || run_threads() < 0) {
+        return 1;
+    }
+
+    return 0;
+}
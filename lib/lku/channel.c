@@ -0,0 +1,247 @@
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include <lku/channel.h>
+#include <lku/thread.h>
+#include <lku/timer.h>
+
+#define LKU_CHANNEL_MAGIC   0x6c6b6368 /* 'lkch' */
+
+/* times to look at the peer's index before going to sleep on it */
+#define LKU_CHANNEL_SPIN    256
+
+/* every message is a record header and the payload, padded so the next
+ * header stays 8 byte aligned. a pad record fills out the end of the ring
+ * when the next message does not fit before it.
+ */
+#define LKU_CHANNEL_PAD     0xffffffffu
+
+struct record {
+    uint32_t len;
+    uint32_t reserved;
+};
+
+static uint32_t record_size(size_t len)
+{
+    return (sizeof(struct record) + len + 7) & ~7u;
+}
+
+/* wait for the peer to move *word on from seen, spinning for a bit before
+ * sleeping on it with *waiting raised so the peer knows to wake us. the
+ * deadline is worked out on the first sleep and kept in *deadline.
+ */
+static int wait_for(uint32_t *word, uint32_t seen, int *waiting,
+                    unsigned int timeout_msec, uint64_t *deadline)
+{
+    if (timeout_msec == 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    for (int i = 0; i < LKU_CHANNEL_SPIN; i++) {
+        if (__atomic_load_n(word, __ATOMIC_ACQUIRE) != seen) {
+            return 0;
+        }
+    }
+
+    unsigned int left = LKU_FUTEX_INFINITE;
+    if (timeout_msec != LKU_FUTEX_INFINITE) {
+        uint64_t now = lku_now_ns() / 1000000;
+        if (*deadline == 0) {
+            *deadline = now + timeout_msec;
+        }
+        if (now >= *deadline) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        left = *deadline - now;
+    }
+
+    /* raising the flag before the final look pairs with publish() storing
+     * the index before checking the flag, so one side always sees the other
+     */
+    __atomic_store_n(waiting, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    int err = 0;
+    if (__atomic_load_n(word, __ATOMIC_RELAXED) == seen) {
+        err = lku_futex_wait((int *)word, (int)seen, left);
+        if (err < 0 && errno == EAGAIN) {
+            /* moved on before we got to sleep */
+            err = 0;
+        }
+    }
+
+    __atomic_store_n(waiting, 0, __ATOMIC_RELAXED);
+
+    /* a timed out sleep goes round again to notice the deadline */
+    if (err < 0 && errno == ETIMEDOUT) {
+        err = 0;
+    }
+    return err;
+}
+
+/* hand our new index to the peer, waking it only if it went to sleep */
+static void publish(uint32_t *word, uint32_t value, int *waiting)
+{
+    __atomic_store_n(word, value, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(waiting, __ATOMIC_RELAXED)) {
+        lku_futex_wake((int *)word, 1);
+    }
+}
+
+int lku_channel_init(struct lku_channel *c, void *mem, size_t ring_size)
+{
+    if (((uintptr_t)mem & 63) || ring_size < 64 || ring_size > (1u << 30) ||
+            (ring_size & (ring_size - 1))) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct lku_channel_shared *shared = mem;
+    memset(shared, 0, sizeof(*shared));
+    shared->size = ring_size;
+
+    /* the magic goes in last so an attach never sees a half set up header */
+    __atomic_store_n(&shared->magic, LKU_CHANNEL_MAGIC, __ATOMIC_RELEASE);
+
+    return lku_channel_attach(c, mem);
+}
+
+int lku_channel_attach(struct lku_channel *c, void *mem)
+{
+    struct lku_channel_shared *shared = mem;
+
+    if (__atomic_load_n(&shared->magic, __ATOMIC_ACQUIRE) != LKU_CHANNEL_MAGIC) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    c->shared = shared;
+    c->ring = (uint8_t *)(shared + 1);
+    c->size = shared->size;
+    c->head = __atomic_load_n(&shared->head, __ATOMIC_ACQUIRE);
+    c->tail = __atomic_load_n(&shared->tail, __ATOMIC_ACQUIRE);
+    c->pending = 0;
+    return 0;
+}
+
+size_t lku_channel_max_message(const struct lku_channel *c)
+{
+    /* up to half the ring, so a message plus the pad in front of it fits */
+    return c->size / 2 - sizeof(struct record);
+}
+
+void *lku_channel_reserve(struct lku_channel *c, size_t len, unsigned int timeout_msec)
+{
+    if (len > lku_channel_max_message(c)) {
+        errno = EMSGSIZE;
+        return NULL;
+    }
+
+    const uint32_t need = record_size(len);
+    uint32_t pos = c->head & (c->size - 1);
+    const uint32_t contig = c->size - pos;
+    const uint32_t total = (contig < need) ? contig + need : need;
+
+    uint64_t deadline = 0;
+    while (c->size - (c->head - c->tail) < total) {
+        /* only go back to the shared index once the cached one runs out */
+        c->tail = __atomic_load_n(&c->shared->tail, __ATOMIC_ACQUIRE);
+        if (c->size - (c->head - c->tail) >= total) {
+            break;
+        }
+        if (wait_for(&c->shared->tail, c->tail, &c->shared->producer_waiting,
+                     timeout_msec, &deadline) < 0) {
+            return NULL;
+        }
+    }
+
+    if (contig < need) {
+        struct record *pad = (struct record *)(c->ring + pos);
+        pad->len = LKU_CHANNEL_PAD;
+        c->head += contig;
+        pos = 0;
+    }
+
+    struct record *r = (struct record *)(c->ring + pos);
+    r->len = len;
+    c->pending = need;
+    return r + 1;
+}
+
+void lku_channel_commit(struct lku_channel *c)
+{
+    c->head += c->pending;
+    c->pending = 0;
+    publish(&c->shared->head, c->head, &c->shared->consumer_waiting);
+}
+
+const void *lku_channel_receive(struct lku_channel *c, size_t *len, unsigned int timeout_msec)
+{
+    uint64_t deadline = 0;
+
+    for (;;) {
+        if (c->head == c->tail) {
+            c->head = __atomic_load_n(&c->shared->head, __ATOMIC_ACQUIRE);
+            if (c->head == c->tail) {
+                if (wait_for(&c->shared->head, c->tail, &c->shared->consumer_waiting,
+                             timeout_msec, &deadline) < 0) {
+                    return NULL;
+                }
+                continue;
+            }
+        }
+
+        uint32_t pos = c->tail & (c->size - 1);
+        const struct record *r = (const struct record *)(c->ring + pos);
+        if (r->len == LKU_CHANNEL_PAD) {
+            c->tail += c->size - pos;
+            continue;
+        }
+
+        c->pending = record_size(r->len);
+        *len = r->len;
+        return r + 1;
+    }
+}
+
+void lku_channel_release(struct lku_channel *c)
+{
+    c->tail += c->pending;
+    c->pending = 0;
+    publish(&c->shared->tail, c->tail, &c->shared->producer_waiting);
+}
+
+int lku_channel_send(struct lku_channel *c, const void *buf, size_t len, unsigned int timeout_msec)
+{
+    void *msg = lku_channel_reserve(c, len, timeout_msec);
+    if (!msg) {
+        return -1;
+    }
+
+    memcpy(msg, buf, len);
+    lku_channel_commit(c);
+    return 0;
+}
+
+ssize_t lku_channel_recv(struct lku_channel *c, void *buf, size_t len, unsigned int timeout_msec)
+{
+    size_t msg_len;
+    const void *msg = lku_channel_receive(c, &msg_len, timeout_msec);
+    if (!msg) {
+        return -1;
+    }
+
+    if (msg_len > len) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    memcpy(buf, msg, msg_len);
+    lku_channel_release(c);
+    return msg_len;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/* a single producer, single consumer channel of variable sized messages in
+ * memory shared by two processes, usually an object from lku_shm_open()
+ * mapped MAP_SHARED by both.
+ *
+ * the producer and consumer each own one index into the ring and only ever
+ * write their own, so neither side takes a lock or makes a syscall while
+ * the ring is neither full nor empty. a side that finds nothing to do spins
+ * briefly and then sleeps on a futex on its peer's index, raising a flag so
+ * the peer knows to wake it. wakes are only paid for when someone sleeps.
+ *
+ * messages can be written and read in place with reserve/commit and
+ * receive/release, or copied with send/recv. timeouts are in milliseconds,
+ * 0 does not wait and LKU_FUTEX_INFINITE waits forever.
+ */
+
+/* at the start of the shared memory, followed by the ring itself. each
+ * index sits on its own cache line next to the flag its owner reads.
+ */
+struct lku_channel_shared {
+    uint32_t magic;
+    uint32_t size;              /* bytes in the ring, a power of two */
+    uint8_t pad0[56];
+
+    uint32_t head;              /* written by the producer */
+    int consumer_waiting;       /* consumer is asleep on head */
+    uint8_t pad1[56];
+
+    uint32_t tail;              /* written by the consumer */
+    int producer_waiting;       /* producer is asleep on tail */
+    uint8_t pad2[56];
+};
+
+/* one side's private view of the channel */
+struct lku_channel {
+    struct lku_channel_shared *shared;
+    uint8_t *ring;
+    uint32_t size;
+    uint32_t head;              /* the producer's own index, or the last one the consumer saw */
+    uint32_t tail;              /* the consumer's own index, or the last one the producer saw */
+    uint32_t pending;           /* size of the record reserved or received */
+};
+
+/* bytes of shared memory a channel with a ring of ring_size bytes needs */
+static inline size_t lku_channel_footprint(size_t ring_size)
+{
+    return sizeof(struct lku_channel_shared) + ring_size;
+}
+
+/* lay out a new channel in mem, which must hold lku_channel_footprint() bytes
+ * and be 64 byte aligned. ring_size must be a power of two of at least 64.
+ */
+int lku_channel_init(struct lku_channel *c, void *mem, size_t ring_size);
+
+/* pick up the channel another process set up in mem */
+int lku_channel_attach(struct lku_channel *c, void *mem);
+
+/* the largest message the channel carries */
+size_t lku_channel_max_message(const struct lku_channel *c);
+
+/* producer: room for a message of len bytes, filled in and then published
+ * with lku_channel_commit(). NULL with errno EAGAIN or ETIMEDOUT if the ring
+ * stayed full, EMSGSIZE if len is too large.
+ */
+void *lku_channel_reserve(struct lku_channel *c, size_t len, unsigned int timeout_msec);
+void lku_channel_commit(struct lku_channel *c);
+
+/* consumer: the next message and its length, valid until it is handed back
+ * with lku_channel_release(). NULL with errno EAGAIN or ETIMEDOUT if the ring
+ * stayed empty.
+ */
+const void *lku_channel_receive(struct lku_channel *c, size_t *len, unsigned int timeout_msec);
+void lku_channel_release(struct lku_channel *c);
+
+/* copying versions of the above. recv fails with EMSGSIZE, leaving the
+ * message queued, if it does not fit in len bytes.
+ */
+int lku_channel_send(struct lku_channel *c, const void *buf, size_t len, unsigned int timeout_msec);
+ssize_t lku_channel_recv(struct lku_channel *c, void *buf, size_t len, unsigned int timeout_msec);
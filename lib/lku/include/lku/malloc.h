@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stddef.h>
+
+/* lkumalloc.a replaces newlib's malloc with a size class allocator when an
+ * app lists it in APP_LIBS ahead of lku.a.
+ *
+ * small allocations come out of per size class free lists kept in one of
+ * LKU_MALLOC_CACHES caches, so threads using different caches never share a
+ * lock on the fast path. anything bigger than LKU_MALLOC_MAX_SMALL gets its
+ * own mapping and is unmapped again on free.
+ */
+#define LKU_MALLOC_CACHES       8
+#define LKU_MALLOC_MAX_SMALL    16384
+
+/* pick the cache the calling thread allocates from. the default always
+ * returns 0, thread libraries override it to spread threads out.
+ */
+unsigned int lku_malloc_cache_index(void);
+
+struct lku_malloc_stats {
+    size_t heap_bytes;      /* claimed from sbrk for small allocations */
+    size_t large_bytes;     /* currently mapped for large allocations */
+    size_t large_count;
+};
+
+void lku_malloc_get_stats(struct lku_malloc_stats *stats);
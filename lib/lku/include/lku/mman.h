@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/lkuser_abi.h>
+
+/* newlib has no sys/mman.h for these targets, so provide the usual names */
+#ifndef PROT_NONE
+#define PROT_NONE       LKUSER_PROT_NONE
+#define PROT_READ       LKUSER_PROT_READ
+#define PROT_WRITE      LKUSER_PROT_WRITE
+#define PROT_EXEC       LKUSER_PROT_EXEC
+#endif
+
+#ifndef MAP_SHARED
+#define MAP_SHARED      LKUSER_MAP_SHARED
+#define MAP_PRIVATE     LKUSER_MAP_PRIVATE
+#define MAP_FIXED       LKUSER_MAP_FIXED
+#define MAP_ANONYMOUS   LKUSER_MAP_ANONYMOUS
+#define MAP_ANON        MAP_ANONYMOUS
+#endif
+#ifndef MAP_STACK
+#define MAP_STACK       LKUSER_MAP_STACK
+#endif
+
+#define MAP_FAILED      ((void *)-1)
+
+/* file mappings are private copies of the file contents, MAP_SHARED is only
+ * accepted for read only file mappings and shared memory objects. munmap must cover whole mappings.
+ * MAP_STACK mappings are committed a page at a time as they are touched and
+ * their lowest page is a guard that faults, they cannot be mprotect()ed.
+ */
+void *mmap(void *addr, size_t len, int prot, int flags, int fd, off_t off);
+int munmap(void *addr, size_t len);
+int mprotect(void *addr, size_t len, int prot);
+
+/* open the shared memory object called name, creating it zero filled with
+ * size bytes if flags has O_CREAT (and failing if it exists with O_EXCL). a
+ * NULL name makes an anonymous object to pass on through fork(). returns a
+ * descriptor to mmap() with MAP_SHARED, or -1 with errno set. the pages stay
+ * until the object is unlinked and its last descriptor and mapping are gone.
+ */
+int lku_shm_open(const char *name, size_t size, int flags);
+int lku_shm_unlink(const char *name);
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/lkuser_abi.h>
+
+/* waiting on several descriptors at once: poll() for a handful, an epoll
+ * interest set for many. pipes, timers from lku/timer.h, the console and
+ * processes opened with lku_pid_open() can all be waited on. files on disk
+ * are always ready.
+ */
+
+/* newlib has no poll.h for these targets, so provide the usual names */
+#ifndef POLLIN
+#define POLLIN      LKUSER_POLLIN
+#define POLLPRI     LKUSER_POLLPRI
+#define POLLOUT     LKUSER_POLLOUT
+#define POLLERR     LKUSER_POLLERR
+#define POLLHUP     LKUSER_POLLHUP
+#define POLLNVAL    LKUSER_POLLNVAL
+
+typedef unsigned int nfds_t;
+
+struct pollfd {
+    int fd;
+    short events;
+    short revents;
+};
+
+/* wait up to timeout_msec, or forever if negative, for any of the
+ * descriptors to be ready. returns how many are, 0 on timeout.
+ */
+int poll(struct pollfd *fds, nfds_t nfds, int timeout_msec);
+#endif
+
+#define EPOLL_CTL_ADD   LKUSER_EPOLL_CTL_ADD
+#define EPOLL_CTL_DEL   LKUSER_EPOLL_CTL_DEL
+#define EPOLL_CTL_MOD   LKUSER_EPOLL_CTL_MOD
+
+#define EPOLLIN         LKUSER_POLLIN
+#define EPOLLPRI        LKUSER_POLLPRI
+#define EPOLLOUT        LKUSER_POLLOUT
+#define EPOLLERR        LKUSER_POLLERR
+#define EPOLLHUP        LKUSER_POLLHUP
+#define EPOLLONESHOT    LKUSER_EPOLLONESHOT
+#define EPOLLET         LKUSER_EPOLLET
+
+typedef union epoll_data {
+    void *ptr;
+    int fd;
+    uint32_t u32;
+    uint64_t u64;
+} epoll_data_t;
+
+/* laid out like struct lkuser_epoll_event */
+struct epoll_event {
+    uint32_t events;
+    uint32_t reserved;
+    epoll_data_t data;
+};
+
+/* an interest set. a wait only looks at descriptors that became ready, so
+ * it costs the same however many are in the set. a descriptor stays in the
+ * set until it is deleted or the set is closed, even if it is closed.
+ */
+int epoll_create1(int flags);
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event *ev);
+int epoll_wait(int epfd, struct epoll_event *events, int max, int timeout_msec);
+
+/* pipe() with O_NONBLOCK on both ends */
+int pipe2(int fds[2], int flags);
+
+/* a descriptor for process pid that reads as ready once it exits. reading
+ * it waits for the exit and returns the exit code as an int. it does not
+ * reap a child, that still takes a waitpid().
+ */
+int lku_pid_open(pid_t pid);
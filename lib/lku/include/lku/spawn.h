@@ -0,0 +1,21 @@
+#pragma once
+
+#include <sys/types.h>
+
+/* start the binary at path as a new process, passing it the nul terminated
+ * argv. returns the child's pid, or -1 with errno set. wait for it with
+ * waitpid(), which stores the exit status in the form WEXITSTATUS() reads.
+ */
+pid_t lku_spawn(const char *path, const char * const argv[]);
+
+/* waitpid() giving up after timeout_msec with ETIMEDOUT. pid -1 waits for
+ * any child, a timeout of 0 fails with EAGAIN unless a child already exited.
+ */
+pid_t lku_waitpid_timeout(pid_t pid, int *status, unsigned int timeout_msec);
+
+/* mark the point where a process launched as a template is set up and can be
+ * copied. returns 0 straight away in a process that is not a template, and 1
+ * in each copy stamped out of one, or -1 with errno set. the template itself
+ * never returns. call it from the main thread with no others running.
+ */
+int lku_ready(void);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+
+/* threads within one process. each thread runs on its own mapped stack with
+ * its descriptor at the top, and the thread pointer register (tp on riscv,
+ * TPIDRURO on arm) pointing at the descriptor. stacks only take memory as
+ * they grow, and running off the bottom of one faults on a guard page.
+ */
+#define LKU_THREAD_DEFAULT_STACK    (256 * 1024)
+
+typedef struct lku_thread lku_thread_t;
+typedef int (*lku_thread_func_t)(void *arg);
+
+/* start func(arg) on a new thread with a stack of stack_size bytes, 0 for
+ * the default. returns 0 or -1 with errno set.
+ */
+int lku_thread_create(lku_thread_t **t, lku_thread_func_t func, void *arg, size_t stack_size);
+
+/* wait for a thread to exit, collect its return code and free its stack.
+ * each thread must be joined exactly once.
+ */
+int lku_thread_join(lku_thread_t *t, int *retcode);
+
+/* exit the calling thread. the process exits along with its last thread. */
+void lku_thread_exit(int retcode) __attribute__((noreturn));
+
+lku_thread_t *lku_thread_self(void);
+int lku_thread_id(const lku_thread_t *t);
+
+/* sleep while *addr == value, until woken or timeout_msec passes. returns 0
+ * when woken, -1 with errno EAGAIN if *addr had already changed or ETIMEDOUT.
+ */
+#define LKU_FUTEX_INFINITE  0xffffffffu
+
+int lku_futex_wait(int *addr, int value, unsigned int timeout_msec);
+
+/* wake up to count threads waiting on addr, returning how many were woken */
+int lku_futex_wake(int *addr, int count);
+
+/* give up the cpu to any other runnable thread, sched_yield() does the same */
+int lku_yield(void);
+
+/* restrict a thread, or with LKU_AFFINITY_PROCESS the whole process, to the
+ * cpus set in mask. new threads are spread over the cpus in the process mask.
+ */
+#define LKU_AFFINITY_PROCESS    0
+
+int lku_set_affinity(int tid, unsigned int mask);
+int lku_get_affinity(int tid, unsigned int *mask);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/lkuser_abi.h>
+
+/* timers read through a file descriptor, much like linux's timerfd. sleeps
+ * and timers are accurate to well under a millisecond: the kernel sleeps on
+ * its millisecond timers and yields the cpu through the final stretch.
+ */
+/* newlib only defines this with _POSIX_MONOTONIC_CLOCK */
+#ifndef CLOCK_MONOTONIC
+#define CLOCK_MONOTONIC     (clockid_t)LKUSER_CLOCK_MONOTONIC
+#endif
+
+#ifndef TIMER_ABSTIME
+#define TIMER_ABSTIME       LKUSER_TIMER_ABSTIME
+#endif
+
+/* the time on CLOCK_MONOTONIC in ns, read without entering the kernel */
+static inline uint64_t lku_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* reads and lku_timer_wait() fail with EAGAIN instead of blocking */
+#define LKU_TIMER_NONBLOCK  LKUSER_TIMER_NONBLOCK
+
+/* create a disarmed timer on CLOCK_MONOTONIC or CLOCK_REALTIME, returning
+ * its descriptor or -1 with errno set. close() it when done.
+ */
+int lku_timer_create(clockid_t clock, int flags);
+
+/* arm the timer to expire value_ns from now, or at value_ns on its clock with
+ * TIMER_ABSTIME, then every interval_ns if that is not 0. a value_ns of 0
+ * disarms it.
+ */
+int lku_timer_set(int fd, int flags, uint64_t value_ns, uint64_t interval_ns);
+
+/* the time until the timer next expires, 0 if disarmed, and its interval */
+int lku_timer_get(int fd, uint64_t *value_ns, uint64_t *interval_ns);
+
+/* wait for the timer to expire and return how many times it has since the
+ * last wait, so a late reader can tell how many periods it missed. the same
+ * as reading a uint64_t from the descriptor.
+ */
+int lku_timer_wait(int fd, uint64_t *expirations);
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <sys/lkuser_abi.h>
+
+/* set the console mode (LKUSER_TTY_MODE_*) of one of the standard fds,
+ * returns the previous mode. pass LKUSER_TTY_MODE_QUERY to just read it.
+ */
+int lku_tty_mode(int fd, int mode);
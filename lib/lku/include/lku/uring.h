@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+#include <sys/lkuser_abi.h>
+
+/* a small C api over the kernel's submission/completion rings.
+ *
+ * grab sqes with lku_uring_get_sqe(), fill them in with one of the prep
+ * helpers and post them all with lku_uring_submit(). completions are picked
+ * up with lku_uring_peek_cqe()/lku_uring_wait_cqe() and handed back with
+ * lku_uring_cqe_seen(). one ring per process.
+ */
+struct lku_uring {
+    struct lkuser_uring ring;
+    struct lkuser_uring_sqe *sqes;
+    struct lkuser_uring_cqe *cqes;
+    uint32_t sqe_tail; /* sqes handed out but not yet submitted */
+};
+
+/* entries must be a power of two, flags are LKUSER_URING_SETUP_* */
+int lku_uring_init(struct lku_uring *u, unsigned int entries, unsigned int flags);
+
+struct lkuser_uring_sqe *lku_uring_get_sqe(struct lku_uring *u);
+
+/* post every sqe handed out so far, returns the number submitted */
+int lku_uring_submit(struct lku_uring *u);
+int lku_uring_submit_and_wait(struct lku_uring *u, unsigned int wait_nr);
+
+/* returns 0 and a cqe if one is ready, -1 if none */
+int lku_uring_peek_cqe(struct lku_uring *u, struct lkuser_uring_cqe **cqe);
+int lku_uring_wait_cqe(struct lku_uring *u, struct lkuser_uring_cqe **cqe);
+void lku_uring_cqe_seen(struct lku_uring *u);
+
+static inline void lku_uring_prep(struct lkuser_uring_sqe *sqe, int op, int fd,
+                                  const void *addr, uint32_t len, uint64_t off, uint64_t user_data)
+{
+    sqe->opcode = op;
+    sqe->flags = 0;
+    sqe->reserved = 0;
+    sqe->fd = fd;
+    sqe->addr = (uintptr_t)addr;
+    sqe->off = off;
+    sqe->len = len;
+    sqe->reserved2 = 0;
+    sqe->user_data = user_data;
+}
+
+static inline void lku_uring_prep_nop(struct lkuser_uring_sqe *sqe, uint64_t user_data)
+{
+    lku_uring_prep(sqe, LKUSER_URING_OP_NOP, -1, 0, 0, 0, user_data);
+}
+
+static inline void lku_uring_prep_read(struct lkuser_uring_sqe *sqe, int fd, void *buf, uint32_t len, uint64_t user_data)
+{
+    lku_uring_prep(sqe, LKUSER_URING_OP_READ, fd, buf, len, 0, user_data);
+}
+
+static inline void lku_uring_prep_write(struct lkuser_uring_sqe *sqe, int fd, const void *buf, uint32_t len, uint64_t user_data)
+{
+    lku_uring_prep(sqe, LKUSER_URING_OP_WRITE, fd, buf, len, 0, user_data);
+}
+
+static inline void lku_uring_prep_sleep(struct lkuser_uring_sqe *sqe, uint64_t usecs, uint64_t user_data)
+{
+    lku_uring_prep(sqe, LKUSER_URING_OP_SLEEP, -1, 0, 0, usecs, user_data);
+}
+
+static inline void lku_uring_prep_open(struct lkuser_uring_sqe *sqe, const char *path, int flags, int mode, uint64_t user_data)
+{
+    lku_uring_prep(sqe, LKUSER_URING_OP_OPEN, -1, path, flags, mode, user_data);
+}
+
+static inline void lku_uring_prep_close(struct lkuser_uring_sqe *sqe, int fd, uint64_t user_data)
+{
+    lku_uring_prep(sqe, LKUSER_URING_OP_CLOSE, fd, 0, 0, 0, user_data);
+}
+
+static inline void lku_uring_prep_lseek(struct lkuser_uring_sqe *sqe, int fd, long pos, int whence, uint64_t user_data)
+{
+    lku_uring_prep(sqe, LKUSER_URING_OP_LSEEK, fd, 0, whence, pos, user_data);
+}
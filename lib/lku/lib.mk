@@ -10,7 +10,20 @@ LIB := $(LIB_BUILDDIR)/$(LIB_NAME).a
 #$(warning LIB = $(LIB))
 
 LIB_CFLAGS :=
-LIB_SRCS := $(LOCAL_DIR)/liblk.c
+LIB_SRCS := $(LOCAL_DIR)/channel.c
+LIB_SRCS += $(LOCAL_DIR)/liblk.c
+LIB_SRCS += $(LOCAL_DIR)/thread.c
+LIB_SRCS += $(LOCAL_DIR)/uring.c
 LIB_SRCS += $(LOCAL_DIR)/crt0_$(ARCH).S
 
 include make/lib.mk
+
+# opt in size class malloc, list it in APP_LIBS ahead of lku.a to replace
+# newlib's allocator
+LIB_NAME := lkumalloc
+LIB := $(LIB_BUILDDIR)/$(LIB_NAME).a
+
+LIB_CFLAGS :=
+LIB_SRCS := $(LOCAL_DIR)/malloc.c
+
+include make/lib.mk
@@ -1,12 +1,24 @@
+#include <errno.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 #include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
 
+#include <sys/lock.h>
 #include <sys/lkuser_syscalls.h>
+#include <lku/mman.h>
+#include <lku/poll.h>
+#include <lku/spawn.h>
+#include <lku/thread.h>
+#include <lku/timer.h>
+#include <lku/tty.h>
 
-extern int main(void);
+#include "lku_priv.h"
 
-// TODO: implement __retarget_lock* routines from newlib
+extern int main(int argc, char **argv);
 
 #define SYSCALL_FUNCTION_PTR 0
 
@@ -62,8 +74,9 @@ __attribute__((naked)) ret _lk_##name(args) { \
 #error define syscall mechanism for this arch
 #endif
 
-// Called from startup assembly
-void _start_c(const struct lkuser_syscall_table *syscalls)
+// Called from startup assembly, with the stack the kernel set up holding
+// argc followed by the argv array
+void _start_c(const struct lkuser_syscall_table *syscalls, uintptr_t *args)
 {
 #if SYSCALL_FUNCTION_PTR
     lk_syscalls = syscalls;
@@ -77,7 +90,7 @@ void _start_c(const struct lkuser_syscall_table *syscalls)
     extern void __libc_init_array(void);
     __libc_init_array();
 
-    int ret = main();
+    int ret = main((int)args[0], (char **)&args[1]);
 
     exit(ret);
 }
@@ -88,42 +101,144 @@ void _fini(void) {}
 
 /* implement needed stuff to get it to compile */
 
+/* turn a negative lk status from the kernel into errno and -1 */
+static int lk_error(int err)
+{
+    switch (err) {
+        case LKUSER_ERR_NOT_FOUND: errno = ENOENT; break;
+        case LKUSER_ERR_NOT_READY: errno = EAGAIN; break;
+        case LKUSER_ERR_NO_MEMORY: errno = ENOMEM; break;
+        case LKUSER_ERR_INVALID_ARGS: errno = EINVAL; break;
+        case LKUSER_ERR_TIMED_OUT: errno = ETIMEDOUT; break;
+        case LKUSER_ERR_ALREADY_EXISTS: errno = EEXIST; break;
+        case LKUSER_ERR_CHANNEL_CLOSED: errno = EPIPE; break;
+        case LKUSER_ERR_NOT_SUPPORTED: errno = ESPIPE; break;
+        case LKUSER_ERR_TOO_BIG: errno = EFBIG; break;
+        case LKUSER_ERR_CANCELLED: errno = ECANCELED; break;
+        case LKUSER_ERR_NO_RESOURCES: errno = EMFILE; break;
+        case LKUSER_ERR_BAD_HANDLE: errno = EBADF; break;
+        case LKUSER_ERR_ACCESS_DENIED: errno = EACCES; break;
+        default: errno = EIO; break;
+    }
+    return -1;
+}
+
+static inline int lk_ret(int ret)
+{
+    return (ret < 0) ? lk_error(ret) : ret;
+}
+
+int __lku_error(int err)
+{
+    return lk_error(err);
+}
+
 int _fstat(int file, struct stat *st)
 {
-    st->st_mode = S_IFCHR;
+    struct lkuser_stat kst;
+
+    int err = LK_SYSCALL(fstat, file, &kst);
+    if (err < 0) {
+        return lk_error(err);
+    }
+
+    memset(st, 0, sizeof(*st));
+    st->st_mode = kst.mode;
+    st->st_size = kst.size;
     return 0;
 }
 
-int _isatty(int file) { return 1; }
+int _isatty(int file)
+{
+    struct lkuser_stat kst;
+
+    int err = LK_SYSCALL(fstat, file, &kst);
+    if (err < 0) {
+        lk_error(err);
+        return 0;
+    }
+
+    if ((kst.mode & LKUSER_S_IFMT) != LKUSER_S_IFCHR) {
+        errno = ENOTTY;
+        return 0;
+    }
+    return 1;
+}
 
 void *_sbrk(ptrdiff_t incr)
 {
-    return LK_SYSCALL(sbrk, incr);
+    void *ptr = LK_SYSCALL(sbrk, incr);
+    if (!ptr) {
+        errno = ENOMEM;
+        return (void *)-1;
+    }
+
+    return ptr;
 }
 
 int _open(const char *name, int flags, int mode)
 {
-    return LK_SYSCALL(open, name, flags, mode);
+    return lk_ret(LK_SYSCALL(open, name, flags, mode));
 }
 
 int _close(int file)
 {
-    return LK_SYSCALL(close, file);
+    return lk_ret(LK_SYSCALL(close, file));
 }
 
 int _read(int file, char *ptr, int len)
 {
-    return LK_SYSCALL(read, file, ptr, len);
+    return lk_ret(LK_SYSCALL(read, file, ptr, len));
 }
 
 int _write(int file, const char *ptr, int len)
 {
-    return LK_SYSCALL(write, file, ptr, len);
+    return lk_ret(LK_SYSCALL(write, file, ptr, len));
 }
 
 int _lseek(int file, _off_t pos, int whence)
 {
-    return LK_SYSCALL(lseek, file, pos, whence);
+    return lk_ret(LK_SYSCALL(lseek, file, pos, whence));
+}
+
+void *mmap(void *addr, size_t len, int prot, int flags, int fd, off_t off)
+{
+    struct lkuser_mmap_args args = {
+        .addr = (uintptr_t)addr,
+        .len = len,
+        .prot = prot,
+        .flags = flags,
+        .fd = fd,
+        .off = off,
+    };
+
+    int err = LK_SYSCALL(mmap, &args);
+    if (err < 0) {
+        lk_error(err);
+        return MAP_FAILED;
+    }
+
+    return (void *)(uintptr_t)args.addr;
+}
+
+int munmap(void *addr, size_t len)
+{
+    return lk_ret(LK_SYSCALL(munmap, addr, len));
+}
+
+int mprotect(void *addr, size_t len, int prot)
+{
+    return lk_ret(LK_SYSCALL(mprotect, addr, len, prot));
+}
+
+int lku_shm_open(const char *name, size_t size, int flags)
+{
+    return lk_ret(LK_SYSCALL(shm_open, name, size, flags));
+}
+
+int lku_shm_unlink(const char *name)
+{
+    return lk_ret(LK_SYSCALL(shm_unlink, name));
 }
 
 void _exit(int arg)
@@ -143,15 +258,474 @@ int sleep(unsigned int seconds)
     return LK_SYSCALL(sleep_sec, seconds);
 }
 
-int _kill (int pid, int sig)
+int lku_tty_mode(int fd, int mode)
+{
+    return LK_SYSCALL(tty_mode, fd, mode);
+}
+
+int __lku_uring_setup(struct lkuser_uring *ring)
+{
+    return LK_SYSCALL(uring_setup, ring);
+}
+
+int __lku_uring_enter(unsigned int to_submit, unsigned int min_complete, unsigned int flags)
+{
+    return LK_SYSCALL(uring_enter, to_submit, min_complete, flags);
+}
+
+int __lku_thread_create(void *entry, void *stack_top, void *tls)
+{
+    return LK_SYSCALL(thread_create, entry, stack_top, tls);
+}
+
+void __lku_thread_exit(int retcode)
 {
-    // XXX sort this out
-    LK_SYSCALL(exit, 0);
+    LK_SYSCALL(thread_exit, retcode);
 
     __builtin_unreachable();
 }
 
+int __lku_thread_join(int tid, int *retcode)
+{
+    return LK_SYSCALL(thread_join, tid, retcode);
+}
+
+int __lku_fork(void *entry, void *stack_top)
+{
+    return lk_ret(LK_SYSCALL(fork, entry, stack_top));
+}
+
+int __lku_ready(void *entry, void *stack_top)
+{
+    return lk_ret(LK_SYSCALL(ready, entry, stack_top));
+}
+
+pid_t lku_spawn(const char *path, const char * const argv[])
+{
+    return lk_ret(LK_SYSCALL(spawn, path, argv));
+}
+
+/* status is laid out the way WEXITSTATUS() reads it, a process that was
+ * killed exits with LKUSER_KILL_EXIT_BASE plus the signal number */
+static pid_t wait_child(pid_t pid, int *status, unsigned int timeout_msec)
+{
+    if (pid == 0 || pid < LKUSER_WAIT_ANY) {
+        /* no process groups */
+        errno = EINVAL;
+        return -1;
+    }
+
+    int retcode;
+    int err = LK_SYSCALL(waitpid, pid, &retcode, timeout_msec);
+    if (err < 0) {
+        if (err == LKUSER_ERR_NOT_FOUND) {
+            errno = ECHILD;
+            return -1;
+        }
+        return lk_error(err);
+    }
+
+    if (status) {
+        *status = (retcode & 0xff) << 8;
+    }
+    return err;
+}
+
+pid_t waitpid(pid_t pid, int *status, int options)
+{
+    if (options & ~WNOHANG) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (options & WNOHANG) {
+        pid_t ret = wait_child(pid, status, 0);
+        if (ret < 0 && errno == EAGAIN) {
+            return 0;
+        }
+        return ret;
+    }
+
+    return wait_child(pid, status, LKUSER_WAIT_INFINITE);
+}
+
+pid_t lku_waitpid_timeout(pid_t pid, int *status, unsigned int timeout_msec)
+{
+    return wait_child(pid, status, timeout_msec);
+}
+
+int _wait(int *status)
+{
+    return wait_child(LKUSER_WAIT_ANY, status, LKUSER_WAIT_INFINITE);
+}
+
+int lku_yield(void)
+{
+    return LK_SYSCALL(yield);
+}
+
+int sched_yield(void)
+{
+    return lku_yield();
+}
+
+int pipe(int fds[2])
+{
+    return pipe2(fds, 0);
+}
+
+int pipe2(int fds[2], int flags)
+{
+    return lk_ret(LK_SYSCALL(pipe, fds, flags));
+}
+
+_Static_assert(sizeof(struct pollfd) == sizeof(struct lkuser_pollfd), "pollfd layout");
+_Static_assert(sizeof(struct epoll_event) == sizeof(struct lkuser_epoll_event), "epoll_event layout");
+
+int poll(struct pollfd *fds, nfds_t nfds, int timeout_msec)
+{
+    return lk_ret(LK_SYSCALL(poll, (struct lkuser_pollfd *)fds, nfds, timeout_msec));
+}
+
+int epoll_create1(int flags)
+{
+    return lk_ret(LK_SYSCALL(epoll_create, flags));
+}
+
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event *ev)
+{
+    return lk_ret(LK_SYSCALL(epoll_ctl, epfd, op, fd, (const struct lkuser_epoll_event *)ev));
+}
+
+int epoll_wait(int epfd, struct epoll_event *events, int max, int timeout_msec)
+{
+    return lk_ret(LK_SYSCALL(epoll_wait, epfd, (struct lkuser_epoll_event *)events, max, timeout_msec));
+}
+
+int lku_pid_open(pid_t pid)
+{
+    return lk_ret(LK_SYSCALL(pid_open, pid));
+}
+
+int lku_set_affinity(int tid, unsigned int mask)
+{
+    return lk_ret(LK_SYSCALL(set_affinity, tid, mask));
+}
+
+int lku_get_affinity(int tid, unsigned int *mask)
+{
+    return lk_ret(LK_SYSCALL(get_affinity, tid, mask));
+}
+
+int lku_futex_wait(int *addr, int value, unsigned int timeout_msec)
+{
+    return lk_ret(LK_SYSCALL(futex_wait, addr, value, timeout_msec));
+}
+
+int lku_futex_wake(int *addr, int count)
+{
+    return lk_ret(LK_SYSCALL(futex_wake, addr, count));
+}
+
+/* newlib's retargetable locks, built on futexes. the lock word is 0 when
+ * free, 1 when held and 2 when held with possible waiters, so an uncontended
+ * acquire and release never enter the kernel. the rest of the library uses
+ * the same lock through __lku_futex_lock().
+ */
+struct __lock {
+    int state;
+    lku_thread_t *owner;
+    unsigned int count;
+};
+
+struct __lock __lock___sinit_recursive_mutex;
+struct __lock __lock___sfp_recursive_mutex;
+struct __lock __lock___atexit_recursive_mutex;
+struct __lock __lock___at_quick_exit_mutex;
+struct __lock __lock___malloc_recursive_mutex;
+struct __lock __lock___env_recursive_mutex;
+struct __lock __lock___tz_mutex;
+struct __lock __lock___dd_hash_mutex;
+struct __lock __lock___arc4random_mutex;
+
+void __lku_futex_lock(int *state)
+{
+    int c = 0;
+    if (__atomic_compare_exchange_n(state, &c, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    /* mark the lock contended before sleeping, so the holder wakes us */
+    if (c != 2) {
+        c = __atomic_exchange_n(state, 2, __ATOMIC_ACQUIRE);
+    }
+    while (c != 0) {
+        LK_SYSCALL(futex_wait, state, 2, LKUSER_FUTEX_INFINITE);
+        c = __atomic_exchange_n(state, 2, __ATOMIC_ACQUIRE);
+    }
+}
+
+void __lku_futex_unlock(int *state)
+{
+    if (__atomic_exchange_n(state, 0, __ATOMIC_RELEASE) == 2) {
+        LK_SYSCALL(futex_wake, state, 1);
+    }
+}
+
+static void lock_acquire(struct __lock *lock)
+{
+    __lku_futex_lock(&lock->state);
+}
+
+static int lock_try_acquire(struct __lock *lock)
+{
+    int c = 0;
+    return __atomic_compare_exchange_n(&lock->state, &c, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static void lock_release(struct __lock *lock)
+{
+    __lku_futex_unlock(&lock->state);
+}
+
+void __retarget_lock_init(_LOCK_T *lock)
+{
+    *lock = calloc(1, sizeof(struct __lock));
+}
+
+void __retarget_lock_init_recursive(_LOCK_T *lock)
+{
+    *lock = calloc(1, sizeof(struct __lock));
+}
+
+void __retarget_lock_close(_LOCK_T lock)
+{
+    free(lock);
+}
+
+void __retarget_lock_close_recursive(_LOCK_T lock)
+{
+    free(lock);
+}
+
+void __retarget_lock_acquire(_LOCK_T lock)
+{
+    if (lock) {
+        lock_acquire(lock);
+    }
+}
+
+int __retarget_lock_try_acquire(_LOCK_T lock)
+{
+    return lock ? lock_try_acquire(lock) : 1;
+}
+
+void __retarget_lock_release(_LOCK_T lock)
+{
+    if (lock) {
+        lock_release(lock);
+    }
+}
+
+void __retarget_lock_acquire_recursive(_LOCK_T lock)
+{
+    if (!lock) {
+        return;
+    }
+
+    lku_thread_t *self = lku_thread_self();
+    if (lock->owner == self) {
+        lock->count++;
+        return;
+    }
+
+    lock_acquire(lock);
+    lock->owner = self;
+    lock->count = 1;
+}
+
+int __retarget_lock_try_acquire_recursive(_LOCK_T lock)
+{
+    if (!lock) {
+        return 1;
+    }
+
+    lku_thread_t *self = lku_thread_self();
+    if (lock->owner == self) {
+        lock->count++;
+        return 1;
+    }
+
+    if (!lock_try_acquire(lock)) {
+        return 0;
+    }
+    lock->owner = self;
+    lock->count = 1;
+    return 1;
+}
+
+void __retarget_lock_release_recursive(_LOCK_T lock)
+{
+    if (!lock) {
+        return;
+    }
+
+    if (--lock->count == 0) {
+        lock->owner = NULL;
+        lock_release(lock);
+    }
+}
+
+int _kill (int pid, int sig)
+{
+    /* killing ourselves does not come back */
+    return lk_ret(LK_SYSCALL(kill, pid, sig));
+}
+
 pid_t _getpid (void)
 {
-  return (pid_t)1;
+    const volatile struct lkuser_kdata_proc *kproc = (const void *)LKUSER_KDATA_PROC;
+
+    return (pid_t)kproc->pid;
+}
+
+/* time, read out of the kernel data page without entering the kernel */
+static inline uint64_t read_counter(void)
+{
+    uint64_t val;
+#if ARCH_RISCV
+    __asm__ volatile("rdtime %0" : "=r"(val));
+#elif ARCH_ARM
+    __asm__ volatile("mrrc p15, 1, %Q0, %R0, c14" : "=r"(val));
+#else
+    val = 0;
+#endif
+    return val;
+}
+
+static uint64_t monotonic_ns(void)
+{
+    const volatile struct lkuser_kdata_time *ktime = (const void *)LKUSER_KDATA_TIME;
+    uint32_t seq;
+    uint64_t ns;
+
+    do {
+        seq = ktime->seq;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        ns = ktime->mono_ns;
+        if (ktime->counter_user) {
+            uint64_t delta = read_counter() - ktime->counter_base;
+            ns += (delta * ktime->counter_mult) >> ktime->counter_shift;
+        }
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != ktime->seq);
+
+    return ns;
+}
+
+static int64_t realtime_offset_ns(void)
+{
+    const volatile struct lkuser_kdata_time *ktime = (const void *)LKUSER_KDATA_TIME;
+
+    return ktime->realtime_offset_ns;
+}
+
+int clock_gettime(clockid_t clock_id, struct timespec *tp)
+{
+    uint64_t ns = monotonic_ns();
+
+    if (clock_id == CLOCK_REALTIME) {
+        ns += realtime_offset_ns();
+    } else if (clock_id != CLOCK_MONOTONIC) {
+        return -1;
+    }
+
+    tp->tv_sec = ns / 1000000000ULL;
+    tp->tv_nsec = ns % 1000000000ULL;
+    return 0;
+}
+
+static int clock_ok(clockid_t clock_id)
+{
+    return clock_id == CLOCK_MONOTONIC || clock_id == CLOCK_REALTIME;
+}
+
+int clock_nanosleep(clockid_t clock_id, int flags, const struct timespec *rqtp, struct timespec *rmtp)
+{
+    if (!clock_ok(clock_id) || rqtp->tv_sec < 0 || rqtp->tv_nsec < 0 || rqtp->tv_nsec >= 1000000000L) {
+        return EINVAL;
+    }
+
+    /* nothing interrupts a sleep, so there is never any time left over */
+    uint64_t ns = (uint64_t)rqtp->tv_sec * 1000000000ULL + rqtp->tv_nsec;
+    int err = LK_SYSCALL(nanosleep, (int)clock_id, flags & TIMER_ABSTIME, &ns);
+    if (err < 0) {
+        return EINVAL;
+    }
+    if (rmtp && !(flags & TIMER_ABSTIME)) {
+        rmtp->tv_sec = 0;
+        rmtp->tv_nsec = 0;
+    }
+    return 0;
+}
+
+int nanosleep(const struct timespec *rqtp, struct timespec *rmtp)
+{
+    int err = clock_nanosleep(CLOCK_MONOTONIC, 0, rqtp, rmtp);
+    if (err) {
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+int lku_timer_create(clockid_t clock, int flags)
+{
+    return lk_ret(LK_SYSCALL(timer_create, (int)clock, flags));
+}
+
+int lku_timer_set(int fd, int flags, uint64_t value_ns, uint64_t interval_ns)
+{
+    struct lkuser_timer_spec spec = { .value_ns = value_ns, .interval_ns = interval_ns };
+
+    return lk_ret(LK_SYSCALL(timer_set, fd, flags, &spec, NULL));
+}
+
+int lku_timer_get(int fd, uint64_t *value_ns, uint64_t *interval_ns)
+{
+    struct lkuser_timer_spec spec;
+
+    int err = lk_ret(LK_SYSCALL(timer_get, fd, &spec));
+    if (err < 0) {
+        return err;
+    }
+    if (value_ns) {
+        *value_ns = spec.value_ns;
+    }
+    if (interval_ns) {
+        *interval_ns = spec.interval_ns;
+    }
+    return 0;
+}
+
+int lku_timer_wait(int fd, uint64_t *expirations)
+{
+    int err = lk_ret(LK_SYSCALL(read, fd, (char *)expirations, sizeof(*expirations)));
+
+    return (err < 0) ? err : 0;
+}
+
+/* backs gettimeofday() and time() in newlib */
+int _gettimeofday(struct timeval *tv, void *tz)
+{
+    if (tv) {
+        uint64_t ns = monotonic_ns() + realtime_offset_ns();
+
+        tv->tv_sec = ns / 1000000000ULL;
+        tv->tv_usec = (ns % 1000000000ULL) / 1000;
+    }
+
+    return 0;
 }
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <sys/lkuser_syscalls.h>
+
+/* thin syscall wrappers exported by liblk.c for the rest of the library */
+int __lku_error(int err);
+int __lku_uring_setup(struct lkuser_uring *ring);
+int __lku_uring_enter(unsigned int to_submit, unsigned int min_complete, unsigned int flags);
+int __lku_thread_create(void *entry, void *stack_top, void *tls);
+void __lku_thread_exit(int retcode) __attribute__((noreturn));
+int __lku_thread_join(int tid, int *retcode);
+int __lku_fork(void *entry, void *stack_top);
+int __lku_ready(void *entry, void *stack_top);
+
+/* plain futex lock on a word initialized to 0, from liblk.c */
+void __lku_futex_lock(int *state);
+void __lku_futex_unlock(int *state);
@@ -0,0 +1,455 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <lku/malloc.h>
+#include <lku/mman.h>
+
+#include "lku_priv.h"
+
+/* every block is at least this aligned */
+#define ALIGNMENT       16
+
+/* the heap is carved into chunks, each belonging to spans of one class */
+#define CHUNK_SHIFT     16
+#define CHUNK_SIZE      (1UL << CHUNK_SHIFT)
+#define MAX_CHUNKS      4096
+
+/* 8 classes 16 bytes apart up to 128, then 4 per power of two */
+#define NUM_CLASSES     36
+
+#define PAGE_SIZE       4096
+#define ROUNDUP(a, b)   (((a) + ((b) - 1)) & ~((b) - 1))
+
+#define LARGE_MAGIC     0x6c61726bUL /* 'lark' */
+
+struct block {
+    struct block *next;
+};
+
+/* the locks are futex locks rather than spinlocks, since a cache's lock is
+ * held across a refill and a refill can grow the heap with sbrk(). taking
+ * one uncontended is still a single atomic.
+ */
+
+/* blocks of a class shared between caches, plus the span being carved up */
+struct central {
+    int lock;
+    struct block *free;
+    uintptr_t bump;
+    uintptr_t bump_end;
+};
+
+struct cache {
+    int lock;
+    struct {
+        struct block *free;
+        unsigned int count;
+    } bins[NUM_CLASSES];
+};
+
+/* sits right in front of a large allocation */
+struct large_header {
+    void *base;
+    size_t len;
+    size_t usable;
+    size_t magic;
+};
+
+static struct central centrals[NUM_CLASSES];
+static struct cache caches[LKU_MALLOC_CACHES];
+
+static int heap_lock;
+static uintptr_t heap_lo;
+static uintptr_t heap_hi;
+static uint8_t chunk_class[MAX_CHUNKS]; /* class + 1 of each chunk, 0 if unused */
+
+static size_t large_bytes;
+static size_t large_count;
+
+__attribute__((weak)) unsigned int lku_malloc_cache_index(void)
+{
+    return 0;
+}
+
+static inline unsigned int size_to_class(size_t size)
+{
+    if (size <= 128) {
+        return (size > 0) ? (size - 1) / 16 : 0;
+    }
+
+    unsigned int shift = sizeof(unsigned long) * 8 - 1 - __builtin_clzl(size - 1);
+    unsigned int sub = (size - 1) >> (shift - 2);
+    return 8 + (shift - 7) * 4 + (sub - 4);
+}
+
+static inline size_t class_size(unsigned int class)
+{
+    if (class < 8) {
+        return (class + 1) * 16;
+    }
+
+    unsigned int shift = 7 + (class - 8) / 4;
+    unsigned int sub = 4 + (class - 8) % 4;
+    return (size_t)(sub + 1) << (shift - 2);
+}
+
+/* at least 8 blocks per span so the biggest classes don't waste most of it */
+static inline size_t span_size(unsigned int class)
+{
+    size_t size = class_size(class) * 8;
+    return (size < CHUNK_SIZE) ? CHUNK_SIZE : ROUNDUP(size, CHUNK_SIZE);
+}
+
+/* batch moved between a cache and the central lists */
+static inline unsigned int batch_count(unsigned int class)
+{
+    unsigned int count = 16384 / class_size(class);
+    return (count < 4) ? 4 : (count > 64) ? 64 : count;
+}
+
+/* claim chunk aligned memory off the end of the heap for a new span */
+static uintptr_t grow_heap(size_t len, unsigned int class)
+{
+    __lku_futex_lock(&heap_lock);
+
+    uintptr_t brk = (uintptr_t)sbrk(0);
+    uintptr_t start = ROUNDUP(brk, CHUNK_SIZE);
+    if (!heap_lo) {
+        heap_lo = start;
+    }
+
+    if ((start + len - heap_lo) >> CHUNK_SHIFT > MAX_CHUNKS ||
+        sbrk(start - brk + len) == (void *)-1) {
+        __lku_futex_unlock(&heap_lock);
+        return 0;
+    }
+
+    for (uintptr_t c = start; c < start + len; c += CHUNK_SIZE) {
+        chunk_class[(c - heap_lo) >> CHUNK_SHIFT] = class + 1;
+    }
+    __atomic_store_n(&heap_hi, start + len, __ATOMIC_RELEASE);
+
+    __lku_futex_unlock(&heap_lock);
+    return start;
+}
+
+/* the class of a block, or -1 if it doesn't come from the heap */
+static inline int block_class(const void *ptr)
+{
+    uintptr_t p = (uintptr_t)ptr;
+
+    if (p < heap_lo || p >= __atomic_load_n(&heap_hi, __ATOMIC_ACQUIRE)) {
+        return -1;
+    }
+    return (int)chunk_class[(p - heap_lo) >> CHUNK_SHIFT] - 1;
+}
+
+/* move up to a batch of blocks from the central list into a cache bin */
+static void refill(struct cache *cache, unsigned int class)
+{
+    struct central *central = &centrals[class];
+    const size_t size = class_size(class);
+    unsigned int want = batch_count(class);
+    struct block *list = cache->bins[class].free;
+    unsigned int count = cache->bins[class].count;
+
+    __lku_futex_lock(&central->lock);
+
+    while (want > 0 && central->free) {
+        struct block *b = central->free;
+        central->free = b->next;
+        b->next = list;
+        list = b;
+        count++;
+        want--;
+    }
+
+    while (want > 0) {
+        if (central->bump + size > central->bump_end) {
+            size_t len = span_size(class);
+            uintptr_t span = grow_heap(len, class);
+            if (!span) {
+                break;
+            }
+            central->bump = span;
+            central->bump_end = span + len;
+        }
+
+        struct block *b = (struct block *)central->bump;
+        central->bump += size;
+        b->next = list;
+        list = b;
+        count++;
+        want--;
+    }
+
+    __lku_futex_unlock(&central->lock);
+
+    cache->bins[class].free = list;
+    cache->bins[class].count = count;
+}
+
+/* hand half of an overfull bin back to the central list */
+static void flush(struct cache *cache, unsigned int class)
+{
+    struct central *central = &centrals[class];
+    unsigned int count = cache->bins[class].count / 2;
+
+    struct block *head = cache->bins[class].free;
+    struct block *tail = head;
+    for (unsigned int i = 1; i < count; i++) {
+        tail = tail->next;
+    }
+    cache->bins[class].free = tail->next;
+    cache->bins[class].count -= count;
+
+    __lku_futex_lock(&central->lock);
+    tail->next = central->free;
+    central->free = head;
+    __lku_futex_unlock(&central->lock);
+}
+
+static void *small_alloc(unsigned int class)
+{
+    struct cache *cache = &caches[lku_malloc_cache_index() % LKU_MALLOC_CACHES];
+
+    __lku_futex_lock(&cache->lock);
+
+    if (!cache->bins[class].free) {
+        refill(cache, class);
+    }
+
+    struct block *b = cache->bins[class].free;
+    if (b) {
+        cache->bins[class].free = b->next;
+        cache->bins[class].count--;
+    }
+
+    __lku_futex_unlock(&cache->lock);
+
+    if (!b) {
+        errno = ENOMEM;
+    }
+    return b;
+}
+
+static void small_free(void *ptr, unsigned int class)
+{
+    struct cache *cache = &caches[lku_malloc_cache_index() % LKU_MALLOC_CACHES];
+    struct block *b = ptr;
+
+    __lku_futex_lock(&cache->lock);
+
+    b->next = cache->bins[class].free;
+    cache->bins[class].free = b;
+    if (++cache->bins[class].count > batch_count(class) * 2) {
+        flush(cache, class);
+    }
+
+    __lku_futex_unlock(&cache->lock);
+}
+
+static void *large_alloc(size_t size, size_t align)
+{
+    /* the mapping is page aligned, so the header never pushes the block out
+     * further than the header rounded up to the alignment */
+    size_t offset = ROUNDUP(sizeof(struct large_header), align);
+    if (size > SIZE_MAX - offset - PAGE_SIZE) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    size_t len = ROUNDUP(offset + size, PAGE_SIZE);
+
+    void *base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    uintptr_t ptr = ROUNDUP((uintptr_t)base + sizeof(struct large_header), align);
+    struct large_header *h = (struct large_header *)ptr - 1;
+    h->base = base;
+    h->len = len;
+    h->usable = (uintptr_t)base + len - ptr;
+    h->magic = LARGE_MAGIC;
+
+    __atomic_fetch_add(&large_bytes, len, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&large_count, 1, __ATOMIC_RELAXED);
+
+    return (void *)ptr;
+}
+
+static void large_free(void *ptr)
+{
+    struct large_header *h = (struct large_header *)ptr - 1;
+    if (h->magic != LARGE_MAGIC) {
+        abort();
+    }
+
+    h->magic = 0;
+    __atomic_fetch_sub(&large_bytes, h->len, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&large_count, 1, __ATOMIC_RELAXED);
+
+    munmap(h->base, h->len);
+}
+
+static size_t usable_size(void *ptr)
+{
+    int class = block_class(ptr);
+    if (class >= 0) {
+        return class_size(class);
+    }
+    return ((struct large_header *)ptr - 1)->usable;
+}
+
+void *malloc(size_t size)
+{
+    if (size > LKU_MALLOC_MAX_SMALL) {
+        return large_alloc(size, ALIGNMENT);
+    }
+    return small_alloc(size_to_class(size));
+}
+
+void free(void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+
+    int class = block_class(ptr);
+    if (class >= 0) {
+        small_free(ptr, class);
+    } else {
+        large_free(ptr);
+    }
+}
+
+void *calloc(size_t count, size_t size)
+{
+    size_t total;
+    if (__builtin_mul_overflow(count, size, &total)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    void *ptr = malloc(total);
+    if (ptr) {
+        memset(ptr, 0, total);
+    }
+    return ptr;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    if (!ptr) {
+        return malloc(size);
+    }
+    if (size == 0) {
+        free(ptr);
+        return NULL;
+    }
+
+    /* stay put if it still fits without wasting more than half the block */
+    size_t usable = usable_size(ptr);
+    if (size <= usable && (size > usable / 2 || usable <= ALIGNMENT)) {
+        return ptr;
+    }
+
+    void *newptr = malloc(size);
+    if (newptr) {
+        memcpy(newptr, ptr, (size < usable) ? size : usable);
+        free(ptr);
+    }
+    return newptr;
+}
+
+void *memalign(size_t align, size_t size)
+{
+    if (align == 0 || (align & (align - 1))) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (align <= ALIGNMENT) {
+        return malloc(size);
+    }
+
+    /* spans are chunk aligned, so a class whose size is a multiple of the
+     * alignment only ever hands out aligned blocks */
+    if (size <= LKU_MALLOC_MAX_SMALL && align <= LKU_MALLOC_MAX_SMALL) {
+        for (unsigned int class = size_to_class(size); class < NUM_CLASSES; class++) {
+            if ((class_size(class) & (align - 1)) == 0) {
+                return small_alloc(class);
+            }
+        }
+    }
+
+    return large_alloc(size, align);
+}
+
+int posix_memalign(void **memptr, size_t align, size_t size)
+{
+    if (align < sizeof(void *)) {
+        return EINVAL;
+    }
+
+    void *ptr = memalign(align, size);
+    if (!ptr) {
+        return errno;
+    }
+
+    *memptr = ptr;
+    return 0;
+}
+
+void *aligned_alloc(size_t align, size_t size)
+{
+    return memalign(align, size);
+}
+
+size_t malloc_usable_size(void *ptr)
+{
+    return ptr ? usable_size(ptr) : 0;
+}
+
+void lku_malloc_get_stats(struct lku_malloc_stats *stats)
+{
+    stats->heap_bytes = heap_hi - heap_lo;
+    stats->large_bytes = __atomic_load_n(&large_bytes, __ATOMIC_RELAXED);
+    stats->large_count = __atomic_load_n(&large_count, __ATOMIC_RELAXED);
+}
+
+/* newlib calls the reentrant versions internally, stdio buffers included */
+struct _reent;
+
+void *_malloc_r(struct _reent *r, size_t size)
+{
+    return malloc(size);
+}
+
+void _free_r(struct _reent *r, void *ptr)
+{
+    free(ptr);
+}
+
+void *_calloc_r(struct _reent *r, size_t count, size_t size)
+{
+    return calloc(count, size);
+}
+
+void *_realloc_r(struct _reent *r, void *ptr, size_t size)
+{
+    return realloc(ptr, size);
+}
+
+void *_memalign_r(struct _reent *r, size_t align, size_t size)
+{
+    return memalign(align, size);
+}
+
+size_t _malloc_usable_size_r(struct _reent *r, void *ptr)
+{
+    return malloc_usable_size(ptr);
+}
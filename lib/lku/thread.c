@@ -0,0 +1,257 @@
+#include <errno.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <lku/malloc.h>
+#include <lku/mman.h>
+#include <lku/spawn.h>
+#include <lku/thread.h>
+
+#include "lku_priv.h"
+
+_Static_assert(LKU_AFFINITY_PROCESS == LKUSER_AFFINITY_PROCESS, "");
+
+#define PAGE_SIZE       4096
+#define ROUNDUP(a, b)   (((a) + ((b) - 1)) & ~((b) - 1))
+
+/* lives at the very top of the thread's stack mapping */
+struct lku_thread {
+    lku_thread_func_t func;
+    void *arg;
+    int tid;                /* 0 until the creator learns it, -1 while someone waits for it */
+    void *stack;
+    size_t stack_len;
+};
+
+/* the kernel numbers the threads of a process from 1, starting with main */
+static struct lku_thread main_thread = {
+    .tid = 1,
+};
+
+/* stacks of joined threads, kept mapped for the next thread that wants one
+ * the same size rather than going to the kernel to unmap and map again */
+#ifndef LKU_STACK_CACHE_SIZE
+#define LKU_STACK_CACHE_SIZE    8
+#endif
+
+static struct {
+    void *stack;
+    size_t len;
+} stack_cache[LKU_STACK_CACHE_SIZE];
+static unsigned int stack_cache_count;
+static int stack_cache_lock;
+
+static void *get_stack(size_t len)
+{
+    void *stack = NULL;
+
+    __lku_futex_lock(&stack_cache_lock);
+    for (unsigned int i = 0; i < stack_cache_count; i++) {
+        if (stack_cache[i].len == len) {
+            stack = stack_cache[i].stack;
+            stack_cache[i] = stack_cache[--stack_cache_count];
+            break;
+        }
+    }
+    __lku_futex_unlock(&stack_cache_lock);
+
+    if (stack) {
+        return stack;
+    }
+
+    return mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+}
+
+static void put_stack(void *stack, size_t len)
+{
+    __lku_futex_lock(&stack_cache_lock);
+    if (stack_cache_count < LKU_STACK_CACHE_SIZE) {
+        stack_cache[stack_cache_count].stack = stack;
+        stack_cache[stack_cache_count].len = len;
+        stack_cache_count++;
+        stack = NULL;
+    }
+    __lku_futex_unlock(&stack_cache_lock);
+
+    if (stack) {
+        munmap(stack, len);
+    }
+}
+
+/* the kernel keeps each thread's descriptor as its thread pointer, null for
+ * the main thread, and puts it back on the way out of every trap. on arm it
+ * lives in TPIDRURO, which only the kernel can write. on riscv tp is saved
+ * with the rest of the user registers, but a thread entering user space for
+ * the first time sets it itself.
+ */
+static inline struct lku_thread *get_thread_pointer(void)
+{
+    struct lku_thread *t;
+#if ARCH_RISCV
+    __asm__ volatile("mv %0, tp" : "=r"(t));
+#elif ARCH_ARM
+    __asm__ volatile("mrc p15, 0, %0, c13, c0, 3" : "=r"(t));
+#else
+    t = NULL;
+#endif
+    return t;
+}
+
+static inline void set_thread_pointer(struct lku_thread *t)
+{
+#if ARCH_RISCV
+    __asm__ volatile("mv tp, %0" :: "r"(t));
+#endif
+}
+
+/* in crt0, sets up the thread pointer and calls __lku_thread_start with the descriptor */
+extern void __lku_thread_entry(void);
+
+/* a copy of the process made by fork() or stamped out of a template starts
+ * with sp pointing at one of these, left on the stack of the thread that made
+ * the call, and jumps back into that call */
+struct lku_fork_frame {
+    jmp_buf env;
+    struct lku_thread *self;
+} __attribute__((aligned(16)));
+
+/* in crt0, calls __lku_fork_start with the frame */
+extern void __lku_fork_entry(void);
+
+void __lku_thread_start(struct lku_thread *t)
+{
+    lku_thread_exit(t->func(t->arg));
+}
+
+void __lku_fork_start(struct lku_fork_frame *f)
+{
+    /* the copy's only thread is the first one in its process */
+    set_thread_pointer(f->self == &main_thread ? NULL : f->self);
+    f->self->tid = 1;
+    longjmp(f->env, 1);
+}
+
+int _fork(void)
+{
+    struct lku_fork_frame frame;
+
+    frame.self = lku_thread_self();
+    if (setjmp(frame.env)) {
+        return 0;
+    }
+
+    return __lku_fork((void *)&__lku_fork_entry, &frame);
+}
+
+int lku_ready(void)
+{
+    struct lku_fork_frame frame;
+
+    frame.self = lku_thread_self();
+    if (setjmp(frame.env)) {
+        return 1;
+    }
+
+    return __lku_ready((void *)&__lku_fork_entry, &frame);
+}
+
+int lku_thread_create(lku_thread_t **out, lku_thread_func_t func, void *arg, size_t stack_size)
+{
+    if (!out || !func) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (stack_size == 0) {
+        stack_size = LKU_THREAD_DEFAULT_STACK;
+    }
+    /* with a guard page below the stack */
+    size_t len = ROUNDUP(stack_size, PAGE_SIZE) + PAGE_SIZE;
+
+    void *stack = get_stack(len);
+    if (stack == MAP_FAILED) {
+        return -1;
+    }
+
+    /* the stack grows down from just below the descriptor */
+    struct lku_thread *t = (struct lku_thread *)((uintptr_t)stack + len - ROUNDUP(sizeof(*t), 16));
+    t->func = func;
+    t->arg = arg;
+    t->tid = 0;
+    t->stack = stack;
+    t->stack_len = len;
+
+    int tid = __lku_thread_create((void *)&__lku_thread_entry, t, t);
+    if (tid < 0) {
+        put_stack(stack, len);
+        return __lku_error(tid);
+    }
+
+    /* the thread may already be running and asking for its id */
+    if (__atomic_exchange_n(&t->tid, tid, __ATOMIC_RELEASE) < 0) {
+        lku_futex_wake(&t->tid, INT32_MAX);
+    }
+
+    *out = t;
+    return 0;
+}
+
+int lku_thread_join(lku_thread_t *t, int *retcode)
+{
+    if (!t || t == &main_thread) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int err = __lku_thread_join(lku_thread_id(t), retcode);
+    if (err < 0) {
+        return __lku_error(err);
+    }
+
+    /* the descriptor goes away with the stack */
+    put_stack(t->stack, t->stack_len);
+
+    return 0;
+}
+
+void lku_thread_exit(int retcode)
+{
+    __lku_thread_exit(retcode);
+}
+
+lku_thread_t *lku_thread_self(void)
+{
+    struct lku_thread *t = get_thread_pointer();
+
+    return t ? t : &main_thread;
+}
+
+int lku_thread_id(const lku_thread_t *t)
+{
+    int *tid = (int *)&t->tid;
+
+    /* a new thread can get here before lku_thread_create() has its id */
+    for (;;) {
+        int cur = __atomic_load_n(tid, __ATOMIC_ACQUIRE);
+        if (cur > 0) {
+            return cur;
+        }
+        if (cur == 0 && !__atomic_compare_exchange_n(tid, &cur, -1, 0,
+                                                     __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        lku_futex_wait(tid, -1, LKU_FUTEX_INFINITE);
+    }
+}
+
+/* spread the threads over the malloc caches, overriding the weak default.
+ * every thread runs on a stack mapping of its own, so the stack pointer is
+ * enough to tell them apart without looking the thread up.
+ */
+unsigned int lku_malloc_cache_index(void)
+{
+    uintptr_t sp = (uintptr_t)__builtin_frame_address(0);
+
+    return (unsigned int)(sp >> 16);
+}
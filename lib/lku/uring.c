@@ -0,0 +1,116 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <lku/uring.h>
+
+#include "lku_priv.h"
+
+int lku_uring_init(struct lku_uring *u, unsigned int entries, unsigned int flags)
+{
+    memset(u, 0, sizeof(*u));
+
+    /* twice as many completions as submissions so the cq rarely backs up */
+    u->sqes = calloc(entries, sizeof(*u->sqes));
+    u->cqes = calloc(entries * 2, sizeof(*u->cqes));
+    if (!u->sqes || !u->cqes) {
+        free(u->sqes);
+        free(u->cqes);
+        return -1;
+    }
+
+    u->ring.sq_entries = entries;
+    u->ring.cq_entries = entries * 2;
+    u->ring.flags = flags;
+    u->ring.sqes = (uintptr_t)u->sqes;
+    u->ring.cqes = (uintptr_t)u->cqes;
+
+    int err = __lku_uring_setup(&u->ring);
+    if (err < 0) {
+        free(u->sqes);
+        free(u->cqes);
+        return err;
+    }
+
+    u->sqe_tail = u->ring.sq_tail;
+    return 0;
+}
+
+struct lkuser_uring_sqe *lku_uring_get_sqe(struct lku_uring *u)
+{
+    uint32_t head = __atomic_load_n(&u->ring.sq_head, __ATOMIC_ACQUIRE);
+    if (u->sqe_tail - head >= u->ring.sq_entries) {
+        return NULL;
+    }
+
+    return &u->sqes[u->sqe_tail++ & (u->ring.sq_entries - 1)];
+}
+
+static int submit(struct lku_uring *u, unsigned int wait_nr, unsigned int flags)
+{
+    uint32_t to_submit = u->sqe_tail - u->ring.sq_tail;
+
+    /* publish the new entries to the kernel */
+    __atomic_store_n(&u->ring.sq_tail, u->sqe_tail, __ATOMIC_RELEASE);
+
+    if (u->ring.flags & LKUSER_URING_SETUP_SQPOLL) {
+        /* the kernel is polling, only trap if it went idle or we need to wait */
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&u->ring.sq_flags, __ATOMIC_RELAXED) & LKUSER_URING_SQ_NEED_WAKEUP) {
+            flags |= LKUSER_URING_ENTER_SQ_WAKEUP;
+        }
+        if (flags) {
+            __lku_uring_enter(0, wait_nr, flags);
+        }
+        return to_submit;
+    }
+
+    if (to_submit == 0 && !flags) {
+        return 0;
+    }
+
+    return __lku_uring_enter(to_submit, wait_nr, flags);
+}
+
+int lku_uring_submit(struct lku_uring *u)
+{
+    return submit(u, 0, 0);
+}
+
+int lku_uring_submit_and_wait(struct lku_uring *u, unsigned int wait_nr)
+{
+    return submit(u, wait_nr, wait_nr ? LKUSER_URING_ENTER_GETEVENTS : 0);
+}
+
+int lku_uring_peek_cqe(struct lku_uring *u, struct lkuser_uring_cqe **cqe)
+{
+    uint32_t head = u->ring.cq_head;
+    if (head == __atomic_load_n(&u->ring.cq_tail, __ATOMIC_ACQUIRE)) {
+        return -1;
+    }
+
+    *cqe = &u->cqes[head & (u->ring.cq_entries - 1)];
+    return 0;
+}
+
+int lku_uring_wait_cqe(struct lku_uring *u, struct lkuser_uring_cqe **cqe)
+{
+    while (lku_uring_peek_cqe(u, cqe) < 0) {
+        /* without a polling thread nothing completes unless something is queued */
+        if (!(u->ring.flags & LKUSER_URING_SETUP_SQPOLL) &&
+                __atomic_load_n(&u->ring.sq_head, __ATOMIC_ACQUIRE) == u->sqe_tail) {
+            return -1;
+        }
+
+        int err = submit(u, 1, LKUSER_URING_ENTER_GETEVENTS);
+        if (err < 0) {
+            return err;
+        }
+    }
+
+    return 0;
+}
+
+void lku_uring_cqe_seen(struct lku_uring *u)
+{
+    __atomic_store_n(&u->ring.cq_head, u->ring.cq_head + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "aspace.h"
+
+#include <stdio.h>
+#include <lk/err.h>
+#include <lk/trace.h>
+#include <kernel/mutex.h>
+#include <sys/lkuser_abi.h>
+
+#define LOCAL_TRACE 0
+
+namespace lkuser {
+
+namespace {
+
+struct cached_aspace {
+    vmm_aspace_t *aspace;
+    vm_page_t *kdata_page;
+};
+
+Mutex cache_lock;
+cached_aspace cache[LKUSER_ASPACE_CACHE_SIZE];
+size_t cache_count;
+
+struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t recycled;
+    uint64_t freed;
+} stats;
+
+bool is_kdata(const vmm_region_t *r) {
+    return r->base == LKUSER_KDATA_TIME || r->base == LKUSER_KDATA_PROC;
+}
+
+// free every region the process left behind, which also unmaps any pages
+// in them that were not given back already
+void strip(vmm_aspace_t *aspace) {
+    for (;;) {
+        vaddr_t base = 0;
+        bool found = false;
+
+        // nobody else looks at the address space of a dead process
+        vmm_region_t *r;
+        list_for_every_entry(&aspace->region_list, r, vmm_region_t, node) {
+            if (!is_kdata(r)) {
+                base = r->base;
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            break;
+        }
+
+        LTRACEF("aspace %p: freeing region at %#lx\n", aspace, base);
+        vmm_free_region(aspace, base);
+    }
+}
+
+} // namespace
+
+bool aspace_cache_get(vmm_aspace_t **aspace, vm_page_t **kdata_page) {
+    AutoLock guard(cache_lock);
+
+    if (cache_count == 0) {
+        stats.misses++;
+        return false;
+    }
+
+    const cached_aspace &c = cache[--cache_count];
+    *aspace = c.aspace;
+    *kdata_page = c.kdata_page;
+    stats.hits++;
+
+    LTRACEF("reusing aspace %p\n", *aspace);
+    return true;
+}
+
+bool aspace_cache_put(vmm_aspace_t *aspace, vm_page_t *kdata_page) {
+    {
+        AutoLock guard(cache_lock);
+        if (cache_count == LKUSER_ASPACE_CACHE_SIZE) {
+            stats.freed++;
+            return false;
+        }
+    }
+
+    // strip it before it is visible to anyone else
+    strip(aspace);
+
+    AutoLock guard(cache_lock);
+    if (cache_count == LKUSER_ASPACE_CACHE_SIZE) {
+        stats.freed++;
+        return false;
+    }
+    cache[cache_count].aspace = aspace;
+    cache[cache_count].kdata_page = kdata_page;
+    cache_count++;
+    stats.recycled++;
+
+    LTRACEF("recycled aspace %p\n", aspace);
+    return true;
+}
+
+void aspace_cache_flush() {
+    for (;;) {
+        cached_aspace c;
+        {
+            AutoLock guard(cache_lock);
+            if (cache_count == 0) {
+                break;
+            }
+            c = cache[--cache_count];
+        }
+
+        // the kernel data page is only freed once it is unmapped
+        vmm_free_aspace(c.aspace);
+        pmm_free_page(c.kdata_page);
+    }
+}
+
+void dump_aspace_cache() {
+    AutoLock guard(cache_lock);
+
+    printf("aspace cache: %zu of %u cached, %llu hits, %llu misses, %llu recycled, %llu freed\n",
+           cache_count, (uint)LKUSER_ASPACE_CACHE_SIZE, (unsigned long long)stats.hits,
+           (unsigned long long)stats.misses, (unsigned long long)stats.recycled,
+           (unsigned long long)stats.freed);
+}
+
+} // namespace lkuser
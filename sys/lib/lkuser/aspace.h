@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <sys/types.h>
+#include <kernel/vm.h>
+
+namespace lkuser {
+
+// how many address spaces of dead processes are kept for new ones
+#ifndef LKUSER_ASPACE_CACHE_SIZE
+#define LKUSER_ASPACE_CACHE_SIZE 16
+#endif
+
+// address spaces of processes that have been torn down, emptied of all but
+// the kernel data pages, so a new process skips creating the address space,
+// building its top level page tables and mapping the kernel data pages.
+
+// take a recycled address space and the process page still mapped in it,
+// false if there are none
+bool aspace_cache_get(vmm_aspace_t **aspace, vm_page_t **kdata_page);
+
+// strip everything but the kernel data pages out of an address space whose
+// process is gone and keep it. false if the cache is full, in which case the
+// caller frees it as usual.
+bool aspace_cache_put(vmm_aspace_t *aspace, vm_page_t *kdata_page);
+
+void aspace_cache_flush();
+void dump_aspace_cache();
+
+} // namespace lkuser
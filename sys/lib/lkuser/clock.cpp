@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "clock.h"
+
+#include <string.h>
+#include <lk/err.h>
+#include <lk/trace.h>
+#include <kernel/thread.h>
+
+#include "kdata.h"
+#include "thread.h"
+
+#define LOCAL_TRACE 0
+
+namespace lkuser {
+
+namespace {
+
+// timer files that a timer callback may still use, held across each callback
+constexpr size_t live_bucket_count = 64;
+
+spin_lock_t live_lock = SPIN_LOCK_INITIAL_VALUE;
+list_node live_buckets[live_bucket_count];
+
+list_node &live_bucket(const void *tf) {
+    list_node &b = live_buckets[((uintptr_t)tf / sizeof(void *)) % live_bucket_count];
+    if (!b.next) {
+        list_initialize(&b);
+    }
+    return b;
+}
+
+} // namespace
+
+status_t clock_to_monotonic(int clock, uint64_t ns, uint64_t *mono_ns) {
+    switch (clock) {
+        case LKUSER_CLOCK_MONOTONIC:
+            *mono_ns = ns;
+            return NO_ERROR;
+        case LKUSER_CLOCK_REALTIME: {
+            int64_t mono = (int64_t)ns - kdata_realtime_offset_ns();
+            *mono_ns = (mono > 0) ? mono : 0;
+            return NO_ERROR;
+        }
+        default:
+            return ERR_INVALID_ARGS;
+    }
+}
+
+status_t clock_wait(event_t *event, uint64_t deadline_ns) {
+    // with nothing to wake us early, wait on an event nobody signals so that a
+    // kill of the process still can
+    event_t never;
+    if (!event) {
+        event_init(&never, false, 0);
+    }
+
+    status_t err;
+    for (;;) {
+        uint64_t now = kdata_now_ns();
+        if (now >= deadline_ns) {
+            err = ERR_TIMED_OUT;
+            break;
+        }
+
+        uint64_t remaining_us = (deadline_ns - now) / 1000;
+#if LKUSER_SLEEP_SPIN_USEC > 0
+        if (remaining_us < LKUSER_SLEEP_SPIN_USEC) {
+            // a timer would round this up to the next tick
+            if (event && event_wait_timeout(event, 0) == NO_ERROR) {
+                err = NO_ERROR;
+                break;
+            }
+            thread_yield();
+            continue;
+        }
+#endif
+
+        // a timer of n ms set part way into a tick fires before n ms are
+        // up, never after, so only the final wait of less than a tick can
+        // run past the deadline, by at most one tick
+        lk_time_t msec = remaining_us / 1000;
+        if (msec == 0) {
+            msec = 1;
+        }
+        err = killable_wait(event ? event : &never, msec);
+        if (err != ERR_TIMED_OUT) {
+            break;
+        }
+    }
+
+    if (!event) {
+        event_destroy(&never);
+    }
+    return err;
+}
+
+timer_file::timer_file(int clock, int flags) : clock_(clock), flags_(flags) {
+    event_init(&changed_, false, EVENT_FLAG_AUTOUNSIGNAL);
+
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&live_lock, state);
+    list_add_head(&live_bucket(this), &live_node_);
+    spin_unlock_irqrestore(&live_lock, state);
+}
+
+timer_file::~timer_file() {
+    arm(0);
+
+    // a callback that fired before the cancel either finishes before we get
+    // the lock or finds us gone once it has it
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&live_lock, state);
+    list_delete(&live_node_);
+    spin_unlock_irqrestore(&live_lock, state);
+
+    event_destroy(&changed_);
+}
+
+void timer_file::arm(uint64_t deadline_ns) {
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&timer_lock_, state);
+    arm_locked(deadline_ns);
+    spin_unlock_irqrestore(&timer_lock_, state);
+}
+
+void timer_file::arm_locked(uint64_t deadline_ns) {
+    timer_cancel(&timer_);
+    timer_deadline_ns_ = deadline_ns;
+    if (deadline_ns) {
+        // a timer fires up to a tick early, the callback sets it again if so
+        uint64_t now = kdata_now_ns();
+        lk_time_t msec = (deadline_ns > now) ? (deadline_ns - now + 999999) / 1000000 : 0;
+        timer_set_oneshot(&timer_, msec, &timer_callback, this);
+    }
+}
+
+handler_return timer_file::timer_callback(timer_t *t, lk_time_t now, void *arg) {
+    auto *tf = (timer_file *)arg;
+
+    spin_lock_saved_state_t live_state;
+    spin_lock_irqsave(&live_lock, live_state);
+
+    bool live = false;
+    timer_file *entry;
+    list_for_every_entry(&live_bucket(tf), entry, timer_file, live_node_) {
+        if (entry == tf) {
+            live = true;
+            break;
+        }
+    }
+
+    if (live) {
+        spin_lock_saved_state_t state;
+        spin_lock_irqsave(&tf->timer_lock_, state);
+        uint64_t deadline = tf->timer_deadline_ns_;
+        bool expired = deadline && kdata_now_ns() >= deadline;
+        if (deadline && !expired) {
+            tf->arm_locked(deadline);
+        }
+        spin_unlock_irqrestore(&tf->timer_lock_, state);
+
+        if (expired) {
+            tf->source_.notify(LKUSER_POLLIN);
+        }
+    }
+
+    spin_unlock_irqrestore(&live_lock, live_state);
+    return INT_NO_RESCHEDULE;
+}
+
+uint32_t timer_file::poll_events() {
+    AutoLock guard(lock_);
+    return (deadline_ns_ && kdata_now_ns() >= deadline_ns_) ? LKUSER_POLLIN : 0;
+}
+
+ssize_t timer_file::read(char *buf, size_t len) {
+    if (len < sizeof(uint64_t)) {
+        return ERR_INVALID_ARGS;
+    }
+
+    for (;;) {
+        uint64_t deadline;
+        {
+            AutoLock guard(lock_);
+
+            uint64_t now = kdata_now_ns();
+            if (deadline_ns_ && now >= deadline_ns_) {
+                // count every period that went by, not just this one
+                uint64_t count = 1;
+                if (interval_ns_) {
+                    count += (now - deadline_ns_) / interval_ns_;
+                    deadline_ns_ += count * interval_ns_;
+                } else {
+                    deadline_ns_ = 0;
+                }
+                arm(deadline_ns_);
+
+                LTRACEF("timer %p: %llu expirations\n", this, (unsigned long long)count);
+                memcpy(buf, &count, sizeof(count));
+                return sizeof(count);
+            }
+
+            if (flags_ & LKUSER_TIMER_NONBLOCK) {
+                return ERR_NOT_READY;
+            }
+            deadline = deadline_ns_ ? deadline_ns_ : UINT64_MAX;
+        }
+
+        status_t err = (deadline == UINT64_MAX) ? killable_wait(&changed_) : clock_wait(&changed_, deadline);
+        if (err == ERR_CANCELLED) {
+            return err;
+        }
+    }
+}
+
+status_t timer_file::stat(lkuser_stat *st) {
+    st->mode = 0;
+    st->size = 0;
+    return NO_ERROR;
+}
+
+status_t timer_file::set(int flags, const lkuser_timer_spec &spec, lkuser_timer_spec *old) {
+    uint64_t deadline = 0;
+    uint64_t now = kdata_now_ns();
+    if (spec.value_ns) {
+        if (flags & LKUSER_TIMER_ABSTIME) {
+            status_t err = clock_to_monotonic(clock_, spec.value_ns, &deadline);
+            if (err < 0) {
+                return err;
+            }
+            // a deadline already in the past expires right away
+            if (deadline == 0) {
+                deadline = 1;
+            }
+        } else {
+            deadline = now + spec.value_ns;
+        }
+    }
+
+    {
+        AutoLock guard(lock_);
+        if (old) {
+            get_locked(now, old);
+        }
+        deadline_ns_ = deadline;
+        interval_ns_ = spec.value_ns ? spec.interval_ns : 0;
+        arm(deadline_ns_);
+    }
+
+    LTRACEF("timer %p: deadline %llu, interval %llu\n", this, (unsigned long long)deadline,
+            (unsigned long long)spec.interval_ns);
+
+    event_signal(&changed_, true);
+    return NO_ERROR;
+}
+
+void timer_file::get(lkuser_timer_spec *cur) {
+    AutoLock guard(lock_);
+    get_locked(kdata_now_ns(), cur);
+}
+
+void timer_file::get_locked(uint64_t now, lkuser_timer_spec *cur) {
+    // the time left until the next expiration, as timerfd_gettime reports it
+    if (!deadline_ns_) {
+        cur->value_ns = 0;
+    } else if (now >= deadline_ns_) {
+        // expired but not read yet, so only a periodic timer has a next one
+        cur->value_ns = interval_ns_ ? interval_ns_ - (now - deadline_ns_) % interval_ns_ : 0;
+    } else {
+        cur->value_ns = deadline_ns_ - now;
+    }
+    cur->interval_ns = interval_ns_;
+}
+
+} // namespace lkuser
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <sys/types.h>
+#include <lk/list.h>
+#include <kernel/event.h>
+#include <kernel/mutex.h>
+#include <kernel/spinlock.h>
+#include <kernel/timer.h>
+#include <sys/lkuser_abi.h>
+
+#include "fd.h"
+#include "poll.h"
+
+namespace lkuser {
+
+// kernel timers only tick in milliseconds, so a wait with less than a tick
+// to go sleeps for one more tick. setting this instead covers the last
+// stretch of a wait shorter than it by yielding until the deadline passes,
+// trading cpu time for sub millisecond wakeups.
+#ifndef LKUSER_SLEEP_SPIN_USEC
+#define LKUSER_SLEEP_SPIN_USEC 0
+#endif
+
+// convert a time on one of the LKUSER_CLOCK_* clocks to monotonic ns
+status_t clock_to_monotonic(int clock, uint64_t ns, uint64_t *mono_ns);
+
+// block until the monotonic deadline passes, or until event is signaled if
+// there is one. returns ERR_TIMED_OUT at the deadline, NO_ERROR on the
+// event, and ERR_CANCELLED if the calling process is killed.
+status_t clock_wait(event_t *event, uint64_t deadline_ns);
+
+// a timer, read through a file descriptor
+class timer_file final : public file {
+public:
+    timer_file(int clock, int flags);
+    ~timer_file() override;
+
+    // blocks until the timer expires, returning the number of expirations
+    ssize_t read(char *buf, size_t len) override;
+    status_t stat(lkuser_stat *st) override;
+    uint32_t poll_events() override;
+    poll_source *get_poll_source() override { return &source_; }
+    timer_file *as_timer() override { return this; }
+
+    status_t set(int flags, const lkuser_timer_spec &spec, lkuser_timer_spec *old);
+    void get(lkuser_timer_spec *cur);
+
+private:
+    void get_locked(uint64_t now, lkuser_timer_spec *cur);
+
+    // wake pollers at a deadline, or stop if 0
+    void arm(uint64_t deadline_ns);
+    void arm_locked(uint64_t deadline_ns);
+    static handler_return timer_callback(timer_t *t, lk_time_t now, void *arg);
+
+    Mutex lock_;
+    // signaled when the timer is set so that readers pick up the new deadline
+    event_t changed_;
+    const int clock_;
+    const int flags_;
+    // monotonic time of the next expiration, 0 while disarmed
+    uint64_t deadline_ns_ = 0;
+    uint64_t interval_ns_ = 0;
+
+    // a kernel timer that tells pollers about the next expiration. it only
+    // has millisecond resolution, which is fine for a poll but not for the
+    // reads above.
+    poll_source source_;
+    spin_lock_t timer_lock_ = SPIN_LOCK_INITIAL_VALUE;
+    timer_t timer_ = TIMER_INITIAL_VALUE(timer_);
+    uint64_t timer_deadline_ns_ = 0;
+    // cancelling the timer does not wait for a callback already under way, so
+    // callbacks only touch timer files they find on this list
+    list_node live_node_ = LIST_INITIAL_CLEARED_VALUE;
+};
+
+} // namespace lkuser
@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "console.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <lk/err.h>
+#include <lk/trace.h>
+#include <lib/cbuf.h>
+#include <kernel/event.h>
+#include <kernel/mutex.h>
+#include <kernel/thread.h>
+#include <platform.h>
+#include <platform/debug.h>
+#include <sys/lkuser_abi.h>
+
+#include "poll.h"
+#include "thread.h"
+
+#define LOCAL_TRACE 0
+
+namespace lkuser {
+
+namespace {
+
+// output ring shared by all processes, drained by a single thread
+cbuf_t out_cbuf;
+
+// held across an entire write so that a single call lands in the ring contiguously
+Mutex out_lock;
+
+// bytes that are either sitting in the ring or in flight in the drain thread
+size_t out_pending;
+
+// signalled by the drain thread every time it pushes a chunk to the device
+event_t out_drained_event = EVENT_INITIAL_VALUE(out_drained_event, false, 0);
+
+bool out_running;
+
+char drain_buf[512];
+
+int console_drain_thread(void *arg) {
+    for (;;) {
+        size_t len = cbuf_read(&out_cbuf, drain_buf, sizeof(drain_buf), true);
+        if (len == 0) {
+            continue;
+        }
+
+        fwrite(drain_buf, 1, len, stdout);
+
+        __atomic_sub_fetch(&out_pending, len, __ATOMIC_RELEASE);
+        event_signal(&out_drained_event, false);
+    }
+
+    return 0;
+}
+
+// input not yet taken by any process, filled by a single thread as it arrives
+// and handed to whichever process reads or polls first
+cbuf_t in_cbuf;
+
+// signalled every time the input thread adds to the ring
+event_t in_event = EVENT_INITIAL_VALUE(in_event, false, 0);
+
+// signalled every time a process takes input out of the ring
+event_t in_space_event = EVENT_INITIAL_VALUE(in_space_event, false, 0);
+
+poll_source in_source;
+
+// set once the device has no more input to give
+bool in_eof;
+
+void in_put(char c) {
+    for (;;) {
+        event_unsignal(&in_space_event);
+        if (cbuf_write_char(&in_cbuf, c, false) == 1) {
+            return;
+        }
+
+        // make sure whoever is waiting knows the ring is full, then leave the
+        // rest with the device until someone makes room
+        event_signal(&in_event, true);
+        in_source.notify(LKUSER_POLLIN);
+        event_wait(&in_space_event);
+    }
+}
+
+int console_input_thread(void *arg) {
+    for (;;) {
+        int c = getchar();
+        if (c < 0) {
+            break;
+        }
+        in_put((char)c);
+
+        // pick up the rest of a burst before waking anyone
+        char ch;
+        while (cbuf_space_avail(&in_cbuf) > 0 && platform_dgetc(&ch, false) >= 0) {
+            in_put(ch);
+        }
+
+        event_signal(&in_event, true);
+        in_source.notify(LKUSER_POLLIN);
+    }
+
+    LTRACEF("end of console input\n");
+
+    __atomic_store_n(&in_eof, true, __ATOMIC_RELEASE);
+    event_signal(&in_event, true);
+    in_source.notify(LKUSER_POLLIN | LKUSER_POLLHUP);
+
+    return 0;
+}
+
+} // namespace
+
+poll_source *console_input_source() {
+    return &in_source;
+}
+
+ssize_t console_write(const char *buf, size_t len) {
+    LTRACEF("buf %p, len %zu\n", buf, len);
+
+    if (!out_running) {
+        // too early to queue anything, write straight through
+        return fwrite(buf, 1, len, stdout);
+    }
+
+    AutoLock guard(out_lock);
+
+    size_t pos = 0;
+    while (pos < len) {
+        event_unsignal(&out_drained_event);
+
+        // account for the bytes before they become visible to the drain thread
+        size_t remaining = len - pos;
+        __atomic_add_fetch(&out_pending, remaining, __ATOMIC_RELAXED);
+        size_t written = cbuf_write(&out_cbuf, buf + pos, remaining, false);
+        if (written < remaining) {
+            __atomic_sub_fetch(&out_pending, remaining - written, __ATOMIC_RELAXED);
+        }
+        pos += written;
+
+        if (written == 0) {
+            // the ring is full, wait for the drain thread to make some room
+            event_wait(&out_drained_event);
+        }
+    }
+
+    return len;
+}
+
+status_t console_flush(lk_time_t timeout) {
+    if (!out_running) {
+        return NO_ERROR;
+    }
+
+    lk_time_t start = current_time();
+    for (;;) {
+        event_unsignal(&out_drained_event);
+        if (__atomic_load_n(&out_pending, __ATOMIC_ACQUIRE) == 0) {
+            return NO_ERROR;
+        }
+
+        lk_time_t elapsed = current_time() - start;
+        if (elapsed >= timeout) {
+            LTRACEF("timed out with %zu bytes pending\n", out_pending);
+            return ERR_TIMED_OUT;
+        }
+
+        event_wait_timeout(&out_drained_event, timeout - elapsed);
+    }
+}
+
+void console_benchmark(size_t len) {
+    char *buf = (char *)malloc(len);
+    if (!buf) {
+        printf("error allocating %zu byte buffer\n", len);
+        return;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = ((i % 64) == 63) ? '\n' : (char)('a' + (i % 26));
+    }
+
+    console_flush(INFINITE_TIME);
+
+    // the old sys_write path: one locked stdio call per byte
+    lk_bigtime_t t0 = current_time_hires();
+    for (size_t i = 0; i < len; i++) {
+        fputc(buf[i], stdout);
+    }
+    lk_bigtime_t t1 = current_time_hires();
+
+    // the buffered path, timing both the copy into the ring and the drain
+    console_write(buf, len);
+    lk_bigtime_t t2 = current_time_hires();
+    console_flush(INFINITE_TIME);
+    lk_bigtime_t t3 = current_time_hires();
+
+    free(buf);
+
+    auto rate = [len](lk_bigtime_t usecs) -> uint64_t {
+        return usecs ? (uint64_t)len * 1000000 / usecs : 0;
+    };
+
+    printf("\nconsole benchmark, %zu bytes:\n", len);
+    printf("\tper byte: %llu usecs, %llu bytes/s\n",
+           (unsigned long long)(t1 - t0), (unsigned long long)rate(t1 - t0));
+    printf("\tbuffered: %llu usecs to queue (%llu bytes/s), %llu usecs to drain (%llu bytes/s)\n",
+           (unsigned long long)(t2 - t1), (unsigned long long)rate(t2 - t1),
+           (unsigned long long)(t3 - t1), (unsigned long long)rate(t3 - t1));
+}
+
+console_input::console_input() : mode_(LKUSER_TTY_MODE_LINE) {
+    cbuf_initialize_etc(&ring_, sizeof(ring_buf_), ring_buf_);
+}
+
+int console_input::set_mode(int mode) {
+    AutoLock guard(lock_);
+
+    int old = mode_;
+    mode_ = mode & (LKUSER_TTY_MODE_LINE | LKUSER_TTY_MODE_ECHO);
+    return old;
+}
+
+void console_input::push(char c) {
+    /* translate \r -> \n */
+    if (c == '\r') c = '\n';
+
+    if (mode_ & LKUSER_TTY_MODE_ECHO) {
+        console_write(&c, 1);
+    }
+
+    cbuf_write_char(&ring_, c, false);
+    if (c == '\n') {
+        lines_++;
+    }
+}
+
+// move buffered console input into this process's ring, returns false at end of input
+bool console_input::pump() {
+    bool eof = __atomic_load_n(&in_eof, __ATOMIC_ACQUIRE);
+
+    // anything past a full ring stays in the shared ring until a read makes room,
+    // rather than being taken and dropped
+    char c;
+    bool took = false;
+    while (cbuf_space_avail(&ring_) > 0 && cbuf_read_char(&in_cbuf, &c, false) == 1) {
+        push(c);
+        took = true;
+    }
+
+    if (took) {
+        event_signal(&in_space_event, true);
+    }
+
+    return !eof || cbuf_space_used(&in_cbuf) > 0;
+}
+
+bool console_input::ready(size_t len) {
+    size_t used = cbuf_space_used(&ring_);
+
+    if (mode_ & LKUSER_TTY_MODE_LINE) {
+        // a full line, a full caller buffer, or a full ring all complete the read
+        return lines_ > 0 || used >= len || cbuf_space_avail(&ring_) == 0;
+    }
+
+    return used > 0;
+}
+
+ssize_t console_input::read(char *buf, size_t len) {
+    LTRACEF("buf %p, len %zu, mode %#x\n", buf, len, mode_);
+
+    if (len == 0) {
+        return 0;
+    }
+
+    AutoLock guard(lock_);
+
+    for (;;) {
+        event_unsignal(&in_event);
+        if (!pump() || ready(len)) {
+            break;
+        }
+
+        // let pollers at the ring while waiting for the input thread
+        lock_.release();
+        status_t err = killable_wait(&in_event);
+        lock_.acquire();
+        if (err < 0) {
+            return err;
+        }
+    }
+
+    size_t pos = 0;
+    if (mode_ & LKUSER_TTY_MODE_LINE) {
+        // copy out up to and including the first newline
+        char c;
+        while (pos < len && cbuf_read_char(&ring_, &c, false) == 1) {
+            buf[pos++] = c;
+            if (c == '\n') {
+                lines_--;
+                break;
+            }
+        }
+    } else {
+        pos = cbuf_read(&ring_, buf, len, false);
+        for (size_t i = 0; i < pos; i++) {
+            if (buf[i] == '\n') {
+                lines_--;
+            }
+        }
+    }
+
+    LTRACEF("returning %zu bytes\n", pos);
+
+    return pos;
+}
+
+bool console_input::poll() {
+    AutoLock guard(lock_);
+
+    // at end of input a read returns straight away
+    if (!pump()) {
+        return true;
+    }
+
+    // a partial line would not complete a read in line mode
+    bool ready = (mode_ & LKUSER_TTY_MODE_LINE) ? (lines_ > 0 || cbuf_space_avail(&ring_) == 0)
+                                                : cbuf_space_used(&ring_) > 0;
+
+    return ready;
+}
+
+void console_init() {
+    cbuf_initialize(&out_cbuf, LKUSER_CONSOLE_OUT_BUF_SIZE);
+    cbuf_initialize(&in_cbuf, LKUSER_CONSOLE_DEVICE_BUF_SIZE);
+
+    thread_t *t = thread_create("lkuser console in", &console_input_thread, NULL, DEFAULT_PRIORITY, DEFAULT_STACK_SIZE);
+    if (!t) {
+        TRACEF("error creating console input thread, no console input\n");
+        in_eof = true;
+    } else {
+        thread_detach_and_resume(t);
+    }
+
+    t = thread_create("lkuser console", &console_drain_thread, NULL, DEFAULT_PRIORITY, DEFAULT_STACK_SIZE);
+    if (!t) {
+        TRACEF("error creating console drain thread, writing synchronously\n");
+        return;
+    }
+    out_running = true;
+    thread_detach_and_resume(t);
+}
+
+} // namespace lkuser
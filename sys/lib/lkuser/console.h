@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <sys/types.h>
+#include <lk/compiler.h>
+#include <lk/cpp.h>
+#include <lib/cbuf.h>
+#include <kernel/mutex.h>
+
+namespace lkuser {
+
+// size of the kernel side console output ring
+#ifndef LKUSER_CONSOLE_OUT_BUF_SIZE
+#define LKUSER_CONSOLE_OUT_BUF_SIZE (64 * 1024)
+#endif
+
+// maximum amount of time an exiting process waits for its output to drain
+#ifndef LKUSER_CONSOLE_EXIT_FLUSH_MSEC
+#define LKUSER_CONSOLE_EXIT_FLUSH_MSEC 100
+#endif
+
+// size of the per process console input ring
+#ifndef LKUSER_CONSOLE_IN_BUF_SIZE
+#define LKUSER_CONSOLE_IN_BUF_SIZE 512
+#endif
+
+// size of the kernel side ring holding console input no process has read yet
+#ifndef LKUSER_CONSOLE_DEVICE_BUF_SIZE
+#define LKUSER_CONSOLE_DEVICE_BUF_SIZE 1024
+#endif
+
+class poll_source;
+
+// per process buffered console input with an optional line discipline
+class console_input {
+public:
+    console_input();
+    ~console_input() = default;
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(console_input);
+
+    // read up to len bytes, blocking until at least one byte (or a full line) is ready
+    ssize_t read(char *buf, size_t len);
+
+    // whether a read would complete without blocking, picking up any input
+    // the console has buffered
+    bool poll();
+
+    // LKUSER_TTY_MODE_* bits, returns the previous mode
+    int set_mode(int mode);
+    int get_mode() const { return mode_; }
+
+private:
+    void push(char c);
+    bool pump();
+    bool ready(size_t len);
+
+    Mutex lock_;
+    int mode_;
+
+    // number of newlines currently sitting in the ring
+    size_t lines_ = 0;
+
+    cbuf_t ring_;
+    char ring_buf_[LKUSER_CONSOLE_IN_BUF_SIZE];
+};
+
+// notified whenever new console input has been buffered
+poll_source *console_input_source();
+
+// queue a buffer of console output, draining it in the background
+ssize_t console_write(const char *buf, size_t len);
+
+// wait up to timeout for all queued console output to reach the device
+status_t console_flush(lk_time_t timeout);
+
+// compare the per byte and the buffered console paths
+void console_benchmark(size_t len);
+
+void console_init();
+
+} // namespace lkuser
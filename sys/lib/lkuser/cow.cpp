@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "cow.h"
+
+#include <string.h>
+#include <lk/err.h>
+#include <lk/trace.h>
+#include <arch/ops.h>
+#include <kernel/vm.h>
+
+#include "proc.h"
+
+#define LOCAL_TRACE 0
+
+namespace lkuser {
+
+namespace {
+
+// owners of a shared page beyond the first
+struct shared_page {
+    list_node node;
+    vm_page_t *page;
+    uint extra;
+};
+
+constexpr size_t share_bucket_count = 256;
+
+struct share_bucket {
+    Mutex lock;
+    list_node list = LIST_INITIAL_VALUE(list);
+};
+
+share_bucket share_buckets[share_bucket_count];
+
+share_bucket &bucket_for(vm_page_t *page) {
+    return share_buckets[(vm_page_to_paddr(page) / PAGE_SIZE) % share_bucket_count];
+}
+
+shared_page *find_locked(share_bucket &b, vm_page_t *page) {
+    shared_page *s;
+    list_for_every_entry(&b.list, s, shared_page, node) {
+        if (s->page == page) {
+            return s;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+status_t cow_share_page(vm_page_t *page) {
+    share_bucket &b = bucket_for(page);
+    AutoLock guard(b.lock);
+
+    shared_page *s = find_locked(b, page);
+    if (s) {
+        s->extra++;
+        return NO_ERROR;
+    }
+
+    s = new shared_page;
+    if (!s) {
+        return ERR_NO_MEMORY;
+    }
+    s->page = page;
+    s->extra = 1;
+    list_add_head(&b.list, &s->node);
+
+    return NO_ERROR;
+}
+
+void cow_release_page(vm_page_t *page) {
+    {
+        share_bucket &b = bucket_for(page);
+        AutoLock guard(b.lock);
+
+        shared_page *s = find_locked(b, page);
+        if (s) {
+            if (--s->extra == 0) {
+                list_delete(&s->node);
+                delete s;
+            }
+            return;
+        }
+    }
+
+    // we were the only owner
+    pmm_free_page(page);
+}
+
+bool cow_page_shared(vm_page_t *page) {
+    share_bucket &b = bucket_for(page);
+    AutoLock guard(b.lock);
+
+    return find_locked(b, page) != nullptr;
+}
+
+cow_set::cow_set() {
+    for (auto &b : buckets_) {
+        list_initialize(&b);
+    }
+}
+
+cow_set::~cow_set() {
+    for (auto &b : buckets_) {
+        entry *e;
+        while ((e = list_remove_head_type(&b, entry, node))) {
+            delete e;
+        }
+    }
+}
+
+bool cow_set::contains_locked(vaddr_t va) const {
+    const entry *e;
+    list_for_every_entry(&bucket(va), e, const entry, node) {
+        if (e->va == va) {
+            return true;
+        }
+    }
+    return false;
+}
+
+status_t cow_set::insert_locked(vaddr_t va) {
+    if (contains_locked(va)) {
+        return NO_ERROR;
+    }
+
+    entry *e = new entry;
+    if (!e) {
+        return ERR_NO_MEMORY;
+    }
+    e->va = va;
+    list_add_head(&bucket(va), &e->node);
+    count_++;
+
+    return NO_ERROR;
+}
+
+bool cow_set::remove_locked(vaddr_t va) {
+    entry *e;
+    list_for_every_entry(&bucket(va), e, entry, node) {
+        if (e->va == va) {
+            list_delete(&e->node);
+            delete e;
+            count_--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void release_user_page(proc *p, vaddr_t va) {
+    arch_aspace_t *arch_aspace = &p->get_aspace()->arch_aspace;
+
+    paddr_t pa;
+    {
+        AutoLock guard(p->get_cow().lock());
+
+        if (arch_mmu_query(arch_aspace, va, &pa, nullptr) < 0) {
+            return;
+        }
+        arch_mmu_unmap(arch_aspace, va, 1);
+        p->get_cow().remove_locked(va);
+    }
+
+    cow_release_page(paddr_to_vm_page(pa));
+}
+
+status_t cow_clone_page(proc *parent, proc *child, vaddr_t va) {
+    arch_aspace_t *from = &parent->get_aspace()->arch_aspace;
+    arch_aspace_t *to = &child->get_aspace()->arch_aspace;
+
+    AutoLock guard(parent->get_cow().lock());
+
+    paddr_t pa;
+    uint flags;
+    if (arch_mmu_query(from, va, &pa, &flags) < 0) {
+        // never committed, nothing to share
+        return NO_ERROR;
+    }
+
+    vm_page_t *page = paddr_to_vm_page(pa);
+    status_t err = cow_share_page(page);
+    if (err < 0) {
+        return err;
+    }
+
+    // from here on neither side may write the page without copying it first
+    bool cow = parent->get_cow().contains_locked(va);
+    if (!(flags & ARCH_MMU_FLAG_PERM_RO)) {
+        err = parent->get_cow().insert_locked(va);
+        if (err >= 0) {
+            arch_mmu_unmap(from, va, 1);
+            err = arch_mmu_map(from, va, pa, 1, flags | ARCH_MMU_FLAG_PERM_RO);
+        }
+        if (err < 0) {
+            cow_release_page(page);
+            return err;
+        }
+        cow = true;
+    }
+
+    err = arch_mmu_map(to, va, pa, 1, flags | ARCH_MMU_FLAG_PERM_RO);
+    if (err < 0) {
+        cow_release_page(page);
+        return err;
+    }
+
+    if (cow) {
+        AutoLock child_guard(child->get_cow().lock());
+        err = child->get_cow().insert_locked(va);
+    }
+
+    return err;
+}
+
+status_t cow_fault(proc *p, vaddr_t addr) {
+    const vaddr_t va = ROUNDDOWN(addr, PAGE_SIZE);
+    arch_aspace_t *arch_aspace = &p->get_aspace()->arch_aspace;
+
+    AutoLock guard(p->get_cow().lock());
+
+    if (!p->get_cow().contains_locked(va)) {
+        return ERR_NOT_FOUND;
+    }
+
+    paddr_t pa;
+    uint flags;
+    status_t err = arch_mmu_query(arch_aspace, va, &pa, &flags);
+    if (err < 0) {
+        p->get_cow().remove_locked(va);
+        return ERR_NOT_FOUND;
+    }
+    flags &= ~ARCH_MMU_FLAG_PERM_RO;
+
+    vm_page_t *page = paddr_to_vm_page(pa);
+    if (cow_page_shared(page)) {
+        LTRACEF("copying shared page at %#lx\n", va);
+
+        vm_page_t *copy = pmm_alloc_page();
+        if (!copy) {
+            return ERR_NO_MEMORY;
+        }
+        paddr_t copy_pa = vm_page_to_paddr(copy);
+        void *kva = paddr_to_kvaddr(copy_pa);
+        memcpy(kva, paddr_to_kvaddr(pa), PAGE_SIZE);
+        if (!(flags & ARCH_MMU_FLAG_PERM_NO_EXECUTE)) {
+            arch_sync_cache_range((addr_t)kva, PAGE_SIZE);
+        }
+
+        arch_mmu_unmap(arch_aspace, va, 1);
+        err = arch_mmu_map(arch_aspace, va, copy_pa, 1, flags);
+        if (err < 0) {
+            pmm_free_page(copy);
+            // put the shared page back so the fault can be retried
+            arch_mmu_map(arch_aspace, va, pa, 1, flags | ARCH_MMU_FLAG_PERM_RO);
+            return err;
+        }
+        cow_release_page(page);
+    } else {
+        // everyone else let go of it already, just make it writable
+        LTRACEF("reclaiming page at %#lx\n", va);
+
+        arch_mmu_unmap(arch_aspace, va, 1);
+        err = arch_mmu_map(arch_aspace, va, pa, 1, flags);
+        if (err < 0) {
+            return err;
+        }
+    }
+
+    p->get_cow().remove_locked(va);
+    return NO_ERROR;
+}
+
+} // namespace lkuser
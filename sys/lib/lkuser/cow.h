@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <sys/types.h>
+#include <lk/cpp.h>
+#include <lk/list.h>
+#include <kernel/mutex.h>
+#include <kernel/vm.h>
+
+namespace lkuser {
+
+class proc;
+
+// pages a process owns outright are freed by whichever region maps them. once
+// a process is cloned its private pages have more than one owner, tracked
+// here, and are only freed when the last one lets go.
+status_t cow_share_page(vm_page_t *page);
+void cow_release_page(vm_page_t *page);
+bool cow_page_shared(vm_page_t *page);
+
+// the pages of one process that are writable but mapped read only because
+// they may be shared with another process, so the first write takes a copy
+class cow_set {
+public:
+    cow_set();
+    ~cow_set();
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(cow_set);
+
+    // serializes copy on write faults against regions cloning or releasing
+    // pages, taken after any region lock
+    Mutex &lock() { return lock_; }
+
+    bool contains_locked(vaddr_t va) const;
+    status_t insert_locked(vaddr_t va);
+    bool remove_locked(vaddr_t va);
+
+    size_t count() const { return count_; }
+
+private:
+    static constexpr size_t bucket_count = 64;
+
+    struct entry {
+        list_node node;
+        vaddr_t va;
+    };
+
+    list_node &bucket(vaddr_t va) { return buckets_[(va / PAGE_SIZE) % bucket_count]; }
+    const list_node &bucket(vaddr_t va) const { return buckets_[(va / PAGE_SIZE) % bucket_count]; }
+
+    Mutex lock_;
+    list_node buckets_[bucket_count];
+    size_t count_ = 0;
+};
+
+// unmap the page at va and drop the process's ownership of it
+void release_user_page(proc *p, vaddr_t va);
+
+// make the page at va in parent shared with child at the same address. pages
+// mapped writable in the parent turn read only in both and copy on write.
+// called with the region lock held in the parent.
+status_t cow_clone_page(proc *parent, proc *child, vaddr_t va);
+
+// resolve a write fault on a copy on write page, ERR_NOT_FOUND if va is not one
+status_t cow_fault(proc *p, vaddr_t va);
+
+} // namespace lkuser
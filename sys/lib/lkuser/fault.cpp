@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdio.h>
+#include <lk/err.h>
+#include <lk/trace.h>
+#include <arch/ops.h>
+#include <kernel/vm.h>
+#include <lib/lkuser.h>
+#include <sys/lkuser_abi.h>
+
+#include "lkuser_priv.h"
+
+#define LOCAL_TRACE 0
+
+// lk's arm and riscv fault handlers treat every abort as fatal, so the
+// module links with --wrap on their entry points (see rules.mk) and sees each
+// fault first. page faults on user addresses go to lkuser_page_fault(), and
+// the access is retried if it maps the page. anything else carries on into
+// lk's own handler.
+//
+// interrupts taken from user code are also where a thread that never makes a
+// syscall finds out its process was killed, and on arm every way back to user
+// code puts the thread's TPIDRURO back.
+
+namespace {
+
+// exit code of a process killed by a fault it could not recover from
+constexpr int fault_exit_code = LKUSER_KILL_EXIT_BASE + 11;
+
+// faults in user mode always belong to the process. the kernel faults on
+// user addresses too when a syscall touches a buffer that is not paged in
+// yet, which is only safe to resolve if it was not holding a spinlock.
+bool try_user_fault(vaddr_t addr, uint flags, bool user, bool ints_were_enabled) {
+    if (!is_user_address(addr) || !tls_get(TLS_ENTRY_LKUSER)) {
+        return false;
+    }
+    if (!user && !ints_were_enabled) {
+        return false;
+    }
+
+    arch_enable_ints();
+    status_t err = lkuser_page_fault(addr, flags);
+    if (err >= 0 || !user) {
+        arch_disable_ints();
+        return err >= 0;
+    }
+
+    // nothing to map there, the process is at fault rather than the kernel
+    lkuser::proc *p = lkuser::get_lkuser_thread()->get_proc();
+    TRACEF("pid %u: %s fault at %#lx, killing it\n", p->get_pid(),
+           (flags & LKUSER_PF_FLAG_WRITE) ? "write" : (flags & LKUSER_PF_FLAG_EXEC) ? "exec" : "read", addr);
+    p->kill(fault_exit_code);
+    sys_exit(fault_exit_code);
+}
+
+// called on the way back to user code, with interrupts disabled
+void exit_if_killed() {
+    auto *t = (lkuser::thread *)tls_get(TLS_ENTRY_LKUSER);
+    int retcode;
+    if (t && t->get_proc()->kill_pending(&retcode)) {
+        arch_enable_ints();
+        sys_exit(retcode);
+    }
+}
+
+} // namespace
+
+#if ARCH_ARM
+#include <arch/arm.h>
+
+extern "C" void __real_arm_data_abort_handler(struct arm_fault_frame *frame);
+extern "C" void __real_arm_prefetch_abort_handler(struct arm_fault_frame *frame);
+extern "C" enum handler_return __real_platform_irq(struct arm_iframe *frame);
+
+namespace {
+
+constexpr uint32_t cpsr_mode_mask = 0x1f;
+constexpr uint32_t cpsr_mode_usr = 0x10;
+constexpr uint32_t cpsr_irq_mask = 1u << 7;
+
+// never a user address, so returning there lands in the prefetch abort
+// handler, which is a thread context that can exit
+constexpr uint32_t kill_trap_pc = 0;
+
+// translation and permission faults, at section or page level, in the
+// short descriptor fault status encoding
+bool arm_is_page_fault(uint32_t fsr) {
+    uint32_t status = ((fsr >> 6) & 0x10) | (fsr & 0xf);
+    switch (status) {
+        case 0b00101:
+        case 0b00111:
+        case 0b01101:
+        case 0b01111:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool arm_from_user(const struct arm_fault_frame *frame) {
+    return (frame->spsr & cpsr_mode_mask) == cpsr_mode_usr;
+}
+
+bool arm_ints_were_enabled(const struct arm_fault_frame *frame) {
+    return !(frame->spsr & cpsr_irq_mask);
+}
+
+// the fault may have blocked and let another process's thread run here
+void arm_restore_user_tls() {
+    auto *t = (lkuser::thread *)tls_get(TLS_ENTRY_LKUSER);
+    if (t) {
+        t->restore_user_tls();
+    }
+}
+
+} // namespace
+
+extern "C"
+void __wrap_arm_data_abort_handler(struct arm_fault_frame *frame) {
+    uint32_t fsr = arm_read_dfsr();
+    vaddr_t addr = arm_read_dfar();
+
+    if (arm_is_page_fault(fsr)) {
+        // WnR, set if the access was a write
+        uint flags = (fsr & (1u << 11)) ? LKUSER_PF_FLAG_WRITE : 0;
+        if (try_user_fault(addr, flags, arm_from_user(frame), arm_ints_were_enabled(frame))) {
+            if (arm_from_user(frame)) {
+                arm_restore_user_tls();
+            }
+            return;
+        }
+    }
+
+    __real_arm_data_abort_handler(frame);
+}
+
+extern "C"
+void __wrap_arm_prefetch_abort_handler(struct arm_fault_frame *frame) {
+    if (arm_from_user(frame)) {
+        exit_if_killed();
+    }
+
+    uint32_t fsr = arm_read_ifsr();
+    vaddr_t addr = arm_read_ifar();
+
+    if (arm_is_page_fault(fsr) &&
+        try_user_fault(addr, LKUSER_PF_FLAG_EXEC, arm_from_user(frame), arm_ints_were_enabled(frame))) {
+        if (arm_from_user(frame)) {
+            arm_restore_user_tls();
+        }
+        return;
+    }
+
+    __real_arm_prefetch_abort_handler(frame);
+}
+
+// the irq path cannot exit the thread itself, so a killed thread interrupted
+// in user code is sent to kill_trap_pc to do it. an interrupt from user code
+// is preempted here rather than by lk on the way out, so that TPIDRURO can be
+// put back once the thread runs again.
+extern "C"
+enum handler_return __wrap_platform_irq(struct arm_iframe *frame) {
+    enum handler_return ret = __real_platform_irq(frame);
+    if ((frame->spsr & cpsr_mode_mask) != cpsr_mode_usr) {
+        return ret;
+    }
+
+    if (ret == INT_RESCHEDULE) {
+        thread_preempt();
+        ret = INT_NO_RESCHEDULE;
+    }
+
+    auto *t = (lkuser::thread *)tls_get(TLS_ENTRY_LKUSER);
+    if (t) {
+        t->restore_user_tls();
+
+        int retcode;
+        if (t->get_proc()->kill_pending(&retcode)) {
+            frame->pc = kill_trap_pc;
+        }
+    }
+    return ret;
+}
+#endif
+
+#if ARCH_RISCV
+#include <arch/riscv.h>
+#include <arch/riscv/iframe.h>
+
+extern "C" void __real_riscv_exception_handler(long cause, ulong epc, struct riscv_short_iframe *frame,
+                                               bool kernel);
+
+namespace {
+
+// synchronous exception causes
+constexpr long riscv_cause_ins_page_fault = 12;
+constexpr long riscv_cause_load_page_fault = 13;
+constexpr long riscv_cause_store_page_fault = 15;
+
+} // namespace
+
+extern "C"
+void __wrap_riscv_exception_handler(long cause, ulong epc, struct riscv_short_iframe *frame,
+                                    bool kernel) {
+    uint flags;
+    switch (cause) {
+        case riscv_cause_ins_page_fault:
+            flags = LKUSER_PF_FLAG_EXEC;
+            break;
+        case riscv_cause_load_page_fault:
+            flags = 0;
+            break;
+        case riscv_cause_store_page_fault:
+            flags = LKUSER_PF_FLAG_WRITE;
+            break;
+        default:
+            // interrupts, syscalls and everything else
+            __real_riscv_exception_handler(cause, epc, frame, kernel);
+            if (cause < 0 && !kernel) {
+                exit_if_killed();
+            }
+            return;
+    }
+
+    // returning leaves epc on the faulting instruction, so it runs again
+    vaddr_t addr = riscv_csr_read(RISCV_CSR_XTVAL);
+    if (try_user_fault(addr, flags, !kernel, frame->status & RISCV_CSR_XSTATUS_PIE)) {
+        return;
+    }
+
+    __real_riscv_exception_handler(cause, epc, frame, kernel);
+}
+#endif
@@ -0,0 +1,388 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "fd.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <lk/err.h>
+#include <lk/trace.h>
+
+#include "console.h"
+#include "image.h"
+#include "poll.h"
+#include "proc.h"
+
+#define LOCAL_TRACE 0
+
+namespace lkuser {
+
+ssize_t console_file::read(char *buf, size_t len) {
+    return proc_->get_console_input().read(buf, len);
+}
+
+ssize_t console_file::write(const char *buf, size_t len) {
+    return console_write(buf, len);
+}
+
+uint32_t console_file::poll_events() {
+    uint32_t events = LKUSER_POLLOUT;
+    if (proc_->get_console_input().poll()) {
+        events |= LKUSER_POLLIN;
+    }
+    return events;
+}
+
+poll_source *console_file::get_poll_source() {
+    return console_input_source();
+}
+
+file *console_file::dup_for(proc *child) {
+    return new console_file(child);
+}
+
+status_t console_file::stat(lkuser_stat *st) {
+    st->mode = LKUSER_S_IFCHR;
+    st->size = 0;
+    return NO_ERROR;
+}
+
+pid_file::~pid_file() {
+    proc_->release();
+}
+
+ssize_t pid_file::read(char *buf, size_t len) {
+    if (len < sizeof(int)) {
+        return ERR_INVALID_ARGS;
+    }
+
+    proc_->wait();
+
+    int retcode = proc_->get_retcode();
+    memcpy(buf, &retcode, sizeof(retcode));
+    return sizeof(retcode);
+}
+
+status_t pid_file::stat(lkuser_stat *st) {
+    st->mode = 0;
+    st->size = 0;
+    return NO_ERROR;
+}
+
+uint32_t pid_file::poll_events() {
+    return proc_->exited() ? LKUSER_POLLIN : 0;
+}
+
+poll_source *pid_file::get_poll_source() {
+    return &proc_->get_exit_source();
+}
+
+status_t fs_file::open(const char *path, int flags, file **out) {
+    filehandle *handle;
+    status_t err = fs_open_file(path, &handle);
+    if (err >= 0) {
+        if (flags & LKUSER_O_CREAT && flags & LKUSER_O_EXCL) {
+            fs_close_file(handle);
+            return ERR_ALREADY_EXISTS;
+        }
+    } else if (err == ERR_NOT_FOUND && (flags & LKUSER_O_CREAT)) {
+        err = fs_create_file(path, &handle, 0);
+    }
+    if (err < 0) {
+        LTRACEF("error %d opening '%s'\n", err, path);
+        return err;
+    }
+
+    if ((flags & LKUSER_O_TRUNC) && (flags & LKUSER_O_ACCMODE) != LKUSER_O_RDONLY) {
+        err = fs_truncate_file(handle, 0);
+        if (err < 0) {
+            fs_close_file(handle);
+            return err;
+        }
+    }
+
+    // a cached copy of a binary can't be trusted once the file may change
+    if ((flags & LKUSER_O_ACCMODE) != LKUSER_O_RDONLY) {
+        image_cache_invalidate(path);
+    }
+
+    fs_file *f = new fs_file(handle, flags);
+    if (!f) {
+        fs_close_file(handle);
+        return ERR_NO_MEMORY;
+    }
+
+    *out = f;
+    return NO_ERROR;
+}
+
+fs_file::~fs_file() {
+    fs_close_file(handle_);
+    free(ra_buf_);
+}
+
+ssize_t fs_file::read(char *buf, size_t len) {
+    if ((flags_ & LKUSER_O_ACCMODE) == LKUSER_O_WRONLY) {
+        return ERR_ACCESS_DENIED;
+    }
+
+    AutoLock guard(lock_);
+
+    ssize_t ret = read_locked(buf, len);
+    if (ret > 0) {
+        offset_ += ret;
+        next_off_ = offset_;
+    }
+
+    return ret;
+}
+
+ssize_t fs_file::read_locked(char *buf, size_t len) {
+    off_t off = offset_;
+    size_t done = 0;
+
+    // serve whatever we can out of the read ahead buffer
+    if (ra_len_ > 0 && off >= ra_off_ && off < ra_off_ + (off_t)ra_len_) {
+        size_t n = MIN(len, (size_t)(ra_off_ + ra_len_ - off));
+        memcpy(buf, ra_buf_ + (off - ra_off_), n);
+        done += n;
+        off += n;
+        if (done == len) {
+            return done;
+        }
+    }
+
+    // grow the window while the file is read sequentially, drop it on a seek
+    if (off == next_off_ || done > 0) {
+        ra_window_ = ra_window_ ? MIN(ra_window_ * 2, (size_t)LKUSER_READAHEAD_MAX) : LKUSER_READAHEAD_MIN;
+    } else {
+        ra_window_ = 0;
+    }
+
+    size_t remaining = len - done;
+    if (ra_window_ == 0 || remaining >= ra_window_) {
+        // random or large reads go straight into the caller's buffer
+        ssize_t err = fs_read_file(handle_, buf + done, off, remaining);
+        if (err < 0) {
+            return done ? (ssize_t)done : err;
+        }
+        return done + err;
+    }
+
+    if (ra_buf_size_ < ra_window_) {
+        char *newbuf = (char *)realloc(ra_buf_, ra_window_);
+        if (!newbuf) {
+            // no memory for read ahead, fall back to a direct read
+            ra_window_ = 0;
+            ssize_t err = fs_read_file(handle_, buf + done, off, remaining);
+            return (err < 0) ? (done ? (ssize_t)done : err) : (ssize_t)(done + err);
+        }
+        ra_buf_ = newbuf;
+        ra_buf_size_ = ra_window_;
+    }
+
+    ssize_t err = fs_read_file(handle_, ra_buf_, off, ra_window_);
+    LTRACEF("read ahead %zu bytes at %lld returns %zd\n", ra_window_, (long long)off, err);
+    if (err < 0) {
+        ra_len_ = 0;
+        return done ? (ssize_t)done : err;
+    }
+
+    ra_off_ = off;
+    ra_len_ = err;
+
+    size_t n = MIN(remaining, ra_len_);
+    memcpy(buf + done, ra_buf_, n);
+    return done + n;
+}
+
+ssize_t fs_file::write(const char *buf, size_t len) {
+    if ((flags_ & LKUSER_O_ACCMODE) == LKUSER_O_RDONLY) {
+        return ERR_ACCESS_DENIED;
+    }
+
+    AutoLock guard(lock_);
+
+    if (flags_ & LKUSER_O_APPEND) {
+        file_stat st;
+        status_t err = fs_stat_file(handle_, &st);
+        if (err < 0) {
+            return err;
+        }
+        offset_ = st.size;
+    }
+
+    // anything buffered may now be stale
+    ra_len_ = 0;
+
+    ssize_t ret = fs_write_file(handle_, buf, offset_, len);
+    if (ret > 0) {
+        offset_ += ret;
+    }
+
+    return ret;
+}
+
+off_t fs_file::seek(off_t pos, int whence) {
+    AutoLock guard(lock_);
+
+    off_t base;
+    switch (whence) {
+        case LKUSER_SEEK_SET:
+            base = 0;
+            break;
+        case LKUSER_SEEK_CUR:
+            base = offset_;
+            break;
+        case LKUSER_SEEK_END: {
+            file_stat st;
+            status_t err = fs_stat_file(handle_, &st);
+            if (err < 0) {
+                return err;
+            }
+            base = st.size;
+            break;
+        }
+        default:
+            return ERR_INVALID_ARGS;
+    }
+
+    if (base + pos < 0) {
+        return ERR_INVALID_ARGS;
+    }
+
+    offset_ = base + pos;
+    return offset_;
+}
+
+ssize_t fs_file::pread(char *buf, size_t len, off_t off) {
+    if ((flags_ & LKUSER_O_ACCMODE) == LKUSER_O_WRONLY) {
+        return ERR_ACCESS_DENIED;
+    }
+
+    return fs_read_file(handle_, buf, off, len);
+}
+
+status_t fs_file::stat(lkuser_stat *st) {
+    file_stat fst;
+    status_t err = fs_stat_file(handle_, &fst);
+    if (err < 0) {
+        return err;
+    }
+
+    st->mode = fst.is_dir ? LKUSER_S_IFDIR : LKUSER_S_IFREG;
+    st->size = fst.size;
+    return NO_ERROR;
+}
+
+fd_table::~fd_table() {
+    close_all();
+}
+
+status_t fd_table::init_console(proc *p) {
+    console_file *f = new console_file(p);
+    if (!f) {
+        return ERR_NO_MEMORY;
+    }
+
+    AutoLock guard(lock_);
+
+    // one reference for each of stdin, stdout and stderr
+    f->acquire();
+    f->acquire();
+    files_[0] = files_[1] = files_[2] = f;
+
+    return NO_ERROR;
+}
+
+int fd_table::install(file *f) {
+    AutoLock guard(lock_);
+
+    for (int fd = 0; fd < LKUSER_MAX_FDS; fd++) {
+        if (!files_[fd]) {
+            files_[fd] = f;
+            return fd;
+        }
+    }
+
+    return ERR_NO_RESOURCES;
+}
+
+file *fd_table::get(int fd) {
+    if (fd < 0 || fd >= LKUSER_MAX_FDS) {
+        return nullptr;
+    }
+
+    AutoLock guard(lock_);
+
+    file *f = files_[fd];
+    if (f) {
+        f->acquire();
+    }
+    return f;
+}
+
+status_t fd_table::close(int fd) {
+    if (fd < 0 || fd >= LKUSER_MAX_FDS) {
+        return ERR_BAD_HANDLE;
+    }
+
+    file *f;
+    {
+        AutoLock guard(lock_);
+        f = files_[fd];
+        files_[fd] = nullptr;
+    }
+
+    if (!f) {
+        return ERR_BAD_HANDLE;
+    }
+
+    f->release();
+    return NO_ERROR;
+}
+
+void fd_table::close_all() {
+    for (int fd = 0; fd < LKUSER_MAX_FDS; fd++) {
+        close(fd);
+    }
+}
+
+status_t fd_table::clone(proc *child, fd_table &to) {
+    to.close_all();
+
+    AutoLock guard(lock_);
+    AutoLock to_guard(to.lock_);
+
+    for (int fd = 0; fd < LKUSER_MAX_FDS; fd++) {
+        if (files_[fd]) {
+            to.files_[fd] = files_[fd]->dup_for(child);
+            if (!to.files_[fd]) {
+                return ERR_NO_MEMORY;
+            }
+        }
+    }
+
+    return NO_ERROR;
+}
+
+} // namespace lkuser
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <sys/types.h>
+#include <lk/cpp.h>
+#include <lk/err.h>
+#include <lib/fs.h>
+#include <kernel/mutex.h>
+#include <sys/lkuser_abi.h>
+
+namespace lkuser {
+
+class epoll_file;
+class poll_source;
+class proc;
+class shm_object;
+class timer_file;
+
+// size of each process's file descriptor table
+#ifndef LKUSER_MAX_FDS
+#define LKUSER_MAX_FDS 64
+#endif
+
+// bounds of the adaptive read ahead window of a file
+#ifndef LKUSER_READAHEAD_MIN
+#define LKUSER_READAHEAD_MIN (4 * 1024)
+#endif
+#ifndef LKUSER_READAHEAD_MAX
+#define LKUSER_READAHEAD_MAX (64 * 1024)
+#endif
+
+// an open file, possibly shared by several descriptors
+class file {
+public:
+    virtual ~file() = default;
+
+    virtual ssize_t read(char *buf, size_t len) { return ERR_NOT_SUPPORTED; }
+    virtual ssize_t write(const char *buf, size_t len) { return ERR_NOT_SUPPORTED; }
+    virtual off_t seek(off_t pos, int whence) { return ERR_NOT_SUPPORTED; }
+    // positioned read that leaves the file offset alone
+    virtual ssize_t pread(char *buf, size_t len, off_t off) { return ERR_NOT_SUPPORTED; }
+    virtual status_t stat(lkuser_stat *st) = 0;
+
+    // the LKUSER_POLL* events that are ready right now
+    virtual uint32_t poll_events() { return LKUSER_POLLIN | LKUSER_POLLOUT; }
+    // where changes in readiness are announced, null for a file that is
+    // always ready
+    virtual poll_source *get_poll_source() { return nullptr; }
+
+    // the timer, interest set or shared memory behind a descriptor, null for
+    // any other kind of file
+    virtual timer_file *as_timer() { return nullptr; }
+    virtual epoll_file *as_epoll() { return nullptr; }
+    virtual shm_object *as_shm() { return nullptr; }
+
+    // the file to install in a clone of the process, by default this one,
+    // shared along with its offset
+    virtual file *dup_for(proc *child) {
+        acquire();
+        return this;
+    }
+
+    void acquire() { __atomic_fetch_add(&ref_, 1, __ATOMIC_RELAXED); }
+    void release() {
+        if (__atomic_sub_fetch(&ref_, 1, __ATOMIC_ACQ_REL) == 0) {
+            delete this;
+        }
+    }
+
+protected:
+    file() = default;
+
+private:
+    int ref_ = 1;
+};
+
+// the console, backing the standard descriptors
+class console_file final : public file {
+public:
+    explicit console_file(proc *p) : proc_(p) {}
+
+    ssize_t read(char *buf, size_t len) override;
+    ssize_t write(const char *buf, size_t len) override;
+    status_t stat(lkuser_stat *st) override;
+    uint32_t poll_events() override;
+    poll_source *get_poll_source() override;
+    // a clone reads its own console input
+    file *dup_for(proc *child) override;
+
+private:
+    proc *proc_;
+};
+
+// a file on one of the lib/fs file systems
+class fs_file final : public file {
+private:
+    fs_file(filehandle *handle, int flags) : handle_(handle), flags_(flags) {}
+
+public:
+    ~fs_file() override;
+
+    static status_t open(const char *path, int flags, file **out);
+
+    ssize_t read(char *buf, size_t len) override;
+    ssize_t write(const char *buf, size_t len) override;
+    off_t seek(off_t pos, int whence) override;
+    ssize_t pread(char *buf, size_t len, off_t off) override;
+    status_t stat(lkuser_stat *st) override;
+
+private:
+    ssize_t read_locked(char *buf, size_t len);
+
+    Mutex lock_;
+    filehandle *handle_;
+    int flags_;
+    off_t offset_ = 0;
+
+    // read ahead state: the buffered range, the current window, and where the
+    // last read ended so that sequential access can be detected
+    char *ra_buf_ = nullptr;
+    size_t ra_buf_size_ = 0;
+    off_t ra_off_ = 0;
+    size_t ra_len_ = 0;
+    size_t ra_window_ = 0;
+    off_t next_off_ = 0;
+};
+
+// a process, so that its exit can be waited for along with other descriptors
+class pid_file final : public file {
+public:
+    // takes over the caller's reference to p
+    explicit pid_file(proc *p) : proc_(p) {}
+    ~pid_file() override;
+
+    // wait for the process to exit and return its exit code as an int
+    ssize_t read(char *buf, size_t len) override;
+    status_t stat(lkuser_stat *st) override;
+    uint32_t poll_events() override;
+    poll_source *get_poll_source() override;
+
+private:
+    proc *proc_;
+};
+
+// per process table of open files
+class fd_table {
+public:
+    fd_table() = default;
+    ~fd_table();
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(fd_table);
+
+    // install the console on descriptors 0 through 2
+    status_t init_console(proc *p);
+
+    // install a file in the lowest free slot, consuming the caller's reference
+    int install(file *f);
+
+    // look up a descriptor, returning a referenced file or null
+    file *get(int fd);
+
+    status_t close(int fd);
+    void close_all();
+
+    // replace the contents of to with the files of this table, for a clone
+    status_t clone(proc *child, fd_table &to);
+
+private:
+    Mutex lock_;
+    file *files_[LKUSER_MAX_FDS] {};
+};
+
+} // namespace lkuser
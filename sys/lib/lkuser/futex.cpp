@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "futex.h"
+
+#include <lk/err.h>
+#include <lk/list.h>
+#include <lk/trace.h>
+#include <kernel/event.h>
+#include <kernel/mutex.h>
+#include <kernel/vm.h>
+
+#include "proc.h"
+#include "thread.h"
+
+#define LOCAL_TRACE 0
+
+namespace lkuser {
+
+namespace {
+
+// waiters hash by address into a fixed set of buckets, each with its own lock
+// so unrelated futexes do not contend
+constexpr size_t futex_bucket_count = 64;
+
+// a futex is named by its aspace and address, or for words in shared memory
+// by a null aspace and the physical address
+struct futex_key {
+    vmm_aspace_t *aspace;
+    uintptr_t addr;
+
+    bool operator==(const futex_key &other) const {
+        return aspace == other.aspace && addr == other.addr;
+    }
+    bool operator!=(const futex_key &other) const { return !(*this == other); }
+};
+
+futex_key key_for(proc *p, vaddr_t addr) {
+    paddr_t pa;
+    if (p->get_mappings().shared_paddr(addr, &pa)) {
+        return { nullptr, (uintptr_t)pa };
+    }
+    return { p->get_aspace(), addr };
+}
+
+struct futex_waiter {
+    list_node node;
+    futex_key key;
+    bool woken;
+    event_t event;
+};
+
+struct futex_bucket {
+    Mutex lock;
+    list_node waiters = LIST_INITIAL_VALUE(waiters);
+};
+
+futex_bucket buckets[futex_bucket_count];
+
+futex_bucket &bucket_for(const futex_key &key) {
+    uintptr_t hash = (key.addr >> 2) ^ ((uintptr_t)key.aspace >> 6);
+    hash ^= hash >> 11;
+    return buckets[hash % futex_bucket_count];
+}
+
+} // namespace
+
+status_t futex_wait(proc *p, vaddr_t addr, int value, lk_time_t timeout) {
+    LTRACEF("addr %#lx, value %d, timeout %u\n", addr, value, timeout);
+
+    if (!IS_ALIGNED(addr, sizeof(int))) {
+        return ERR_INVALID_ARGS;
+    }
+
+    futex_waiter w;
+    w.key = key_for(p, addr);
+    futex_bucket &b = bucket_for(w.key);
+
+    w.woken = false;
+    event_init(&w.event, false, 0);
+
+    {
+        // checking the word and queueing under the bucket lock closes the
+        // window against a waker that changes it and then calls futex_wake
+        AutoLock guard(b.lock);
+
+        if (__atomic_load_n((const volatile int *)addr, __ATOMIC_SEQ_CST) != value) {
+            event_destroy(&w.event);
+            return ERR_NOT_READY;
+        }
+
+        list_add_tail(&b.waiters, &w.node);
+    }
+
+    status_t err = killable_wait(&w.event, timeout);
+
+    {
+        AutoLock guard(b.lock);
+
+        // a wake that raced with the timeout still counts as a wake
+        if (w.woken) {
+            err = NO_ERROR;
+        } else {
+            list_delete(&w.node);
+        }
+    }
+
+    event_destroy(&w.event);
+
+    return err;
+}
+
+int futex_wake(proc *p, vaddr_t addr, int count) {
+    LTRACEF("addr %#lx, count %d\n", addr, count);
+
+    const futex_key key = key_for(p, addr);
+    futex_bucket &b = bucket_for(key);
+
+    int woken = 0;
+    AutoLock guard(b.lock);
+
+    futex_waiter *w, *temp;
+    list_for_every_entry_safe(&b.waiters, w, temp, futex_waiter, node) {
+        if (woken >= count) {
+            break;
+        }
+        if (w->key != key) {
+            continue;
+        }
+
+        list_delete(&w->node);
+        w->woken = true;
+        event_signal(&w->event, false);
+        woken++;
+    }
+
+    return woken;
+}
+
+} // namespace lkuser
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "heap.h"
+
+#include <string.h>
+#include <lk/err.h>
+#include <lk/trace.h>
+#include <kernel/vm.h>
+
+#include "cow.h"
+#include "proc.h"
+
+#define LOCAL_TRACE 0
+
+namespace lkuser {
+
+status_t heap::init(proc *p, vaddr_t base, size_t limit) {
+    DEBUG_ASSERT(IS_PAGE_ALIGNED(base));
+
+    limit = ROUNDUP(limit, PAGE_SIZE);
+
+    status_t err = vmm_reserve_space(p->get_aspace(), "heap", limit, base);
+    LTRACEF("reserving %#zx bytes at %#lx returns %d\n", limit, base, err);
+    if (err < 0) {
+        return err;
+    }
+
+    AutoLock guard(lock_);
+
+    base_ = brk_ = committed_top_ = base;
+    limit_ = limit;
+
+    return NO_ERROR;
+}
+
+void *heap::sbrk(proc *p, long incr) {
+    AutoLock guard(lock_);
+
+    LTRACEF("incr %ld, brk %#lx, committed top %#lx\n", incr, brk_, committed_top_);
+
+    if (!base_) {
+        return NULL;
+    }
+
+    const vaddr_t old_brk = brk_;
+    if (incr == 0) {
+        return (void *)old_brk;
+    }
+
+    if (incr > 0 ? (size_t)incr > base_ + limit_ - brk_ : (size_t)-incr > brk_ - base_) {
+        return NULL;
+    }
+
+    const vaddr_t new_brk = brk_ + incr;
+    const vaddr_t top = ROUNDUP(new_brk, PAGE_SIZE);
+    if (top > committed_top_) {
+        if (commit_locked(p, top) < 0) {
+            return NULL;
+        }
+    } else if (top < committed_top_) {
+        release_locked(p, top);
+    }
+
+    brk_ = new_brk;
+    return (void *)old_brk;
+}
+
+status_t heap::commit_locked(proc *p, vaddr_t top) {
+    arch_aspace_t *arch_aspace = &p->get_aspace()->arch_aspace;
+    const vaddr_t old_top = committed_top_;
+
+    while (committed_top_ < top) {
+        vm_page_t *page = pmm_alloc_page();
+        if (!page) {
+            release_locked(p, old_top);
+            return ERR_NO_MEMORY;
+        }
+
+        paddr_t pa = vm_page_to_paddr(page);
+        memset(paddr_to_kvaddr(pa), 0, PAGE_SIZE);
+
+        status_t err = arch_mmu_map(arch_aspace, committed_top_, pa, 1,
+                                    ARCH_MMU_FLAG_PERM_USER | ARCH_MMU_FLAG_PERM_NO_EXECUTE);
+        if (err < 0) {
+            pmm_free_page(page);
+            release_locked(p, old_top);
+            return err;
+        }
+
+        committed_pages_++;
+        committed_top_ += PAGE_SIZE;
+    }
+
+    return NO_ERROR;
+}
+
+void heap::release_locked(proc *p, vaddr_t top) {
+    arch_aspace_t *arch_aspace = &p->get_aspace()->arch_aspace;
+
+    while (committed_top_ > top) {
+        const vaddr_t va = committed_top_ - PAGE_SIZE;
+
+        if (arch_mmu_query(arch_aspace, va, nullptr, nullptr) >= 0) {
+            release_user_page(p, va);
+            committed_pages_--;
+        }
+
+        committed_top_ = va;
+    }
+}
+
+status_t heap::clone(proc *p, proc *child, heap &to) {
+    AutoLock guard(lock_);
+
+    if (!base_) {
+        return NO_ERROR;
+    }
+
+    status_t err = to.init(child, base_, limit_);
+    if (err < 0) {
+        return err;
+    }
+
+    AutoLock to_guard(to.lock_);
+
+    for (vaddr_t va = base_; va < committed_top_; va += PAGE_SIZE) {
+        err = cow_clone_page(p, child, va);
+        if (err < 0) {
+            return err;
+        }
+        to.committed_top_ = va + PAGE_SIZE;
+        to.committed_pages_++;
+    }
+    to.brk_ = brk_;
+
+    return NO_ERROR;
+}
+
+void heap::clear(proc *p) {
+    AutoLock guard(lock_);
+
+    release_locked(p, base_);
+}
+
+} // namespace lkuser
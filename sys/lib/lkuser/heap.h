@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <sys/types.h>
+#include <lk/cpp.h>
+#include <kernel/mutex.h>
+#include <kernel/vm.h>
+
+namespace lkuser {
+
+class proc;
+
+// default limit on the size of a process's heap, and so the size of the
+// virtual range reserved for it
+#ifndef LKUSER_HEAP_LIMIT
+#define LKUSER_HEAP_LIMIT (16 * 1024 * 1024)
+#endif
+
+// the sbrk heap of a process: a virtual range reserved up front, with pages
+// committed and released as the break moves
+class heap {
+public:
+    heap() = default;
+    ~heap() = default;
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(heap);
+
+    // reserve limit bytes of address space at base
+    status_t init(proc *p, vaddr_t base, size_t limit);
+
+    // move the break by incr bytes, returning the old break or null if the
+    // heap would go past its limit or below its base
+    void *sbrk(proc *p, long incr);
+
+    size_t get_committed() const { return committed_pages_ * PAGE_SIZE; }
+    vaddr_t get_end() const { return base_ + limit_; }
+
+    // set up to as a copy on write clone of this heap in child
+    status_t clone(proc *p, proc *child, heap &to);
+
+    // give back every page, before the address space goes away
+    void clear(proc *p);
+
+private:
+    status_t commit_locked(proc *p, vaddr_t top);
+    void release_locked(proc *p, vaddr_t top);
+
+    Mutex lock_;
+    vaddr_t base_ = 0;
+    vaddr_t brk_ = 0;
+    vaddr_t committed_top_ = 0;
+    size_t limit_ = 0;
+
+    size_t committed_pages_ = 0;
+};
+
+} // namespace lkuser
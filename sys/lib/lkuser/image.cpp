@@ -0,0 +1,689 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "image.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lib/elf.h>
+#include <lib/lkuser.h>
+#include <lk/err.h>
+#include <lk/trace.h>
+#include <arch/ops.h>
+
+#include "cow.h"
+#include "lkuser_priv.h"
+
+#define LOCAL_TRACE 0
+
+// sanity limit on the number of program headers read out of a binary
+#define MAX_PHDRS 32
+
+namespace lkuser {
+
+namespace {
+
+// cached images, most recently used at the head
+list_node image_list = LIST_INITIAL_VALUE(image_list);
+Mutex image_list_lock;
+
+size_t cache_budget = LKUSER_IMAGE_CACHE_BUDGET;
+
+struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t invalidations;
+    uint64_t bytes_read;    // read from the file system to fill pages
+    size_t bytes_cached;    // held in the pages of all images
+} cache_stats;
+
+status_t read_headers(filehandle *file, elf_ehdr_t *ehdr, elf_phdr_t **phdrs_out) {
+    ssize_t err = fs_read_file(file, ehdr, 0, sizeof(*ehdr));
+    if (err < (ssize_t)sizeof(*ehdr)) {
+        return (err < 0) ? err : ERR_NOT_VALID;
+    }
+
+    if (memcmp(ehdr->e_ident, "\x7f" "ELF", 4) != 0 ||
+        ehdr->e_phentsize != sizeof(elf_phdr_t) ||
+        ehdr->e_phnum == 0 || ehdr->e_phnum > MAX_PHDRS) {
+        LTRACEF("bad elf header\n");
+        return ERR_NOT_VALID;
+    }
+
+    const size_t phdrs_size = ehdr->e_phnum * sizeof(elf_phdr_t);
+    elf_phdr_t *phdrs = (elf_phdr_t *)malloc(phdrs_size);
+    if (!phdrs) {
+        return ERR_NO_MEMORY;
+    }
+
+    err = fs_read_file(file, phdrs, ehdr->e_phoff, phdrs_size);
+    if (err < (ssize_t)phdrs_size) {
+        free(phdrs);
+        return (err < 0) ? err : ERR_NOT_VALID;
+    }
+
+    *phdrs_out = phdrs;
+    return NO_ERROR;
+}
+
+} // namespace
+
+elf_image::~elf_image() {
+    LTRACEF("destroying image %p '%s', %zu pages\n", this, path_, pages_);
+
+    __atomic_fetch_sub(&cache_stats.bytes_cached, pages_ * PAGE_SIZE, __ATOMIC_RELAXED);
+
+    for (size_t i = 0; i < segment_count_; i++) {
+        const segment &s = segments_[i];
+        for (size_t j = 0; j < s.size / PAGE_SIZE; j++) {
+            if (s.pages[j]) {
+                pmm_free_page(s.pages[j]);
+            }
+        }
+        free(s.pages);
+    }
+    free(segments_);
+    if (file_) {
+        fs_close_file(file_);
+    }
+    free(path_);
+}
+
+elf_image *elf_image::lookup_locked(const char *path, list_node *victims) {
+    elf_image *img;
+    list_for_every_entry(&image_list, img, elf_image, node) {
+        if (strcmp(img->path_, path)) {
+            continue;
+        }
+
+        // the only change we can spot without reading the file is its size
+        file_stat st;
+        if (fs_stat_file(img->file_, &st) >= 0 && st.size == img->file_size_) {
+            LTRACEF("cache hit on image %p for '%s'\n", img, path);
+            img->ref_++;
+            list_delete(&img->node);
+            list_add_head(&image_list, &img->node);
+            return img;
+        }
+
+        img->invalidate_locked();
+        if (img->ref_ == 0) {
+            list_add_tail(victims, &img->node);
+        }
+        break;
+    }
+
+    return nullptr;
+}
+
+status_t elf_image::get(const char *path, elf_image **out) {
+    list_node victims = LIST_INITIAL_VALUE(victims);
+
+    {
+        AutoLock guard(image_list_lock);
+
+        elf_image *img = lookup_locked(path, &victims);
+        if (img) {
+            cache_stats.hits++;
+            *out = img;
+            return NO_ERROR;
+        }
+
+        cache_stats.misses++;
+    }
+    destroy_list(&victims);
+
+    // read the headers without holding the list lock, so a cold launch does
+    // not hold up launches of other binaries, or warm ones of this one
+    filehandle *file;
+    status_t err = fs_open_file(path, &file);
+    if (err < 0) {
+        TRACEF("failed to open file %s\n", path);
+        return err;
+    }
+
+    elf_image *img;
+    file_stat st;
+    err = fs_stat_file(file, &st);
+    if (err >= 0) {
+        err = create(path, file, st.size, &img);
+    }
+    if (err < 0) {
+        fs_close_file(file);
+        return err;
+    }
+
+    {
+        AutoLock guard(image_list_lock);
+
+        // someone may have loaded the same binary in the meantime, share
+        // theirs and throw ours away
+        elf_image *existing = lookup_locked(path, &victims);
+        if (existing) {
+            list_add_tail(&victims, &img->node);
+            img = existing;
+        } else {
+            img->cached_ = true;
+            list_add_head(&image_list, &img->node);
+            trim_locked(&victims);
+        }
+        *out = img;
+    }
+
+    destroy_list(&victims);
+    return NO_ERROR;
+}
+
+void elf_image::invalidate_locked() {
+    DEBUG_ASSERT(cached_);
+
+    list_delete(&node);
+    cached_ = false;
+    cache_stats.invalidations++;
+}
+
+void elf_image::trim_locked(list_node *victims) {
+    while (cache_stats.bytes_cached > cache_budget) {
+        // find the least recently used image no one is running
+        elf_image *lru = nullptr;
+        elf_image *img;
+        list_for_every_entry(&image_list, img, elf_image, node) {
+            if (img->ref_ == 0) {
+                lru = img;
+            }
+        }
+        if (!lru) {
+            break;
+        }
+
+        LTRACEF("evicting image %p '%s'\n", lru, lru->path_);
+        list_delete(&lru->node);
+        lru->cached_ = false;
+        list_add_tail(victims, &lru->node);
+        cache_stats.evictions++;
+
+        // the pages are given back in the destructor, account for them now
+        __atomic_fetch_sub(&cache_stats.bytes_cached, lru->pages_ * PAGE_SIZE, __ATOMIC_RELAXED);
+        lru->pages_ = 0;
+    }
+}
+
+void elf_image::destroy_list(list_node *victims) {
+    elf_image *img;
+    while ((img = list_remove_head_type(victims, elf_image, node))) {
+        delete img;
+    }
+}
+
+status_t elf_image::create(const char *path, filehandle *file, uint64_t file_size, elf_image **out) {
+    elf_ehdr_t ehdr;
+    elf_phdr_t *phdrs;
+    status_t err = read_headers(file, &ehdr, &phdrs);
+    if (err < 0) {
+        return err;
+    }
+
+    elf_image *img = new elf_image;
+    segment *segs = (segment *)calloc(ehdr.e_phnum, sizeof(segment));
+    char *path_copy = strdup(path);
+    if (!img || !segs || !path_copy) {
+        free(phdrs);
+        delete img;
+        free(segs);
+        free(path_copy);
+        return ERR_NO_MEMORY;
+    }
+    img->segments_ = segs;
+    img->path_ = path_copy;
+    img->file_size_ = file_size;
+    img->entry_ = ehdr.e_entry;
+
+    for (uint i = 0; i < ehdr.e_phnum; i++) {
+        const elf_phdr_t &ph = phdrs[i];
+        if (ph.p_type == PT_GNU_STACK && ph.p_memsz) {
+            // set by linking with -z stack-size
+            img->stack_size_ = MIN(ROUNDUP(ph.p_memsz, PAGE_SIZE), (size_t)LKUSER_STACK_MAX);
+            continue;
+        }
+        if (ph.p_type != PT_LOAD || ph.p_memsz == 0) {
+            continue;
+        }
+        if (ph.p_filesz > ph.p_memsz || ph.p_vaddr + ph.p_memsz < ph.p_vaddr) {
+            err = ERR_NOT_VALID;
+            break;
+        }
+
+        segment &s = segs[img->segment_count_];
+        s.base = ROUNDDOWN(ph.p_vaddr, PAGE_SIZE);
+        s.size = ROUNDUP(ph.p_vaddr + ph.p_memsz, PAGE_SIZE) - s.base;
+        s.vaddr = ph.p_vaddr;
+        s.offset = ph.p_offset;
+        s.file_size = ph.p_filesz;
+        s.writable = ph.p_flags & PF_W;
+        s.mmu_flags = ARCH_MMU_FLAG_PERM_USER;
+        if (!s.writable) {
+            s.mmu_flags |= ARCH_MMU_FLAG_PERM_RO;
+        }
+        if (!(ph.p_flags & PF_X)) {
+            s.mmu_flags |= ARCH_MMU_FLAG_PERM_NO_EXECUTE;
+        }
+        s.pages = (vm_page_t **)calloc(s.size / PAGE_SIZE, sizeof(vm_page_t *));
+        if (!s.pages) {
+            err = ERR_NO_MEMORY;
+            break;
+        }
+        img->segment_count_++;
+    }
+    free(phdrs);
+
+    if (err >= 0 && img->segment_count_ == 0) {
+        err = ERR_NOT_VALID;
+    }
+    if (err < 0) {
+        delete img;
+        return err;
+    }
+
+    // the file now belongs to the image
+    img->file_ = file;
+    *out = img;
+    return NO_ERROR;
+}
+
+void elf_image::acquire() {
+    AutoLock guard(image_list_lock);
+    ref_++;
+}
+
+void elf_image::release() {
+    list_node victims = LIST_INITIAL_VALUE(victims);
+
+    {
+        AutoLock guard(image_list_lock);
+        if (--ref_ > 0) {
+            return;
+        }
+
+        // keep it around for the next launch if it is still valid
+        if (cached_) {
+            trim_locked(&victims);
+        } else {
+            list_add_tail(&victims, &node);
+        }
+    }
+
+    destroy_list(&victims);
+}
+
+const elf_image::segment *elf_image::find_segment(vaddr_t addr) const {
+    for (size_t i = 0; i < segment_count_; i++) {
+        const segment &s = segments_[i];
+        if (addr >= s.base && addr - s.base < s.size) {
+            return &s;
+        }
+    }
+    return nullptr;
+}
+
+vaddr_t elf_image::get_end() const {
+    vaddr_t end = 0;
+    for (size_t i = 0; i < segment_count_; i++) {
+        end = MAX(end, segments_[i].base + segments_[i].size);
+    }
+    return end;
+}
+
+vm_page_t *elf_image::peek_page(const segment &s, size_t index) {
+    AutoLock guard(lock_);
+    return s.pages[index];
+}
+
+status_t elf_image::get_page(const segment &s, size_t index, vm_page_t **out) {
+    AutoLock guard(lock_);
+
+    if (s.pages[index]) {
+        *out = s.pages[index];
+        return NO_ERROR;
+    }
+
+    const vaddr_t va = s.base + index * PAGE_SIZE;
+    const vaddr_t file_start = MAX(va, s.vaddr);
+    const vaddr_t file_end = MIN(va + PAGE_SIZE, s.vaddr + s.file_size);
+
+    // private zero pages are cheaper than sharing one through copy on write
+    if (s.writable && file_start >= file_end) {
+        *out = nullptr;
+        return NO_ERROR;
+    }
+
+    vm_page_t *page = pmm_alloc_page();
+    if (!page) {
+        return ERR_NO_MEMORY;
+    }
+    uint8_t *kva = (uint8_t *)paddr_to_kvaddr(vm_page_to_paddr(page));
+
+    // copy the part of the page backed by the file, zero the rest
+    memset(kva, 0, PAGE_SIZE);
+    if (file_start < file_end) {
+        ssize_t err = fs_read_file(file_, kva + (file_start - va),
+                                   s.offset + (file_start - s.vaddr), file_end - file_start);
+        if (err < 0) {
+            pmm_free_page(page);
+            return err;
+        }
+        __atomic_fetch_add(&cache_stats.bytes_read, (uint64_t)err, __ATOMIC_RELAXED);
+    }
+
+    if (!(s.mmu_flags & ARCH_MMU_FLAG_PERM_NO_EXECUTE)) {
+        arch_sync_cache_range((addr_t)kva, PAGE_SIZE);
+    }
+
+    s.pages[index] = page;
+    pages_++;
+    __atomic_fetch_add(&cache_stats.bytes_cached, (size_t)PAGE_SIZE, __ATOMIC_RELAXED);
+
+    *out = page;
+    return NO_ERROR;
+}
+
+image_mapping::~image_mapping() {
+    // the private copies were given back by clear()
+    image_->release();
+}
+
+status_t image_mapping::reserve(proc *p, elf_image *img) {
+    for (size_t i = 0; i < img->get_segment_count(); i++) {
+        const elf_image::segment &s = img->get_segment(i);
+
+        char name[16];
+        snprintf(name, sizeof(name), "lkuser%zu", i);
+
+        LTRACEF("reserving segment %zu: base %#lx size %#zx\n", i, s.base, s.size);
+        status_t err = vmm_reserve_space(p->get_aspace(), name, s.size, s.base);
+        if (err < 0) {
+            return err;
+        }
+    }
+
+    return NO_ERROR;
+}
+
+status_t image_mapping::create(proc *p, elf_image *img, bool lazy, image_mapping **out) {
+    image_mapping *m = new image_mapping(img);
+    if (!m) {
+        img->release();
+        return ERR_NO_MEMORY;
+    }
+
+    status_t err = reserve(p, img);
+
+    if (err >= 0 && !lazy) {
+        AutoLock guard(m->lock_);
+
+        for (size_t i = 0; i < img->get_segment_count() && err >= 0; i++) {
+            const elf_image::segment &s = img->get_segment(i);
+            for (vaddr_t va = s.base; va < s.base + s.size && err >= 0; va += PAGE_SIZE) {
+                err = m->map_page_locked(p, s, va, s.writable);
+            }
+        }
+    }
+
+    if (err < 0) {
+        // the private pages mapped so far are ours to free, any reservations
+        // are torn down along with the address space
+        m->clear(p);
+        delete m;
+        return err;
+    }
+
+    *out = m;
+    return NO_ERROR;
+}
+
+status_t image_mapping::map_page_locked(proc *p, const elf_image::segment &s, vaddr_t va, bool write) {
+    arch_aspace_t *arch_aspace = &p->get_aspace()->arch_aspace;
+
+    vm_page_t *shared;
+    status_t err = image_->get_page(s, (va - s.base) / PAGE_SIZE, &shared);
+    if (err < 0) {
+        return err;
+    }
+
+    // read only segments, and reads of writable ones, use the image's page
+    if (shared && (!s.writable || !write)) {
+        err = arch_mmu_map(arch_aspace, va, vm_page_to_paddr(shared), 1, s.mmu_flags | ARCH_MMU_FLAG_PERM_RO);
+        if (err < 0) {
+            return err;
+        }
+        mapped_pages_++;
+        return NO_ERROR;
+    }
+
+    vm_page_t *page = pmm_alloc_page();
+    if (!page) {
+        return ERR_NO_MEMORY;
+    }
+    void *kva = paddr_to_kvaddr(vm_page_to_paddr(page));
+    if (shared) {
+        memcpy(kva, paddr_to_kvaddr(vm_page_to_paddr(shared)), PAGE_SIZE);
+    } else {
+        memset(kva, 0, PAGE_SIZE);
+    }
+    if (!(s.mmu_flags & ARCH_MMU_FLAG_PERM_NO_EXECUTE)) {
+        arch_sync_cache_range((addr_t)kva, PAGE_SIZE);
+    }
+
+    err = arch_mmu_map(arch_aspace, va, vm_page_to_paddr(page), 1, s.mmu_flags);
+    if (err < 0) {
+        pmm_free_page(page);
+        return err;
+    }
+
+    private_pages_++;
+    mapped_pages_++;
+
+    return NO_ERROR;
+}
+
+status_t image_mapping::fault(proc *p, vaddr_t addr, uint flags) {
+    const elf_image::segment *s = image_->find_segment(addr);
+    if (!s) {
+        return ERR_NOT_FOUND;
+    }
+
+    const bool write = flags & LKUSER_PF_FLAG_WRITE;
+    if (write && !s->writable) {
+        return ERR_ACCESS_DENIED;
+    }
+    if ((flags & LKUSER_PF_FLAG_EXEC) && (s->mmu_flags & ARCH_MMU_FLAG_PERM_NO_EXECUTE)) {
+        return ERR_ACCESS_DENIED;
+    }
+
+    const vaddr_t va = ROUNDDOWN(addr, PAGE_SIZE);
+    arch_aspace_t *arch_aspace = &p->get_aspace()->arch_aspace;
+
+    AutoLock guard(lock_);
+
+    uint mmu_flags;
+    if (arch_mmu_query(arch_aspace, va, nullptr, &mmu_flags) >= 0) {
+        // another thread may have brought the page in while we waited
+        if (!write || !(mmu_flags & ARCH_MMU_FLAG_PERM_RO)) {
+            return NO_ERROR;
+        }
+
+        // first write to a page still shared with the image
+        LTRACEF("copy on write at %#lx\n", va);
+        arch_mmu_unmap(arch_aspace, va, 1);
+        mapped_pages_--;
+    }
+
+    return map_page_locked(p, *s, va, write);
+}
+
+status_t image_mapping::clone(proc *p, proc *child, image_mapping **out) {
+    image_->acquire();
+    image_mapping *m = new image_mapping(image_);
+    if (!m) {
+        image_->release();
+        return ERR_NO_MEMORY;
+    }
+
+    status_t err = reserve(child, image_);
+
+    AutoLock guard(lock_);
+
+    arch_aspace_t *arch_aspace = &p->get_aspace()->arch_aspace;
+    for (size_t i = 0; i < image_->get_segment_count() && err >= 0; i++) {
+        const elf_image::segment &s = image_->get_segment(i);
+        for (vaddr_t va = s.base; va < s.base + s.size && err >= 0; va += PAGE_SIZE) {
+            // pages we never touched fault in from the image in the child too
+            paddr_t pa;
+            uint flags;
+            if (arch_mmu_query(arch_aspace, va, &pa, &flags) < 0) {
+                continue;
+            }
+
+            vm_page_t *page = paddr_to_vm_page(pa);
+            if (page == image_->peek_page(s, (va - s.base) / PAGE_SIZE)) {
+                err = arch_mmu_map(&child->get_aspace()->arch_aspace, va, pa, 1, flags);
+            } else {
+                err = cow_clone_page(p, child, va);
+                m->private_pages_++;
+            }
+            m->mapped_pages_++;
+        }
+    }
+
+    // even on failure the child owns the mapping, so whatever was shared so
+    // far is given back when it is destroyed
+    *out = m;
+    return err;
+}
+
+void image_mapping::clear(proc *p) {
+    AutoLock guard(lock_);
+
+    arch_aspace_t *arch_aspace = &p->get_aspace()->arch_aspace;
+    for (size_t i = 0; i < image_->get_segment_count(); i++) {
+        const elf_image::segment &s = image_->get_segment(i);
+        if (!s.writable) {
+            continue;
+        }
+
+        for (vaddr_t va = s.base; va < s.base + s.size; va += PAGE_SIZE) {
+            paddr_t pa;
+            if (arch_mmu_query(arch_aspace, va, &pa, nullptr) < 0) {
+                continue;
+            }
+
+            // the image's own pages stay with the image
+            vm_page_t *page = paddr_to_vm_page(pa);
+            if (page != image_->peek_page(s, (va - s.base) / PAGE_SIZE)) {
+                release_user_page(p, va);
+                private_pages_--;
+                mapped_pages_--;
+            }
+        }
+    }
+}
+
+void image_cache_invalidate(const char *path) {
+    list_node victims = LIST_INITIAL_VALUE(victims);
+
+    {
+        AutoLock guard(image_list_lock);
+
+        elf_image *img;
+        list_for_every_entry(&image_list, img, elf_image, node) {
+            if (!strcmp(img->path_, path)) {
+                LTRACEF("invalidating image %p for '%s'\n", img, path);
+                img->invalidate_locked();
+                if (img->ref_ == 0) {
+                    list_add_tail(&victims, &img->node);
+                }
+                break;
+            }
+        }
+    }
+
+    elf_image::destroy_list(&victims);
+}
+
+void image_cache_flush() {
+    list_node victims = LIST_INITIAL_VALUE(victims);
+
+    {
+        AutoLock guard(image_list_lock);
+
+        elf_image *img;
+        while ((img = list_remove_head_type(&image_list, elf_image, node))) {
+            img->cached_ = false;
+            cache_stats.invalidations++;
+            if (img->ref_ == 0) {
+                list_add_tail(&victims, &img->node);
+            }
+        }
+    }
+
+    elf_image::destroy_list(&victims);
+}
+
+void image_cache_set_budget(size_t bytes) {
+    list_node victims = LIST_INITIAL_VALUE(victims);
+
+    {
+        AutoLock guard(image_list_lock);
+        cache_budget = bytes;
+        elf_image::trim_locked(&victims);
+    }
+
+    elf_image::destroy_list(&victims);
+}
+
+void dump_image_cache() {
+    AutoLock guard(image_list_lock);
+
+    printf("image cache: %zu of %zu bytes used\n", cache_stats.bytes_cached, cache_budget);
+    printf("\thits %llu misses %llu evictions %llu invalidations %llu, %llu bytes read\n",
+           (unsigned long long)cache_stats.hits, (unsigned long long)cache_stats.misses,
+           (unsigned long long)cache_stats.evictions, (unsigned long long)cache_stats.invalidations,
+           (unsigned long long)cache_stats.bytes_read);
+
+    elf_image *img;
+    list_for_every_entry(&image_list, img, elf_image, node) {
+        printf("\t%s: %zu bytes, %d users\n", img->path_, img->pages_ * PAGE_SIZE, img->ref_);
+    }
+}
+
+size_t image_resident_pages(proc *p) {
+    const image_mapping *m = p->get_loader_state().image;
+    return m ? m->get_mapped_pages() : 0;
+}
+
+size_t image_private_pages(proc *p) {
+    const image_mapping *m = p->get_loader_state().image;
+    return m ? m->get_private_pages() : 0;
+}
+
+} // namespace lkuser
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <sys/types.h>
+#include <lk/cpp.h>
+#include <lk/list.h>
+#include <lib/fs.h>
+#include <kernel/mutex.h>
+#include <kernel/vm.h>
+
+namespace lkuser {
+
+class proc;
+
+// budget for the pages held by the image cache, images in use by a process
+// can push it over
+#ifndef LKUSER_IMAGE_CACHE_BUDGET
+#define LKUSER_IMAGE_CACHE_BUDGET (4 * 1024 * 1024)
+#endif
+
+// the parsed headers and page contents of a binary, shared by every process
+// running it. images stay cached by path after their last user goes away,
+// until evicted in lru order to stay within the cache budget or invalidated
+// because the file changed size or was opened for writing.
+class elf_image {
+private:
+    elf_image() = default;
+
+public:
+    ~elf_image();
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(elf_image);
+
+    // find or create the image for a binary, returning a reference to it
+    static status_t get(const char *path, elf_image **out);
+
+    void acquire();
+    void release();
+
+    struct segment {
+        vaddr_t base;       // page aligned start of the segment
+        size_t size;        // page aligned size of the segment
+        vaddr_t vaddr;      // start of the segment itself
+        uint64_t offset;    // file offset of vaddr
+        size_t file_size;   // bytes backed by the file, the rest is zero filled
+        uint mmu_flags;
+        bool writable;
+        vm_page_t **pages;  // page contents, read in on first use
+    };
+
+    vaddr_t get_entry() const { return entry_; }
+    // main thread stack size asked for by the binary, 0 if it did not
+    size_t get_stack_size() const { return stack_size_; }
+    size_t get_segment_count() const { return segment_count_; }
+    const segment &get_segment(size_t i) const { return segments_[i]; }
+    const segment *find_segment(vaddr_t addr) const;
+
+    // first page past the highest segment
+    vaddr_t get_end() const;
+
+    // return the page at index in a segment holding its initial contents,
+    // reading it from the file the first time. returns null for pages of a
+    // writable segment that are entirely zero fill.
+    status_t get_page(const segment &s, size_t index, vm_page_t **out);
+
+    // the page at index if it has been read in already, without reading it
+    vm_page_t *peek_page(const segment &s, size_t index);
+
+    // list node for the image cache, most recently used first
+    list_node node = LIST_INITIAL_CLEARED_VALUE;
+
+private:
+    static status_t create(const char *path, filehandle *file, uint64_t file_size, elf_image **out);
+
+    // find a still valid cached image of path and take a reference to it,
+    // queueing a stale one on victims
+    static elf_image *lookup_locked(const char *path, list_node *victims);
+
+    // drop out of the cache, the image lives on until its last reference goes
+    void invalidate_locked();
+
+    char *path_ = nullptr;
+    uint64_t file_size_ = 0;
+
+    int ref_ = 1;
+    bool cached_ = false;
+
+    filehandle *file_ = nullptr;
+    vaddr_t entry_ = 0;
+    size_t stack_size_ = 0;
+
+    segment *segments_ = nullptr;
+    size_t segment_count_ = 0;
+
+    Mutex lock_;
+    size_t pages_ = 0; // number of pages held in segments
+
+    // move unused images out of the cache until it is within budget
+    static void trim_locked(list_node *victims);
+    static void destroy_list(list_node *victims);
+    friend void image_cache_invalidate(const char *path);
+    friend void image_cache_flush();
+    friend void image_cache_set_budget(size_t bytes);
+    friend void dump_image_cache();
+};
+
+// image cache controls, counters are printed by dump_image_cache()
+void image_cache_invalidate(const char *path);
+void image_cache_flush();
+void image_cache_set_budget(size_t bytes);
+void dump_image_cache();
+
+// a process's view of an elf_image. read only segments map the image's pages
+// directly, writable segments start out mapping them read only and get a
+// private copy of a page the first time it is written.
+class image_mapping {
+private:
+    explicit image_mapping(elf_image *img) : image_(img) {}
+
+public:
+    ~image_mapping();
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(image_mapping);
+
+    // reserve the image's segments in the process's address space, taking
+    // over the caller's reference to the image. unless lazy, every page is
+    // mapped up front and writable segments are copied.
+    static status_t create(proc *p, elf_image *img, bool lazy, image_mapping **out);
+
+    // resolve a fault on one of the segments
+    status_t fault(proc *p, vaddr_t addr, uint flags);
+
+    // map the same image into child, sharing the private pages copy on write
+    status_t clone(proc *p, proc *child, image_mapping **out);
+
+    // give back the private pages, before the address space goes away
+    void clear(proc *p);
+
+    elf_image *get_image() const { return image_; }
+    size_t get_mapped_pages() const { return mapped_pages_; }
+    size_t get_private_pages() const { return private_pages_; }
+
+private:
+    static status_t reserve(proc *p, elf_image *img);
+    status_t map_page_locked(proc *p, const elf_image::segment &s, vaddr_t va, bool write);
+
+    elf_image *image_;
+
+    Mutex lock_;
+    size_t mapped_pages_ = 0;
+    size_t private_pages_ = 0;
+};
+
+// pages of the binary mapped into the process, and how many of those are
+// private to it
+size_t image_resident_pages(proc *p);
+size_t image_private_pages(proc *p);
+
+} // namespace lkuser
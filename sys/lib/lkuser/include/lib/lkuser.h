@@ -22,3 +22,23 @@
  */
 #pragma once
 
+#include <sys/types.h>
+#include <lk/compiler.h>
+
+__BEGIN_CDECLS
+
+/* access that caused a user page fault */
+#define LKUSER_PF_FLAG_WRITE    (1u << 0)
+#define LKUSER_PF_FLAG_EXEC     (1u << 1)
+
+/* entry point for the arch fault handlers when a thread faults on a user
+ * address with no page behind it, or writes to a page mapped read only. lk's
+ * handlers are wrapped to call it, see fault.cpp. must be called with
+ * interrupts enabled, since resolving the fault may block on file system
+ * reads. returns NO_ERROR
+ * if the page is now mapped and the access should be retried, anything else
+ * is a genuine fault.
+ */
+status_t lkuser_page_fault(vaddr_t addr, uint flags);
+
+__END_CDECLS
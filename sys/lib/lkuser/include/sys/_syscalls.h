@@ -31,4 +31,37 @@ LK_SYSCALL_DEF(5, int,    lseek,      int file, long pos, int whence)
 LK_SYSCALL_DEF(6, void *, sbrk,       long incr)
 LK_SYSCALL_DEF(7, int,    sleep_sec,  unsigned long useconds)
 LK_SYSCALL_DEF(8, int,    sleep_usec, unsigned long useconds)
+LK_SYSCALL_DEF(9, int,    tty_mode,   int file, int mode)
+LK_SYSCALL_DEF(10, int,   uring_setup, struct lkuser_uring *ring)
+LK_SYSCALL_DEF(11, int,   uring_enter, unsigned int to_submit, unsigned int min_complete, unsigned int flags)
+LK_SYSCALL_DEF(12, int,   fstat,      int file, struct lkuser_stat *st)
 
+LK_SYSCALL_DEF(13, int,   mmap,       struct lkuser_mmap_args *args)
+LK_SYSCALL_DEF(14, int,   munmap,     void *addr, unsigned long len)
+LK_SYSCALL_DEF(15, int,   mprotect,   void *addr, unsigned long len, int prot)
+
+LK_SYSCALL_DEF(16, int,   thread_create, void *entry, void *stack_top, void *tls)
+LK_SYSCALL_DEF(17, void,  thread_exit, int retcode)
+LK_SYSCALL_DEF(18, int,   thread_join, int tid, int *retcode)
+LK_SYSCALL_DEF(19, int,   futex_wait, int *addr, int value, unsigned int timeout_msec)
+LK_SYSCALL_DEF(20, int,   futex_wake, int *addr, int count)
+LK_SYSCALL_DEF(21, int,   set_affinity, int tid, unsigned int mask)
+LK_SYSCALL_DEF(22, int,   get_affinity, int tid, unsigned int *mask)
+LK_SYSCALL_DEF(23, int,   spawn,      const char *path, const char * const *argv)
+LK_SYSCALL_DEF(24, int,   waitpid,    int pid, int *retcode, unsigned int timeout_msec)
+LK_SYSCALL_DEF(25, int,   fork,       void *entry, void *stack_top)
+LK_SYSCALL_DEF(26, int,   ready,      void *entry, void *stack_top)
+LK_SYSCALL_DEF(27, int,   kill,       int pid, int sig)
+LK_SYSCALL_DEF(28, int,   yield,      void)
+LK_SYSCALL_DEF(29, int,   nanosleep,  int clock, int flags, const uint64_t *ns)
+LK_SYSCALL_DEF(30, int,   timer_create, int clock, int flags)
+LK_SYSCALL_DEF(31, int,   timer_set,  int file, int flags, const struct lkuser_timer_spec *spec, struct lkuser_timer_spec *old)
+LK_SYSCALL_DEF(32, int,   timer_get,  int file, struct lkuser_timer_spec *cur)
+LK_SYSCALL_DEF(33, int,   pipe,       int *files, int flags)
+LK_SYSCALL_DEF(34, int,   poll,       struct lkuser_pollfd *fds, unsigned int nfds, int timeout_msec)
+LK_SYSCALL_DEF(35, int,   epoll_create, int flags)
+LK_SYSCALL_DEF(36, int,   epoll_ctl,  int epfile, int op, int file, const struct lkuser_epoll_event *ev)
+LK_SYSCALL_DEF(37, int,   epoll_wait, int epfile, struct lkuser_epoll_event *events, int max, int timeout_msec)
+LK_SYSCALL_DEF(38, int,   pid_open,   int pid)
+LK_SYSCALL_DEF(39, int,   shm_open,   const char *name, unsigned long size, int flags)
+LK_SYSCALL_DEF(40, int,   shm_unlink, const char *name)
@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <stdint.h>
+
+/* constants and structures shared between the kernel and user space */
+
+/* console modes for the tty_mode syscall */
+#define LKUSER_TTY_MODE_RAW     0x0  /* reads return whatever input is ready */
+#define LKUSER_TTY_MODE_LINE    0x1  /* reads complete on newline */
+#define LKUSER_TTY_MODE_ECHO    0x2  /* echo input back to the console */
+#define LKUSER_TTY_MODE_QUERY   (-1) /* return the current mode without changing it */
+
+/* read only kernel data pages mapped into every process.
+ * the first page holds the global time base, the second one describes
+ * the process it is mapped into. they sit just below the end of the arm
+ * user address space at 0x3f000000, the smallest of the supported arches.
+ */
+#define LKUSER_KDATA_BASE       0x3efe0000UL
+#define LKUSER_KDATA_PAGE_SIZE  4096
+#define LKUSER_KDATA_TIME       (LKUSER_KDATA_BASE)
+#define LKUSER_KDATA_PROC       (LKUSER_KDATA_BASE + LKUSER_KDATA_PAGE_SIZE)
+
+/* updated seqlock style: seq is odd while the kernel is writing, readers
+ * retry if it was odd or changed across the read.
+ *
+ * monotonic ns = mono_ns + ((counter - counter_base) * counter_mult) >> counter_shift
+ * if counter_user is set, otherwise just mono_ns.
+ */
+struct lkuser_kdata_time {
+    uint32_t seq;
+    uint32_t counter_user;
+    uint64_t mono_ns;
+    uint64_t counter_base;
+    uint32_t counter_mult;
+    uint32_t counter_shift;
+    int64_t realtime_offset_ns;
+    uint32_t cpu_count;
+    uint32_t reserved;
+};
+
+struct lkuser_kdata_proc {
+    uint32_t pid;
+};
+
+/* asynchronous submission/completion rings, set up with uring_setup.
+ *
+ * user space fills in sqes and advances sq_tail, the kernel consumes them in
+ * order, advances sq_head and posts a cqe per sqe. user space consumes cqes
+ * by advancing cq_head. all indices are free running and masked by
+ * entries - 1.
+ */
+#define LKUSER_URING_OP_NOP         0
+#define LKUSER_URING_OP_READ        1   /* fd, addr = buffer, len */
+#define LKUSER_URING_OP_WRITE       2   /* fd, addr = buffer, len */
+#define LKUSER_URING_OP_SLEEP       3   /* off = microseconds */
+#define LKUSER_URING_OP_OPEN        4   /* addr = path, len = flags, off = mode */
+#define LKUSER_URING_OP_CLOSE       5   /* fd */
+#define LKUSER_URING_OP_LSEEK       6   /* fd, off = position, len = whence */
+
+#define LKUSER_URING_MAX_ENTRIES    4096
+
+/* lkuser_uring.flags */
+#define LKUSER_URING_SETUP_SQPOLL   0x1 /* a kernel thread polls the submission ring */
+
+/* lkuser_uring.sq_flags, written by the kernel */
+#define LKUSER_URING_SQ_NEED_WAKEUP 0x1 /* the polling thread went idle, enter with SQ_WAKEUP */
+
+/* flags to uring_enter */
+#define LKUSER_URING_ENTER_GETEVENTS 0x1 /* wait for min_complete completions */
+#define LKUSER_URING_ENTER_SQ_WAKEUP 0x2 /* wake up the polling thread */
+
+struct lkuser_uring_sqe {
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t reserved;
+    int32_t fd;
+    uint64_t addr;
+    uint64_t off;
+    uint32_t len;
+    uint32_t reserved2;
+    uint64_t user_data;
+};
+
+struct lkuser_uring_cqe {
+    uint64_t user_data;
+    int32_t res;
+    uint32_t flags;
+};
+
+/* shared control block, must stay valid for the life of the process */
+struct lkuser_uring {
+    uint32_t sq_head;       /* written by the kernel */
+    uint32_t sq_tail;       /* written by user space */
+    uint32_t cq_head;       /* written by user space */
+    uint32_t cq_tail;       /* written by the kernel */
+    uint32_t sq_entries;    /* power of two */
+    uint32_t cq_entries;    /* power of two */
+    uint32_t sq_flags;      /* LKUSER_URING_SQ_* */
+    uint32_t flags;         /* LKUSER_URING_SETUP_* */
+    uint32_t sq_idle_msec;  /* how long the polling thread spins before going idle */
+    uint32_t reserved;
+    uint64_t sqes;          /* user address of the sqe array */
+    uint64_t cqes;          /* user address of the cqe array */
+};
+
+/* syscalls return negative lk status codes on failure, the ones user space
+ * cares to tell apart are mirrored here.
+ */
+#define LKUSER_ERR_NOT_FOUND        (-2)
+#define LKUSER_ERR_NOT_READY        (-3)
+#define LKUSER_ERR_NO_MEMORY        (-5)
+#define LKUSER_ERR_INVALID_ARGS     (-8)
+#define LKUSER_ERR_TIMED_OUT        (-13)
+#define LKUSER_ERR_ALREADY_EXISTS   (-14)
+#define LKUSER_ERR_CHANNEL_CLOSED   (-15)
+#define LKUSER_ERR_NOT_SUPPORTED    (-24)
+#define LKUSER_ERR_TOO_BIG          (-25)
+#define LKUSER_ERR_CANCELLED        (-26)
+#define LKUSER_ERR_NO_RESOURCES     (-41)
+#define LKUSER_ERR_BAD_HANDLE       (-42)
+#define LKUSER_ERR_ACCESS_DENIED    (-43)
+
+/* open flags, the same values newlib uses */
+#define LKUSER_O_ACCMODE    0x0003
+#define LKUSER_O_RDONLY     0x0000
+#define LKUSER_O_WRONLY     0x0001
+#define LKUSER_O_RDWR       0x0002
+#define LKUSER_O_APPEND     0x0008
+#define LKUSER_O_CREAT      0x0200
+#define LKUSER_O_TRUNC      0x0400
+#define LKUSER_O_EXCL       0x0800
+#define LKUSER_O_NONBLOCK   0x4000
+
+#define LKUSER_SEEK_SET     0
+#define LKUSER_SEEK_CUR     1
+#define LKUSER_SEEK_END     2
+
+/* file types in lkuser_stat.mode, the usual S_IF* values */
+#define LKUSER_S_IFMT       0170000
+#define LKUSER_S_IFIFO      0010000
+#define LKUSER_S_IFDIR      0040000
+#define LKUSER_S_IFCHR      0020000
+#define LKUSER_S_IFREG      0100000
+
+struct lkuser_stat {
+    uint32_t mode;
+    uint32_t reserved;
+    uint64_t size;
+};
+
+/* memory mapping */
+#define LKUSER_PROT_NONE        0x0
+#define LKUSER_PROT_READ        0x1
+#define LKUSER_PROT_WRITE       0x2
+#define LKUSER_PROT_EXEC        0x4
+
+#define LKUSER_MAP_SHARED       0x01
+#define LKUSER_MAP_PRIVATE      0x02
+#define LKUSER_MAP_FIXED        0x10
+#define LKUSER_MAP_ANONYMOUS    0x20
+/* an anonymous stack: pages are committed as it grows into them and the
+ * lowest page is left unmapped to catch overflows */
+#define LKUSER_MAP_STACK        0x20000
+
+/* mmap takes more arguments than fit in registers, so they are passed in
+ * memory. on success the kernel writes the address of the mapping back into
+ * addr.
+ */
+struct lkuser_mmap_args {
+    uint64_t addr;
+    uint64_t len;
+    int32_t prot;
+    int32_t flags;
+    int32_t fd;
+    int32_t reserved;
+    int64_t off;
+};
+
+/* futex_wait timeout meaning wait forever */
+#define LKUSER_FUTEX_INFINITE   0xffffffffu
+
+/* set_affinity/get_affinity on this thread id address the whole process */
+#define LKUSER_AFFINITY_PROCESS 0
+
+/* waitpid on this pid takes whichever child exits first */
+#define LKUSER_WAIT_ANY         (-1)
+/* waitpid timeout meaning wait forever, 0 only polls */
+#define LKUSER_WAIT_INFINITE    0xffffffffu
+
+/* a process killed with a signal exits with this plus the signal number */
+#define LKUSER_KILL_EXIT_BASE   128
+
+/* clocks for nanosleep and timers, the values newlib uses */
+#define LKUSER_CLOCK_REALTIME   1
+#define LKUSER_CLOCK_MONOTONIC  4
+
+/* the time passed to nanosleep or timer_set is a deadline on the clock
+ * rather than an interval from now */
+#define LKUSER_TIMER_ABSTIME    0x4
+
+/* timer_create flags: reads of a timer that has not expired fail with
+ * LKUSER_ERR_NOT_READY instead of blocking */
+#define LKUSER_TIMER_NONBLOCK   0x1
+
+/* a timer first expires value_ns from now, or at value_ns with
+ * LKUSER_TIMER_ABSTIME, then every interval_ns if that is not zero. a zero
+ * value_ns disarms it. reading the timer's descriptor waits for it to
+ * expire and returns a uint64_t count of expirations since the last read.
+ */
+struct lkuser_timer_spec {
+    uint64_t value_ns;
+    uint64_t interval_ns;
+};
+
+/* poll events, the usual POLL* values */
+#define LKUSER_POLLIN       0x001
+#define LKUSER_POLLPRI      0x002
+#define LKUSER_POLLOUT      0x004
+#define LKUSER_POLLERR      0x008
+#define LKUSER_POLLHUP      0x010
+#define LKUSER_POLLNVAL     0x020
+
+/* laid out like struct pollfd */
+struct lkuser_pollfd {
+    int32_t fd;
+    int16_t events;
+    int16_t revents;
+};
+
+/* poll and epoll_wait timeout meaning wait forever, 0 only checks */
+#define LKUSER_POLL_INFINITE    (-1)
+
+/* epoll_ctl operations */
+#define LKUSER_EPOLL_CTL_ADD    1
+#define LKUSER_EPOLL_CTL_DEL    2
+#define LKUSER_EPOLL_CTL_MOD    3
+
+/* in lkuser_epoll_event.events along with LKUSER_POLL* bits: report a file
+ * only when it wakes the set rather than for as long as it is ready, or only
+ * once until it is modified again */
+#define LKUSER_EPOLLONESHOT     (1u << 30)
+#define LKUSER_EPOLLET          (1u << 31)
+
+struct lkuser_epoll_event {
+    uint32_t events;
+    uint32_t reserved;
+    uint64_t data;
+};
@@ -22,6 +22,8 @@
  */
 #pragma once
 
+#include <sys/lkuser_abi.h>
+
 /* for direct function pointer based syscalls, simply define them as a
  * structure with a list of function pointers.
  */
@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "kdata.h"
+
+#include <string.h>
+#include <lk/err.h>
+#include <lk/init.h>
+#include <lk/trace.h>
+#include <kernel/mp.h>
+#include <kernel/timer.h>
+#include <kernel/vm.h>
+#include <platform.h>
+#include <sys/lkuser_abi.h>
+
+#include "proc.h"
+
+#define LOCAL_TRACE 0
+
+STATIC_ASSERT(LKUSER_KDATA_PAGE_SIZE == PAGE_SIZE);
+// the pages are mapped at a fixed address user space knows about, which has
+// to lie inside this arch's user address space
+STATIC_ASSERT(LKUSER_KDATA_BASE >= USER_ASPACE_BASE);
+STATIC_ASSERT(LKUSER_KDATA_PROC + LKUSER_KDATA_PAGE_SIZE <= USER_ASPACE_BASE + USER_ASPACE_SIZE);
+
+namespace lkuser {
+
+namespace {
+
+vm_page_t *time_page;
+volatile lkuser_kdata_time *kdata_time;
+
+timer_t update_timer = TIMER_INITIAL_VALUE(update_timer);
+
+/* a free running counter that user space can be allowed to read directly */
+#if ARCH_RISCV && __riscv_xlen == 64
+#define HAS_USER_COUNTER 1
+inline uint64_t read_counter() {
+    uint64_t val;
+    __asm__ volatile("rdtime %0" : "=r"(val));
+    return val;
+}
+
+inline uint64_t counter_freq() {
+    return ARCH_RISCV_MTIME_RATE;
+}
+
+void enable_user_counter(uint level) {
+#if RISCV_S_MODE
+    /* let user mode use the rdtime instruction */
+    __asm__ volatile("csrs scounteren, %0" :: "r"(1 << 1));
+#endif
+}
+#elif ARCH_ARM
+#define HAS_USER_COUNTER 1
+inline uint64_t read_counter() {
+    uint64_t val;
+    __asm__ volatile("mrrc p15, 1, %Q0, %R0, c14" : "=r"(val));
+    return val;
+}
+
+inline uint64_t counter_freq() {
+    uint32_t freq;
+    __asm__ volatile("mrc p15, 0, %0, c14, c0, 0" : "=r"(freq));
+    return freq;
+}
+
+void enable_user_counter(uint level) {
+    /* set CNTKCTL.PL0VCTEN so user mode can read the virtual counter */
+    uint32_t val;
+    __asm__ volatile("mrc p15, 0, %0, c14, c1, 0" : "=r"(val));
+    val |= (1 << 1);
+    __asm__ volatile("mcr p15, 0, %0, c14, c1, 0" :: "r"(val));
+}
+#else
+#define HAS_USER_COUNTER 0
+#endif
+
+#if HAS_USER_COUNTER
+LK_INIT_HOOK_FLAGS(lkuser_kdata_counter, enable_user_counter, LK_INIT_LEVEL_THREADING, LK_INIT_FLAG_ALL_CPUS);
+
+inline uint64_t counter_to_ns(uint64_t counter, uint64_t freq) {
+    return (counter / freq) * 1000000000ULL + (counter % freq) * 1000000000ULL / freq;
+}
+#endif
+
+void update_time() {
+    /* pick both the time and the counter up from the same read */
+#if HAS_USER_COUNTER
+    uint64_t counter = read_counter();
+    uint64_t mono_ns = counter_to_ns(counter, counter_freq());
+#else
+    uint64_t counter = 0;
+    uint64_t mono_ns = current_time_hires() * 1000;
+#endif
+
+    kdata_time->seq++;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    kdata_time->mono_ns = mono_ns;
+    kdata_time->counter_base = counter;
+    kdata_time->cpu_count = __builtin_popcount(mp_get_online_mask());
+
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    kdata_time->seq++;
+}
+
+handler_return update_timer_callback(timer_t *t, lk_time_t now, void *arg) {
+    update_time();
+    return INT_NO_RESCHEDULE;
+}
+
+} // namespace
+
+status_t kdata_map(proc *p) {
+    DEBUG_ASSERT(time_page);
+
+    const uint flags = ARCH_MMU_FLAG_PERM_USER | ARCH_MMU_FLAG_PERM_RO | ARCH_MMU_FLAG_PERM_NO_EXECUTE;
+
+    // the time page is shared by everyone
+    void *ptr = (void *)LKUSER_KDATA_TIME;
+    status_t err = vmm_alloc_physical(p->get_aspace(), "kdata_time", PAGE_SIZE, &ptr, PAGE_SIZE_SHIFT,
+                                      vm_page_to_paddr(time_page), VMM_FLAG_VALLOC_SPECIFIC, flags);
+    if (err < 0) {
+        TRACEF("error %d mapping time page\n", err);
+        return err;
+    }
+
+    // the process page is private, filled in before it is visible
+    vm_page_t *page = pmm_alloc_page();
+    if (!page) {
+        return ERR_NO_MEMORY;
+    }
+
+    auto *kproc = (lkuser_kdata_proc *)paddr_to_kvaddr(vm_page_to_paddr(page));
+    memset(kproc, 0, PAGE_SIZE);
+    kproc->pid = p->get_pid();
+
+    ptr = (void *)LKUSER_KDATA_PROC;
+    err = vmm_alloc_physical(p->get_aspace(), "kdata_proc", PAGE_SIZE, &ptr, PAGE_SIZE_SHIFT,
+                             vm_page_to_paddr(page), VMM_FLAG_VALLOC_SPECIFIC, flags);
+    if (err < 0) {
+        TRACEF("error %d mapping process page\n", err);
+        pmm_free_page(page);
+        return err;
+    }
+
+    p->set_kdata_page(page);
+
+    return NO_ERROR;
+}
+
+void kdata_reuse(proc *p, vm_page_t *page) {
+    // still mapped read only in user space, but nothing runs there yet
+    auto *kproc = (lkuser_kdata_proc *)paddr_to_kvaddr(vm_page_to_paddr(page));
+    memset(kproc, 0, PAGE_SIZE);
+    kproc->pid = p->get_pid();
+
+    p->set_kdata_page(page);
+}
+
+void kdata_unmap(proc *p) {
+    // the mapping went away with the address space, just free the page behind it
+    vm_page_t *page = p->get_kdata_page();
+    if (page) {
+        pmm_free_page(page);
+        p->set_kdata_page(nullptr);
+    }
+}
+
+uint64_t kdata_now_ns() {
+#if HAS_USER_COUNTER
+    return counter_to_ns(read_counter(), counter_freq());
+#else
+    return current_time_hires() * 1000;
+#endif
+}
+
+int64_t kdata_realtime_offset_ns() {
+    return kdata_time->realtime_offset_ns;
+}
+
+void kdata_init() {
+    time_page = pmm_alloc_page();
+    if (!time_page) {
+        panic("unable to allocate kernel data page\n");
+    }
+
+    kdata_time = (lkuser_kdata_time *)paddr_to_kvaddr(vm_page_to_paddr(time_page));
+    memset((void *)kdata_time, 0, PAGE_SIZE);
+
+#if HAS_USER_COUNTER
+    /* pick the largest shift that still keeps the multiplier in 32 bits */
+    uint64_t freq = counter_freq();
+    uint32_t shift = 32;
+    while (shift > 0 && ((1000000000ULL << shift) / freq) > UINT32_MAX) {
+        shift--;
+    }
+    kdata_time->counter_shift = shift;
+    kdata_time->counter_mult = (uint32_t)((1000000000ULL << shift) / freq);
+    kdata_time->counter_user = 1;
+
+    LTRACEF("counter freq %llu, mult %u, shift %u\n", freq, kdata_time->counter_mult, shift);
+#endif
+
+    /* there is no wall clock, so realtime is monotonic time */
+    kdata_time->realtime_offset_ns = 0;
+
+    update_time();
+    timer_set_periodic(&update_timer, LKUSER_KDATA_UPDATE_MSEC, &update_timer_callback, NULL);
+}
+
+} // namespace lkuser
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <sys/types.h>
+#include <kernel/vm.h>
+
+namespace lkuser {
+
+class proc;
+
+// how often the time base in the kernel data page is refreshed
+#ifndef LKUSER_KDATA_UPDATE_MSEC
+#define LKUSER_KDATA_UPDATE_MSEC 10
+#endif
+
+// map the kernel data pages into a process
+status_t kdata_map(proc *p);
+
+// take over the pages still mapped in a recycled address space, resetting
+// the process page for the new owner
+void kdata_reuse(proc *p, vm_page_t *page);
+
+// free the per process page once the address space is gone
+void kdata_unmap(proc *p);
+
+// monotonic time on the same time base processes read out of the time page
+uint64_t kdata_now_ns();
+
+// realtime minus monotonic time, as published in the time page
+int64_t kdata_realtime_offset_ns();
+
+void kdata_init();
+
+} // namespace lkuser
@@ -38,5 +38,30 @@
 /* defined in syscalls.c */
 extern const lkuser_syscall_table lkuser_syscalls;
 
-/* one of the syscalls */
+/* the syscalls that do not return */
 void sys_exit(int retcode) __NO_RETURN;
+void sys_thread_exit(int retcode) __NO_RETURN;
+
+/* the rest of the syscall handlers, defined in syscalls.cpp */
+#define LK_SYSCALL_DEF(n, ret, name, args...) \
+    ret sys_##name(args);
+#include <sys/_syscalls.h>
+#undef LK_SYSCALL_DEF
+
+namespace lkuser {
+
+class proc_template;
+
+// create a process running the binary at path with the given nul terminated
+// argument list, returning it with a reference held for the caller to wait
+// on and release. safe to call from any number of threads at once. with
+// tmpl the process parks itself in tmpl once it reaches its ready point.
+status_t lkuser_spawn(const char *path, const char * const *argv, proc **out,
+                      proc_template *tmpl = nullptr);
+
+// start a copy on write clone of parent with one thread at entry on
+// stack_top with user thread pointer user_tls, returning it with a reference
+// held like lkuser_spawn
+status_t lkuser_clone(proc *parent, vaddr_t entry, vaddr_t stack_top, vaddr_t user_tls, proc **out);
+
+} // namespace lkuser
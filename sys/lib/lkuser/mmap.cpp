@@ -0,0 +1,592 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "mmap.h"
+
+#include <string.h>
+#include <lk/err.h>
+#include <lk/trace.h>
+#include <arch/ops.h>
+#include <kernel/vm.h>
+#include <lib/lkuser.h>
+
+#include "cow.h"
+#include "fd.h"
+#include "proc.h"
+#include "shm.h"
+
+#define LOCAL_TRACE 0
+
+namespace lkuser {
+
+namespace {
+
+constexpr uint perm_mask = ARCH_MMU_FLAG_PERM_USER | ARCH_MMU_FLAG_PERM_RO | ARCH_MMU_FLAG_PERM_NO_EXECUTE;
+
+uint prot_to_mmu_flags(int prot) {
+    // without any access the pages stay mapped for the kernel only
+    if (prot == LKUSER_PROT_NONE) {
+        return ARCH_MMU_FLAG_PERM_RO | ARCH_MMU_FLAG_PERM_NO_EXECUTE;
+    }
+
+    uint flags = ARCH_MMU_FLAG_PERM_USER;
+    if (!(prot & LKUSER_PROT_WRITE)) {
+        flags |= ARCH_MMU_FLAG_PERM_RO;
+    }
+    if (!(prot & LKUSER_PROT_EXEC)) {
+        flags |= ARCH_MMU_FLAG_PERM_NO_EXECUTE;
+    }
+    return flags;
+}
+
+// rewrite the permissions of already committed pages in place. pages that
+// may be shared with a clone stay read only when made writable, so the first
+// write still takes a private copy.
+status_t protect_pages(proc *p, vaddr_t base, size_t size, uint perms) {
+    arch_aspace_t *arch_aspace = &p->get_aspace()->arch_aspace;
+    cow_set &cow = p->get_cow();
+    const bool writable = (perms & ARCH_MMU_FLAG_PERM_USER) && !(perms & ARCH_MMU_FLAG_PERM_RO);
+
+    AutoLock guard(cow.lock());
+
+    for (vaddr_t va = base; va < base + size; va += PAGE_SIZE) {
+        paddr_t pa;
+        uint flags;
+        status_t err = arch_mmu_query(arch_aspace, va, &pa, &flags);
+        if (err < 0) {
+            return err;
+        }
+
+        flags = (flags & ~perm_mask) | perms;
+        if (!writable) {
+            cow.remove_locked(va);
+        } else if (cow.contains_locked(va) || cow_page_shared(paddr_to_vm_page(pa))) {
+            err = cow.insert_locked(va);
+            if (err < 0) {
+                return err;
+            }
+            flags |= ARCH_MMU_FLAG_PERM_RO;
+        }
+
+        arch_mmu_unmap(arch_aspace, va, 1);
+        err = arch_mmu_map(arch_aspace, va, pa, 1, flags);
+        if (err < 0) {
+            return err;
+        }
+    }
+
+    return NO_ERROR;
+}
+
+} // namespace
+
+mapping_table::~mapping_table() {
+    // the pages were given back by clear()
+    mapping *m;
+    while ((m = list_remove_head_type(&list_, mapping, node))) {
+        delete m;
+    }
+}
+
+status_t mapping_table::init(proc *p, vaddr_t base, size_t size) {
+    DEBUG_ASSERT(IS_PAGE_ALIGNED(base));
+
+    size = ROUNDUP(size, PAGE_SIZE);
+
+    status_t err = vmm_reserve_space(p->get_aspace(), "mmap", size, base);
+    LTRACEF("reserving %#zx bytes at %#lx returns %d\n", size, base, err);
+    if (err < 0) {
+        return err;
+    }
+
+    AutoLock guard(lock_);
+    base_ = base;
+    size_ = size;
+
+    return NO_ERROR;
+}
+
+vaddr_t mapping_table::find_space_locked(size_t size) const {
+    vaddr_t candidate = base_;
+
+    const mapping *m;
+    list_for_every_entry(&list_, m, const mapping, node) {
+        if (m->base - candidate >= size) {
+            break;
+        }
+        candidate = m->base + m->size;
+    }
+
+    if (base_ + size_ - candidate < size) {
+        return 0;
+    }
+    return candidate;
+}
+
+bool mapping_table::range_free_locked(vaddr_t base, size_t size) const {
+    if (base < base_ || base + size > base_ + size_ || base + size < base) {
+        return false;
+    }
+
+    const mapping *m;
+    list_for_every_entry(&list_, m, const mapping, node) {
+        if (m->base < base + size && m->base + m->size > base) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void mapping_table::insert_locked(mapping *m) {
+    mapping *next;
+    list_for_every_entry(&list_, next, mapping, node) {
+        if (next->base > m->base) {
+            list_add_before(&next->node, &m->node);
+            return;
+        }
+    }
+    list_add_tail(&list_, &m->node);
+}
+
+void mapping_table::release_locked(proc *p, mapping *m) {
+    // shared memory keeps its pages, we only hold a reference
+    if (m->shm) {
+        arch_mmu_unmap(&p->get_aspace()->arch_aspace, m->base, m->size / PAGE_SIZE);
+        m->shm->release();
+        m->shm = nullptr;
+        return;
+    }
+
+    for (vaddr_t va = m->base; va < m->base + m->size; va += PAGE_SIZE) {
+        release_user_page(p, va);
+    }
+}
+
+status_t mapping_table::commit_zero_page_locked(proc *p, vaddr_t va) {
+    vm_page_t *page = pmm_alloc_page();
+    if (!page) {
+        return ERR_NO_MEMORY;
+    }
+    paddr_t pa = vm_page_to_paddr(page);
+    memset(paddr_to_kvaddr(pa), 0, PAGE_SIZE);
+
+    status_t err = arch_mmu_map(&p->get_aspace()->arch_aspace, va, pa, 1,
+                                ARCH_MMU_FLAG_PERM_USER | ARCH_MMU_FLAG_PERM_NO_EXECUTE);
+    if (err < 0) {
+        pmm_free_page(page);
+        return err;
+    }
+
+    return NO_ERROR;
+}
+
+status_t mapping_table::map(proc *p, lkuser_mmap_args *args) {
+    LTRACEF("addr %#llx, len %#llx, prot %#x, flags %#x, fd %d, off %lld\n",
+            (unsigned long long)args->addr, (unsigned long long)args->len, args->prot, args->flags,
+            args->fd, (long long)args->off);
+
+    const int type = args->flags & (LKUSER_MAP_SHARED | LKUSER_MAP_PRIVATE);
+    if (args->len == 0 || args->len > SIZE_MAX - PAGE_SIZE ||
+        (type != LKUSER_MAP_SHARED && type != LKUSER_MAP_PRIVATE)) {
+        return ERR_INVALID_ARGS;
+    }
+    const size_t len = args->len;
+    const size_t size = ROUNDUP(len, PAGE_SIZE);
+
+    // a stack needs room for the guard page and at least one page of its own
+    const bool stack = args->flags & LKUSER_MAP_STACK;
+    if (stack && (!(args->flags & LKUSER_MAP_ANONYMOUS) || type != LKUSER_MAP_PRIVATE ||
+                  args->prot != (LKUSER_PROT_READ | LKUSER_PROT_WRITE) || size < 2 * PAGE_SIZE)) {
+        return ERR_INVALID_ARGS;
+    }
+
+    lkuser::file *f = nullptr;
+    if (!(args->flags & LKUSER_MAP_ANONYMOUS)) {
+        if (!IS_PAGE_ALIGNED(args->off) || args->off < 0) {
+            return ERR_INVALID_ARGS;
+        }
+        f = p->get_fds().get(args->fd);
+        if (!f) {
+            return ERR_BAD_HANDLE;
+        }
+
+        // shared memory maps its own pages
+        if (type == LKUSER_MAP_SHARED && f->as_shm()) {
+            status_t err = map_shm(p, args, f->as_shm(), size);
+            f->release();
+            return err;
+        }
+
+        // other file mappings are private snapshots, so writes could never
+        // reach the file
+        if (type == LKUSER_MAP_SHARED && (args->prot & LKUSER_PROT_WRITE)) {
+            f->release();
+            return ERR_NOT_SUPPORTED;
+        }
+    }
+
+    mapping *m = new mapping;
+    if (!m) {
+        if (f) {
+            f->release();
+        }
+        return ERR_NO_MEMORY;
+    }
+
+    AutoLock guard(lock_);
+
+    vaddr_t base = place_locked(args, size);
+    if (!base) {
+        if (f) {
+            f->release();
+        }
+        delete m;
+        return (args->flags & LKUSER_MAP_FIXED) ? ERR_INVALID_ARGS : ERR_NO_MEMORY;
+    }
+    m->base = base;
+    m->size = size;
+    m->stack = stack;
+
+    // the rest of a stack comes in as it is touched
+    if (stack) {
+        status_t err = commit_zero_page_locked(p, base + size - PAGE_SIZE);
+        if (err < 0) {
+            delete m;
+            return err;
+        }
+        insert_locked(m);
+
+        LTRACEF("stack of %#zx bytes at %#lx\n", size, base);
+
+        args->addr = base;
+        return NO_ERROR;
+    }
+
+    // fill each page through the kernel mapping before user space can see it
+    arch_aspace_t *arch_aspace = &p->get_aspace()->arch_aspace;
+    const uint perms = prot_to_mmu_flags(args->prot);
+    status_t err = NO_ERROR;
+    vaddr_t va = base;
+    for (; va < base + size; va += PAGE_SIZE) {
+        vm_page_t *page = pmm_alloc_page();
+        if (!page) {
+            err = ERR_NO_MEMORY;
+            break;
+        }
+        paddr_t pa = vm_page_to_paddr(page);
+        char *kva = (char *)paddr_to_kvaddr(pa);
+
+        size_t filled = 0;
+        const size_t offset = va - base;
+        if (f && offset < len) {
+            ssize_t ret = f->pread(kva, MIN(len - offset, (size_t)PAGE_SIZE), args->off + offset);
+            if (ret < 0) {
+                pmm_free_page(page);
+                err = ret;
+                break;
+            }
+            filled = ret;
+        }
+        memset(kva + filled, 0, PAGE_SIZE - filled);
+        if (args->prot & LKUSER_PROT_EXEC) {
+            arch_sync_cache_range((addr_t)kva, PAGE_SIZE);
+        }
+
+        err = arch_mmu_map(arch_aspace, va, pa, 1, perms);
+        if (err < 0) {
+            pmm_free_page(page);
+            break;
+        }
+    }
+    if (f) {
+        f->release();
+    }
+    if (err < 0) {
+        m->size = va - base;
+        release_locked(p, m);
+        delete m;
+        return err;
+    }
+
+    insert_locked(m);
+
+    LTRACEF("mapped %#zx bytes at %#lx\n", size, base);
+
+    args->addr = base;
+    return NO_ERROR;
+}
+
+vaddr_t mapping_table::place_locked(const lkuser_mmap_args *args, size_t size) const {
+    if (args->flags & LKUSER_MAP_FIXED) {
+        vaddr_t base = args->addr;
+        if (!IS_PAGE_ALIGNED(base) || !range_free_locked(base, size)) {
+            return 0;
+        }
+        return base;
+    }
+    return find_space_locked(size);
+}
+
+status_t mapping_table::map_shm(proc *p, lkuser_mmap_args *args, shm_object *shm, size_t size) {
+    if ((uint64_t)args->off + size > shm->size() || (args->flags & LKUSER_MAP_STACK)) {
+        return ERR_INVALID_ARGS;
+    }
+
+    mapping *m = new mapping;
+    if (!m) {
+        return ERR_NO_MEMORY;
+    }
+
+    AutoLock guard(lock_);
+
+    vaddr_t base = place_locked(args, size);
+    if (!base) {
+        delete m;
+        return (args->flags & LKUSER_MAP_FIXED) ? ERR_INVALID_ARGS : ERR_NO_MEMORY;
+    }
+    m->base = base;
+    m->size = size;
+    m->stack = false;
+    m->shm_page = args->off / PAGE_SIZE;
+
+    arch_aspace_t *arch_aspace = &p->get_aspace()->arch_aspace;
+    const uint perms = prot_to_mmu_flags(args->prot);
+    for (size_t i = 0; i < size / PAGE_SIZE; i++) {
+        status_t err = arch_mmu_map(arch_aspace, base + i * PAGE_SIZE, shm->page_paddr(m->shm_page + i), 1, perms);
+        if (err < 0) {
+            arch_mmu_unmap(arch_aspace, base, i);
+            delete m;
+            return err;
+        }
+    }
+    if (args->prot & LKUSER_PROT_EXEC) {
+        arch_sync_cache_range(base, size);
+    }
+
+    shm->acquire();
+    m->shm = shm;
+    insert_locked(m);
+
+    LTRACEF("mapped %#zx bytes of shm %p at %#lx\n", size, shm, base);
+
+    args->addr = base;
+    return NO_ERROR;
+}
+
+bool mapping_table::shared_paddr(vaddr_t va, paddr_t *pa) {
+    AutoLock guard(lock_);
+
+    mapping *m;
+    list_for_every_entry(&list_, m, mapping, node) {
+        if (va >= m->base && va < m->base + m->size) {
+            if (!m->shm) {
+                return false;
+            }
+            const size_t offset = va - m->base;
+            *pa = m->shm->page_paddr(m->shm_page + offset / PAGE_SIZE) + offset % PAGE_SIZE;
+            return true;
+        }
+    }
+    return false;
+}
+
+status_t mapping_table::map_stack(proc *p, size_t size, vaddr_t *top) {
+    lkuser_mmap_args args {};
+    args.len = ROUNDUP(size, PAGE_SIZE) + PAGE_SIZE;
+    args.prot = LKUSER_PROT_READ | LKUSER_PROT_WRITE;
+    args.flags = LKUSER_MAP_PRIVATE | LKUSER_MAP_ANONYMOUS | LKUSER_MAP_STACK;
+    args.fd = -1;
+
+    status_t err = map(p, &args);
+    if (err < 0) {
+        return err;
+    }
+
+    *top = args.addr + args.len;
+    return NO_ERROR;
+}
+
+status_t mapping_table::fault(proc *p, vaddr_t addr, uint flags) {
+    const vaddr_t va = ROUNDDOWN(addr, PAGE_SIZE);
+
+    AutoLock guard(lock_);
+
+    mapping *m;
+    list_for_every_entry(&list_, m, mapping, node) {
+        if (va < m->base || va >= m->base + m->size) {
+            continue;
+        }
+        if (!m->stack || (flags & LKUSER_PF_FLAG_EXEC)) {
+            return ERR_NOT_FOUND;
+        }
+        if (va == m->base) {
+            TRACEF("stack overflow in pid %u at %#lx\n", p->get_pid(), addr);
+            return ERR_NOT_FOUND;
+        }
+
+        // another thread may have got here first
+        if (arch_mmu_query(&p->get_aspace()->arch_aspace, va, nullptr, nullptr) >= 0) {
+            return NO_ERROR;
+        }
+
+        LTRACEF("growing stack at %#lx to %#lx\n", m->base, va);
+        return commit_zero_page_locked(p, va);
+    }
+
+    return ERR_NOT_FOUND;
+}
+
+status_t mapping_table::unmap(proc *p, vaddr_t addr, size_t len) {
+    LTRACEF("addr %#lx, len %#zx\n", addr, len);
+
+    if (!IS_PAGE_ALIGNED(addr) || len == 0 || len > SIZE_MAX - PAGE_SIZE) {
+        return ERR_INVALID_ARGS;
+    }
+    const vaddr_t end = addr + ROUNDUP(len, PAGE_SIZE);
+
+    AutoLock guard(lock_);
+
+    // only whole mappings can be removed
+    mapping *m;
+    list_for_every_entry(&list_, m, mapping, node) {
+        const vaddr_t mend = m->base + m->size;
+        if (m->base < end && mend > addr && (m->base < addr || mend > end)) {
+            return ERR_NOT_SUPPORTED;
+        }
+    }
+
+    mapping *temp;
+    list_for_every_entry_safe(&list_, m, temp, mapping, node) {
+        if (m->base >= addr && m->base + m->size <= end) {
+            release_locked(p, m);
+            list_delete(&m->node);
+            delete m;
+        }
+    }
+
+    return NO_ERROR;
+}
+
+status_t mapping_table::protect(proc *p, vaddr_t addr, size_t len, int prot) {
+    LTRACEF("addr %#lx, len %#zx, prot %#x\n", addr, len, prot);
+
+    if (!IS_PAGE_ALIGNED(addr) || len == 0 || len > SIZE_MAX - PAGE_SIZE) {
+        return ERR_INVALID_ARGS;
+    }
+    const vaddr_t end = addr + ROUNDUP(len, PAGE_SIZE);
+
+    AutoLock guard(lock_);
+
+    // the whole range has to be covered by mappings, which never overlap.
+    // stacks keep their permissions, most of their pages are not there yet.
+    size_t covered = 0;
+    mapping *m;
+    list_for_every_entry(&list_, m, mapping, node) {
+        const vaddr_t start = MAX(m->base, addr);
+        const vaddr_t stop = MIN(m->base + m->size, end);
+        if (start < stop) {
+            if (m->stack) {
+                return ERR_NOT_SUPPORTED;
+            }
+            covered += stop - start;
+        }
+    }
+    if (covered != end - addr) {
+        return ERR_NOT_FOUND;
+    }
+
+    if (prot & LKUSER_PROT_EXEC) {
+        arch_sync_cache_range(addr, end - addr);
+    }
+
+    return protect_pages(p, addr, end - addr, prot_to_mmu_flags(prot));
+}
+
+status_t mapping_table::clone(proc *p, proc *child, mapping_table &to) {
+    AutoLock guard(lock_);
+
+    if (!base_) {
+        return NO_ERROR;
+    }
+
+    status_t err = to.init(child, base_, size_);
+    if (err < 0) {
+        return err;
+    }
+
+    AutoLock to_guard(to.lock_);
+
+    mapping *m;
+    list_for_every_entry(&list_, m, mapping, node) {
+        mapping *copy = new mapping;
+        if (!copy) {
+            return ERR_NO_MEMORY;
+        }
+        copy->base = m->base;
+        copy->size = m->size;
+        copy->stack = m->stack;
+        list_add_tail(&to.list_, &copy->node);
+
+        // shared memory is mapped into the child as it is
+        if (m->shm) {
+            m->shm->acquire();
+            copy->shm = m->shm;
+            copy->shm_page = m->shm_page;
+
+            arch_aspace_t *from = &p->get_aspace()->arch_aspace;
+            arch_aspace_t *to_aspace = &child->get_aspace()->arch_aspace;
+            for (vaddr_t va = m->base; va < m->base + m->size; va += PAGE_SIZE) {
+                paddr_t pa;
+                uint flags;
+                if (arch_mmu_query(from, va, &pa, &flags) < 0) {
+                    continue;
+                }
+                err = arch_mmu_map(to_aspace, va, pa, 1, flags);
+                if (err < 0) {
+                    return err;
+                }
+            }
+            continue;
+        }
+
+        for (vaddr_t va = m->base; va < m->base + m->size; va += PAGE_SIZE) {
+            err = cow_clone_page(p, child, va);
+            if (err < 0) {
+                return err;
+            }
+        }
+    }
+
+    return NO_ERROR;
+}
+
+void mapping_table::clear(proc *p) {
+    AutoLock guard(lock_);
+
+    mapping *m;
+    while ((m = list_remove_head_type(&list_, mapping, node))) {
+        release_locked(p, m);
+        delete m;
+    }
+}
+
+} // namespace lkuser
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <sys/types.h>
+#include <lk/cpp.h>
+#include <lk/list.h>
+#include <kernel/mutex.h>
+#include <sys/lkuser_abi.h>
+
+namespace lkuser {
+
+class proc;
+class shm_object;
+
+// size of the range reserved for a process's mappings
+#ifndef LKUSER_MMAP_LIMIT
+#define LKUSER_MMAP_LIMIT (64 * 1024 * 1024)
+#endif
+
+// size of the main thread's stack when the binary does not ask for one with
+// PT_GNU_STACK, and the most it may ask for. the stack is carved out of the
+// mmap range and only costs memory as it grows.
+#ifndef LKUSER_STACK_SIZE
+#define LKUSER_STACK_SIZE (1024 * 1024)
+#endif
+#ifndef LKUSER_STACK_MAX
+#define LKUSER_STACK_MAX (16 * 1024 * 1024)
+#endif
+
+// mappings a process created with mmap. they are carved out of one range
+// reserved up front, with pages committed and released by hand so they can
+// be shared copy on write with a clone of the process.
+class mapping_table {
+public:
+    mapping_table() = default;
+    ~mapping_table();
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(mapping_table);
+
+    // reserve size bytes of address space at base for mappings
+    status_t init(proc *p, vaddr_t base, size_t size);
+
+    status_t map(proc *p, lkuser_mmap_args *args);
+
+    // reserve a stack of size bytes plus a guard page below it, committing
+    // only the top page, and return the address just past its top
+    status_t map_stack(proc *p, size_t size, vaddr_t *top);
+
+    // commit the page under addr if it lies in a stack, ERR_NOT_FOUND if
+    // it does not or is the guard page
+    status_t fault(proc *p, vaddr_t addr, uint flags);
+    status_t unmap(proc *p, vaddr_t addr, size_t len);
+    status_t protect(proc *p, vaddr_t addr, size_t len, int prot);
+
+    // the physical address behind va if it lies in a mapping of shared
+    // memory, where every process sees the same page
+    bool shared_paddr(vaddr_t va, paddr_t *pa);
+
+    // set up to as a copy on write clone of this table in child, with
+    // shared memory staying shared
+    status_t clone(proc *p, proc *child, mapping_table &to);
+
+    // give back every mapping, before the address space goes away
+    void clear(proc *p);
+
+private:
+    struct mapping {
+        list_node node;
+        vaddr_t base;
+        size_t size;
+        bool stack; // committed on demand, the first page is the guard
+        // the shared memory mapped here from page shm_page on, if any
+        shm_object *shm = nullptr;
+        size_t shm_page = 0;
+    };
+
+    status_t map_shm(proc *p, lkuser_mmap_args *args, shm_object *shm, size_t size);
+    // where a new mapping of size bytes goes, 0 if it does not fit
+    vaddr_t place_locked(const lkuser_mmap_args *args, size_t size) const;
+
+    // first fit search for a free range, 0 if there is none
+    vaddr_t find_space_locked(size_t size) const;
+    bool range_free_locked(vaddr_t base, size_t size) const;
+    void insert_locked(mapping *m);
+    void release_locked(proc *p, mapping *m);
+    status_t commit_zero_page_locked(proc *p, vaddr_t va);
+
+    Mutex lock_;
+    list_node list_ = LIST_INITIAL_VALUE(list_); // sorted by address
+    vaddr_t base_ = 0;
+    size_t size_ = 0;
+};
+
+} // namespace lkuser
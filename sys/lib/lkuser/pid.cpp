@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "pid.h"
+
+#include <stdint.h>
+#include <lk/err.h>
+#include <lk/trace.h>
+#include <kernel/thread.h>
+
+#include "proc.h"
+
+#define LOCAL_TRACE 0
+
+namespace lkuser {
+
+namespace {
+
+struct pid_slot {
+    proc *p;
+    uint32_t gen;
+    uint32_t readers; // lookups looking at p right now
+};
+
+pid_slot slots[LKUSER_MAX_PROCS];
+
+// where the next allocation starts looking for a free slot
+uint32_t next_slot;
+
+// keep pids positive
+constexpr uint32_t max_gen = INT32_MAX / LKUSER_MAX_PROCS;
+
+inline uint32_t slot_index(uint32_t pid) {
+    return (pid - 1) % LKUSER_MAX_PROCS;
+}
+
+// grab a reference to whatever process is in the slot, if it matches pid
+proc *acquire_slot(pid_slot &s, uint32_t pid) {
+    // the reader count has to be visible before we look at the pointer, and
+    // pid_free clears the pointer before looking at the count
+    __atomic_add_fetch(&s.readers, 1, __ATOMIC_SEQ_CST);
+
+    proc *p = __atomic_load_n(&s.p, __ATOMIC_SEQ_CST);
+    // with no pid any process will do, once it has been given its pid
+    if (p && (pid ? p->get_pid() == pid : p->get_pid() != 0)) {
+        p->acquire();
+    } else {
+        p = nullptr;
+    }
+
+    __atomic_sub_fetch(&s.readers, 1, __ATOMIC_RELEASE);
+
+    return p;
+}
+
+} // namespace
+
+int pid_alloc(proc *p) {
+    const uint32_t start = __atomic_fetch_add(&next_slot, 1, __ATOMIC_RELAXED);
+
+    for (uint32_t i = 0; i < LKUSER_MAX_PROCS; i++) {
+        const uint32_t index = (start + i) % LKUSER_MAX_PROCS;
+        pid_slot &s = slots[index];
+
+        proc *expected = nullptr;
+        if (__atomic_load_n(&s.p, __ATOMIC_RELAXED) ||
+            !__atomic_compare_exchange_n(&s.p, &expected, p, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            continue;
+        }
+
+        // the slot is ours, its generation only changes when it is freed
+        const uint32_t pid = s.gen * LKUSER_MAX_PROCS + index + 1;
+        LTRACEF("proc %p, pid %u\n", p, pid);
+        return pid;
+    }
+
+    return ERR_NO_RESOURCES;
+}
+
+void pid_free(proc *p) {
+    pid_slot &s = slots[slot_index(p->get_pid())];
+    DEBUG_ASSERT(s.p == p);
+
+    s.gen = (s.gen + 1) % max_gen;
+    __atomic_store_n(&s.p, nullptr, __ATOMIC_SEQ_CST);
+
+    // any lookup that saw the pointer is about to take its reference
+    while (__atomic_load_n(&s.readers, __ATOMIC_SEQ_CST)) {
+        thread_yield();
+    }
+}
+
+proc *pid_lookup(uint32_t pid) {
+    if (pid == 0) {
+        return nullptr;
+    }
+
+    return acquire_slot(slots[slot_index(pid)], pid);
+}
+
+proc *pid_next(uint32_t *cursor) {
+    for (; *cursor < LKUSER_MAX_PROCS; (*cursor)++) {
+        proc *p = acquire_slot(slots[*cursor], 0);
+        if (p) {
+            (*cursor)++;
+            return p;
+        }
+    }
+
+    return nullptr;
+}
+
+} // namespace lkuser
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <sys/types.h>
+
+namespace lkuser {
+
+class proc;
+
+// upper bound on the number of processes in existence at once
+#ifndef LKUSER_MAX_PROCS
+#define LKUSER_MAX_PROCS 1024
+#endif
+
+// table of live processes indexed by pid. a pid picks its slot directly and
+// the slot's generation is folded into the pid, so a pid is not handed out
+// again until its slot has been reused many times over. lookups take no
+// locks, they announce themselves on the slot for the moment it takes to
+// grab a reference and removal waits them out.
+
+// give p a slot in the table, returning its pid or ERR_NO_RESOURCES when full
+int pid_alloc(proc *p);
+
+// take p out of the table. once this returns no lookup can find it.
+void pid_free(proc *p);
+
+// find a process by pid, returned with a reference held, or null
+proc *pid_lookup(uint32_t pid);
+
+// the first process at or past slot *cursor, returned with a reference held
+// and *cursor moved past it, or null at the end of the table
+proc *pid_next(uint32_t *cursor);
+
+} // namespace lkuser
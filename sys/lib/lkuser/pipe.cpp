@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "pipe.h"
+
+#include <string.h>
+#include <lk/err.h>
+#include <lk/trace.h>
+
+#include "thread.h"
+
+#define LOCAL_TRACE 0
+
+namespace lkuser {
+
+namespace {
+
+// the buffer shared by both ends, freed when the last of them is
+class pipe {
+public:
+    pipe();
+    ~pipe();
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(pipe);
+
+    ssize_t read(char *buf, size_t len, bool block);
+    ssize_t write(const char *buf, size_t len, bool block);
+    uint32_t read_events();
+    uint32_t write_events();
+
+    // an end went away, dropping our reference once both have
+    void close_read();
+    void close_write();
+
+    poll_source read_source;
+    poll_source write_source;
+
+private:
+    void release();
+
+    Mutex lock_;
+    // signaled while there is data or no writer, or space or no reader
+    event_t readable_;
+    event_t writable_;
+
+    size_t head_ = 0;
+    size_t count_ = 0;
+    bool reader_ = true;
+    bool writer_ = true;
+    int ref_ = 2;
+
+    char buf_[LKUSER_PIPE_SIZE];
+};
+
+class pipe_end final : public file {
+public:
+    pipe_end(pipe *p, bool write, bool nonblock) : pipe_(p), write_(write), nonblock_(nonblock) {}
+    ~pipe_end() override {
+        if (write_) {
+            pipe_->close_write();
+        } else {
+            pipe_->close_read();
+        }
+    }
+
+    ssize_t read(char *buf, size_t len) override {
+        return write_ ? ERR_ACCESS_DENIED : pipe_->read(buf, len, !nonblock_);
+    }
+    ssize_t write(const char *buf, size_t len) override {
+        return write_ ? pipe_->write(buf, len, !nonblock_) : ERR_ACCESS_DENIED;
+    }
+    status_t stat(lkuser_stat *st) override {
+        st->mode = LKUSER_S_IFIFO;
+        st->size = 0;
+        return NO_ERROR;
+    }
+    uint32_t poll_events() override {
+        return write_ ? pipe_->write_events() : pipe_->read_events();
+    }
+    poll_source *get_poll_source() override {
+        return write_ ? &pipe_->write_source : &pipe_->read_source;
+    }
+
+private:
+    pipe *pipe_;
+    const bool write_;
+    const bool nonblock_;
+};
+
+pipe::pipe() {
+    event_init(&readable_, false, 0);
+    event_init(&writable_, true, 0);
+}
+
+pipe::~pipe() {
+    event_destroy(&readable_);
+    event_destroy(&writable_);
+}
+
+void pipe::release() {
+    if (__atomic_sub_fetch(&ref_, 1, __ATOMIC_ACQ_REL) == 0) {
+        delete this;
+    }
+}
+
+ssize_t pipe::read(char *buf, size_t len, bool block) {
+    lock_.acquire();
+
+    while (count_ == 0) {
+        if (!writer_ || !block) {
+            lock_.release();
+            // no writer left is the end of the file
+            return writer_ ? ERR_NOT_READY : 0;
+        }
+        // writers signal under the lock, so nothing is missed in between
+        event_unsignal(&readable_);
+        lock_.release();
+        status_t err = killable_wait(&readable_);
+        if (err < 0) {
+            return err;
+        }
+        lock_.acquire();
+    }
+
+    size_t pos = 0;
+    while (pos < len && count_ > 0) {
+        size_t chunk = MIN(len - pos, MIN(count_, LKUSER_PIPE_SIZE - head_));
+        memcpy(buf + pos, buf_ + head_, chunk);
+        head_ = (head_ + chunk) % LKUSER_PIPE_SIZE;
+        count_ -= chunk;
+        pos += chunk;
+    }
+
+    event_signal(&writable_, false);
+    write_source.notify(LKUSER_POLLOUT);
+    lock_.release();
+
+    LTRACEF("pipe %p: read %zu\n", this, pos);
+    return pos;
+}
+
+ssize_t pipe::write(const char *buf, size_t len, bool block) {
+    lock_.acquire();
+
+    // all of it goes in unless the reader leaves or we would block
+    size_t pos = 0;
+    status_t err = NO_ERROR;
+    while (pos < len) {
+        if (!reader_) {
+            err = ERR_CHANNEL_CLOSED;
+            break;
+        }
+
+        if (count_ == LKUSER_PIPE_SIZE) {
+            if (!block) {
+                err = ERR_NOT_READY;
+                break;
+            }
+            event_unsignal(&writable_);
+            lock_.release();
+            err = killable_wait(&writable_);
+            lock_.acquire();
+            if (err < 0) {
+                break;
+            }
+            continue;
+        }
+
+        size_t tail = (head_ + count_) % LKUSER_PIPE_SIZE;
+        size_t chunk = MIN(len - pos, MIN(LKUSER_PIPE_SIZE - count_, LKUSER_PIPE_SIZE - tail));
+        memcpy(buf_ + tail, buf + pos, chunk);
+        count_ += chunk;
+        pos += chunk;
+
+        event_signal(&readable_, false);
+        read_source.notify(LKUSER_POLLIN);
+    }
+
+    lock_.release();
+
+    LTRACEF("pipe %p: wrote %zu, err %d\n", this, pos, err);
+    return pos ? (ssize_t)pos : err;
+}
+
+uint32_t pipe::read_events() {
+    AutoLock guard(lock_);
+
+    uint32_t events = 0;
+    if (count_ > 0) {
+        events |= LKUSER_POLLIN;
+    }
+    if (!writer_) {
+        events |= LKUSER_POLLHUP;
+    }
+    return events;
+}
+
+uint32_t pipe::write_events() {
+    AutoLock guard(lock_);
+
+    if (!reader_) {
+        return LKUSER_POLLERR;
+    }
+    return (count_ < LKUSER_PIPE_SIZE) ? LKUSER_POLLOUT : 0;
+}
+
+void pipe::close_read() {
+    {
+        AutoLock guard(lock_);
+        reader_ = false;
+        // blocked writers find out there is no one to read
+        event_signal(&writable_, false);
+        write_source.notify(LKUSER_POLLERR);
+    }
+    release();
+}
+
+void pipe::close_write() {
+    {
+        AutoLock guard(lock_);
+        writer_ = false;
+        // blocked readers see the end of the data
+        event_signal(&readable_, false);
+        read_source.notify(LKUSER_POLLHUP);
+    }
+    release();
+}
+
+} // namespace
+
+status_t pipe_create(int flags, file **read_end, file **write_end) {
+    pipe *p = new pipe();
+    if (!p) {
+        return ERR_NO_MEMORY;
+    }
+
+    bool nonblock = flags & LKUSER_O_NONBLOCK;
+    file *r = new pipe_end(p, false, nonblock);
+    if (!r) {
+        delete p;
+        return ERR_NO_MEMORY;
+    }
+    file *w = new pipe_end(p, true, nonblock);
+    if (!w) {
+        // takes the pipe's read reference with it
+        r->release();
+        p->close_write();
+        return ERR_NO_MEMORY;
+    }
+
+    *read_end = r;
+    *write_end = w;
+    return NO_ERROR;
+}
+
+} // namespace lkuser
@@ -0,0 +1,444 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "poll.h"
+
+#include <assert.h>
+#include <string.h>
+#include <lk/err.h>
+#include <lk/trace.h>
+#include <kernel/thread.h>
+#include <platform.h>
+
+#include "proc.h"
+#include "thread.h"
+
+#define LOCAL_TRACE 0
+
+namespace lkuser {
+
+namespace {
+
+// errors and hangups are reported whether they were asked for or not
+constexpr uint32_t always_reported = LKUSER_POLLERR | LKUSER_POLLHUP;
+
+lk_time_t to_timeout(int timeout_msec) {
+    return (timeout_msec < 0) ? INFINITE_TIME : (lk_time_t)timeout_msec;
+}
+
+// how long to wait for a wake, false once the timeout has run out
+bool wait_time(lk_time_t start, lk_time_t timeout, lk_time_t *wait) {
+    *wait = INFINITE_TIME;
+    if (timeout != INFINITE_TIME) {
+        lk_time_t elapsed = current_time() - start;
+        if (elapsed >= timeout) {
+            return false;
+        }
+        *wait = timeout - elapsed;
+    }
+    return true;
+}
+
+// a descriptor being waited on by poll_fds()
+struct poll_slot {
+    poll_entry entry;
+    file *f;
+    poll_source *source;
+    event_t *event;
+};
+
+void poll_wake(poll_entry *e, uint32_t events) {
+    poll_slot *slot = containerof(e, poll_slot, entry);
+    event_signal(slot->event, false);
+}
+
+} // namespace
+
+poll_source::~poll_source() {
+    DEBUG_ASSERT(list_is_empty(&entries_));
+}
+
+void poll_source::add(poll_entry *e) {
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&lock_, state);
+    list_add_tail(&entries_, &e->node);
+    spin_unlock_irqrestore(&lock_, state);
+}
+
+void poll_source::remove(poll_entry *e) {
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&lock_, state);
+    list_delete(&e->node);
+    spin_unlock_irqrestore(&lock_, state);
+}
+
+void poll_source::notify(uint32_t events) {
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&lock_, state);
+    poll_entry *e;
+    list_for_every_entry(&entries_, e, poll_entry, node) {
+        e->wake(e, events);
+    }
+    spin_unlock_irqrestore(&lock_, state);
+}
+
+int poll_fds(proc *p, lkuser_pollfd *fds, size_t nfds, int timeout_msec) {
+    LTRACEF("fds %p, nfds %zu, timeout %d\n", fds, nfds, timeout_msec);
+
+    if (nfds > LKUSER_MAX_FDS) {
+        return ERR_INVALID_ARGS;
+    }
+
+    poll_slot stack_slots[LKUSER_POLL_STACK_FDS];
+    poll_slot *slots = stack_slots;
+    if (nfds > LKUSER_POLL_STACK_FDS) {
+        slots = new poll_slot[nfds];
+        if (!slots) {
+            return ERR_NO_MEMORY;
+        }
+    }
+
+    event_t event;
+    event_init(&event, false, EVENT_FLAG_AUTOUNSIGNAL);
+
+    // hook onto everything before the first look, so that nothing that
+    // becomes ready in between is missed
+    for (size_t i = 0; i < nfds; i++) {
+        poll_slot &s = slots[i];
+        s.entry.wake = &poll_wake;
+        s.event = &event;
+        s.f = (fds[i].fd >= 0) ? p->get_fds().get(fds[i].fd) : nullptr;
+        s.source = s.f ? s.f->get_poll_source() : nullptr;
+        if (s.source) {
+            s.source->add(&s.entry);
+        }
+    }
+
+    lk_time_t start = current_time();
+    lk_time_t timeout = to_timeout(timeout_msec);
+    int ready;
+    for (;;) {
+        ready = 0;
+        for (size_t i = 0; i < nfds; i++) {
+            uint32_t revents;
+            if (fds[i].fd < 0) {
+                // negative descriptors are skipped
+                revents = 0;
+            } else if (!slots[i].f) {
+                revents = LKUSER_POLLNVAL;
+            } else {
+                revents = slots[i].f->poll_events() & ((uint16_t)fds[i].events | always_reported);
+            }
+            fds[i].revents = (int16_t)revents;
+            if (revents) {
+                ready++;
+            }
+        }
+
+        lk_time_t wait;
+        if (ready || !wait_time(start, timeout, &wait)) {
+            break;
+        }
+        if (killable_wait(&event, wait) == ERR_CANCELLED) {
+            ready = ERR_CANCELLED;
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < nfds; i++) {
+        if (slots[i].source) {
+            slots[i].source->remove(&slots[i].entry);
+        }
+        if (slots[i].f) {
+            slots[i].f->release();
+        }
+    }
+    event_destroy(&event);
+
+    if (slots != stack_slots) {
+        delete[] slots;
+    }
+
+    LTRACEF("%d ready\n", ready);
+    return ready;
+}
+
+// a file in an interest set
+struct epoll_file::item {
+    poll_entry entry;
+    epoll_file *set;
+    file *f;
+    poll_source *source;
+    int fd;
+    uint32_t events;
+    uint64_t data;
+
+    list_node node = LIST_INITIAL_CLEARED_VALUE;
+    // on the ready list, or being looked at by a wait, under ready_lock_
+    list_node ready_node = LIST_INITIAL_CLEARED_VALUE;
+    bool ready = false;
+    // woken again while a wait was looking at it
+    bool rewoken = false;
+};
+
+epoll_file::epoll_file() {
+    event_init(&ready_event_, false, EVENT_FLAG_AUTOUNSIGNAL);
+}
+
+epoll_file::~epoll_file() {
+    item *i;
+    while ((i = list_peek_head_type(&items_, item, node))) {
+        remove_locked(i);
+    }
+    event_destroy(&ready_event_);
+}
+
+status_t epoll_file::stat(lkuser_stat *st) {
+    st->mode = 0;
+    st->size = 0;
+    return NO_ERROR;
+}
+
+poll_source *epoll_file::get_poll_source() {
+    return &source_;
+}
+
+uint32_t epoll_file::poll_events() {
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&ready_lock_, state);
+    bool ready = !list_is_empty(&ready_);
+    spin_unlock_irqrestore(&ready_lock_, state);
+
+    return ready ? LKUSER_POLLIN : 0;
+}
+
+// called from the file's poll source
+void epoll_file::wake(poll_entry *e, uint32_t events) {
+    item *i = containerof(e, item, entry);
+    if (events & (i->events | always_reported)) {
+        i->set->make_ready(i);
+    }
+}
+
+void epoll_file::make_ready(item *i) {
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&ready_lock_, state);
+    bool queued = false;
+    if (!i->ready) {
+        i->ready = true;
+        list_add_tail(&ready_, &i->ready_node);
+        queued = true;
+    } else {
+        i->rewoken = true;
+    }
+    spin_unlock_irqrestore(&ready_lock_, state);
+
+    if (queued) {
+        event_signal(&ready_event_, false);
+        source_.notify(LKUSER_POLLIN);
+    }
+}
+
+epoll_file::item *epoll_file::find_locked(int fd) {
+    item *i;
+    list_for_every_entry(&items_, i, item, node) {
+        if (i->fd == fd) {
+            return i;
+        }
+    }
+    return nullptr;
+}
+
+void epoll_file::remove_locked(item *i) {
+    // no more wakes once it is off the source
+    if (i->source) {
+        i->source->remove(&i->entry);
+    }
+
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&ready_lock_, state);
+    if (i->ready) {
+        list_delete(&i->ready_node);
+        i->ready = false;
+    }
+    spin_unlock_irqrestore(&ready_lock_, state);
+
+    list_delete(&i->node);
+    i->f->release();
+    delete i;
+}
+
+status_t epoll_file::ctl(proc *p, int op, int fd, const lkuser_epoll_event *ev) {
+    LTRACEF("op %d, fd %d\n", op, fd);
+
+    AutoLock guard(lock_);
+
+    item *i = find_locked(fd);
+    switch (op) {
+        case LKUSER_EPOLL_CTL_ADD: {
+            if (i) {
+                return ERR_ALREADY_EXISTS;
+            }
+
+            file *f = p->get_fds().get(fd);
+            if (!f) {
+                return ERR_BAD_HANDLE;
+            }
+            // sets inside sets could wake each other in a loop
+            if (f->as_epoll()) {
+                f->release();
+                return ERR_INVALID_ARGS;
+            }
+
+            i = new item;
+            if (!i) {
+                f->release();
+                return ERR_NO_MEMORY;
+            }
+            i->entry.wake = &epoll_file::wake;
+            i->set = this;
+            i->f = f;
+            i->source = f->get_poll_source();
+            i->fd = fd;
+            i->events = ev->events;
+            i->data = ev->data;
+            list_add_tail(&items_, &i->node);
+
+            if (i->source) {
+                i->source->add(&i->entry);
+            }
+            // look at it on the next wait, in case it is ready already
+            make_ready(i);
+            return NO_ERROR;
+        }
+        case LKUSER_EPOLL_CTL_MOD:
+            if (!i) {
+                return ERR_NOT_FOUND;
+            }
+            i->events = ev->events;
+            i->data = ev->data;
+            make_ready(i);
+            return NO_ERROR;
+        case LKUSER_EPOLL_CTL_DEL:
+            if (!i) {
+                return ERR_NOT_FOUND;
+            }
+            remove_locked(i);
+            return NO_ERROR;
+        default:
+            return ERR_INVALID_ARGS;
+    }
+}
+
+// report one item if it is ready, returning false if it is not
+bool epoll_file::report_locked(item *i, lkuser_epoll_event *ev) {
+    uint32_t mask = i->events & ~(LKUSER_EPOLLET | LKUSER_EPOLLONESHOT);
+    if (!mask) {
+        return false;
+    }
+
+    uint32_t revents = i->f->poll_events() & (mask | always_reported);
+    if (!revents) {
+        return false;
+    }
+
+    ev->events = revents;
+    ev->reserved = 0;
+    ev->data = i->data;
+
+    if (i->events & LKUSER_EPOLLONESHOT) {
+        // disarmed until it is modified
+        i->events = 0;
+    }
+    return true;
+}
+
+// take everything off the ready list and report the items that really are
+// ready. level triggered items that still are go back on the end of the list
+// for the next wait, the rest stay off until their file wakes them again.
+size_t epoll_file::collect_locked(lkuser_epoll_event *events, size_t max) {
+    list_node pending = LIST_INITIAL_VALUE(pending);
+
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&ready_lock_, state);
+    item *i;
+    while ((i = list_remove_head_type(&ready_, item, ready_node))) {
+        i->rewoken = false;
+        list_add_tail(&pending, &i->ready_node);
+    }
+    spin_unlock_irqrestore(&ready_lock_, state);
+
+    size_t count = 0;
+    while ((i = list_remove_head_type(&pending, item, ready_node))) {
+        bool requeue;
+        if (count == max) {
+            // not looked at, leave it for the next wait
+            requeue = true;
+        } else if (report_locked(i, &events[count])) {
+            count++;
+            requeue = !(i->events & LKUSER_EPOLLET) && i->events;
+        } else {
+            requeue = false;
+        }
+
+        spin_lock_irqsave(&ready_lock_, state);
+        // a wake while we were looking at it means it may have just become
+        // ready, so it gets another look
+        if (requeue || i->rewoken) {
+            list_add_tail(&ready_, &i->ready_node);
+        } else {
+            i->ready = false;
+        }
+        spin_unlock_irqrestore(&ready_lock_, state);
+    }
+
+    return count;
+}
+
+int epoll_file::wait(lkuser_epoll_event *events, size_t max, int timeout_msec) {
+    LTRACEF("events %p, max %zu, timeout %d\n", events, max, timeout_msec);
+
+    if (max == 0) {
+        return ERR_INVALID_ARGS;
+    }
+
+    lk_time_t start = current_time();
+    lk_time_t timeout = to_timeout(timeout_msec);
+    for (;;) {
+        size_t count;
+        {
+            AutoLock guard(lock_);
+            count = collect_locked(events, max);
+        }
+
+        lk_time_t wait;
+        if (count || !wait_time(start, timeout, &wait)) {
+            LTRACEF("%zu ready\n", count);
+            return (int)count;
+        }
+        if (killable_wait(&ready_event_, wait) == ERR_CANCELLED) {
+            return ERR_CANCELLED;
+        }
+    }
+}
+
+} // namespace lkuser
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <sys/types.h>
+#include <lk/cpp.h>
+#include <lk/list.h>
+#include <kernel/event.h>
+#include <kernel/mutex.h>
+#include <kernel/spinlock.h>
+#include <sys/lkuser_abi.h>
+
+#include "fd.h"
+
+namespace lkuser {
+
+class proc;
+
+// poll() sets up to this many descriptors without allocating
+#ifndef LKUSER_POLL_STACK_FDS
+#define LKUSER_POLL_STACK_FDS 8
+#endif
+
+// a waiter hooked onto a poll_source. wake is called with the source's
+// spinlock held, possibly from a timer callback, so it may only signal.
+struct poll_entry {
+    list_node node = LIST_INITIAL_CLEARED_VALUE;
+    void (*wake)(poll_entry *e, uint32_t events) = nullptr;
+};
+
+// where a file announces that it may have become ready
+class poll_source {
+public:
+    poll_source() = default;
+    ~poll_source();
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(poll_source);
+
+    void add(poll_entry *e);
+    void remove(poll_entry *e);
+
+    // tell every waiter that the LKUSER_POLL* events may now be ready
+    void notify(uint32_t events);
+
+private:
+    spin_lock_t lock_ = SPIN_LOCK_INITIAL_VALUE;
+    list_node entries_ = LIST_INITIAL_VALUE(entries_);
+};
+
+// wait up to timeout_msec, or forever if negative, for any of the
+// descriptors to become ready, filling in their revents. returns how many are
+// ready.
+int poll_fds(proc *p, lkuser_pollfd *fds, size_t nfds, int timeout_msec);
+
+// an interest set, read through a file descriptor. every file added is
+// watched through its poll source, so a wait only looks at the files that
+// announced a change since the last one.
+class epoll_file final : public file {
+public:
+    epoll_file();
+    ~epoll_file() override;
+
+    status_t stat(lkuser_stat *st) override;
+    // ready while anything is on the ready list
+    uint32_t poll_events() override;
+    poll_source *get_poll_source() override;
+    epoll_file *as_epoll() override { return this; }
+
+    // LKUSER_EPOLL_CTL_* on descriptor fd of process p
+    status_t ctl(proc *p, int op, int fd, const lkuser_epoll_event *ev);
+
+    // wait up to timeout_msec, forever if negative, for up to max events
+    int wait(lkuser_epoll_event *events, size_t max, int timeout_msec);
+
+private:
+    struct item;
+
+    static void wake(poll_entry *e, uint32_t events);
+    item *find_locked(int fd);
+    void remove_locked(item *i);
+    void make_ready(item *i);
+    bool report_locked(item *i, lkuser_epoll_event *ev);
+    size_t collect_locked(lkuser_epoll_event *events, size_t max);
+
+    // protects the item list, held across a wait's scan of the ready list
+    Mutex lock_;
+    list_node items_ = LIST_INITIAL_VALUE(items_);
+
+    // items that may be ready, touched from wake() under ready_lock_
+    spin_lock_t ready_lock_ = SPIN_LOCK_INITIAL_VALUE;
+    list_node ready_ = LIST_INITIAL_VALUE(ready_);
+    event_t ready_event_;
+
+    // for waiting on the set itself with poll()
+    poll_source source_;
+};
+
+} // namespace lkuser
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <lk/trace.h>
+#include <arch/ops.h>
+
+#define LOCAL_TRACE 0
+
+namespace lkuser {
+
+namespace {
+
+bool pools_enabled = true;
+
+} // namespace
+
+block_pool *block_pool::pools_;
+
+block_pool kstack_pool("kernel stack", DEFAULT_STACK_SIZE,
+                       LKUSER_KSTACK_POOL_LOW_WATER, LKUSER_KSTACK_POOL_HIGH_WATER);
+
+// pools are global objects, constructed before any threads are around
+block_pool::block_pool(const char *name, size_t block_size, size_t low_water, size_t high_water)
+    : name_(name), block_size_(block_size), low_water_(low_water), high_water_(high_water) {
+    next_ = pools_;
+    pools_ = this;
+}
+
+void block_pool::set_enabled(bool enabled) {
+    __atomic_store_n(&pools_enabled, enabled, __ATOMIC_RELAXED);
+}
+
+bool block_pool::enabled() {
+    return __atomic_load_n(&pools_enabled, __ATOMIC_RELAXED);
+}
+
+block_pool::free_block *block_pool::take_locked(cpu_cache &c, size_t count) {
+    free_block *list = nullptr;
+    for (; count > 0 && c.head; count--) {
+        free_block *b = c.head;
+        c.head = b->next;
+        c.count--;
+        b->next = list;
+        list = b;
+    }
+    return list;
+}
+
+void block_pool::free_list(free_block *list) {
+    while (list) {
+        free_block *next = list->next;
+        ::free(list);
+        list = next;
+    }
+}
+
+void *block_pool::alloc() {
+    if (!enabled()) {
+        return malloc(block_size_);
+    }
+
+    // whichever cpu we end up on, any cache will do
+    cpu_cache &c = caches_[arch_curr_cpu_num()];
+
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&c.lock, state);
+    free_block *b = take_locked(c, 1);
+    spin_unlock_irqrestore(&c.lock, state);
+
+    if (b) {
+        __atomic_fetch_add(&hits_, 1, __ATOMIC_RELAXED);
+        return b;
+    }
+
+    __atomic_fetch_add(&misses_, 1, __ATOMIC_RELAXED);
+    return malloc(block_size_);
+}
+
+void block_pool::free(void *block) {
+    if (!block) {
+        return;
+    }
+    if (!enabled()) {
+        ::free(block);
+        return;
+    }
+
+    cpu_cache &c = caches_[arch_curr_cpu_num()];
+    free_block *b = (free_block *)block;
+
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&c.lock, state);
+    b->next = c.head;
+    c.head = b;
+    c.count++;
+    free_block *trimmed = nullptr;
+    if (c.count > high_water_) {
+        trimmed = take_locked(c, c.count - low_water_);
+    }
+    spin_unlock_irqrestore(&c.lock, state);
+
+    free_list(trimmed);
+}
+
+void block_pool::flush() {
+    for (auto &c : caches_) {
+        spin_lock_saved_state_t state;
+        spin_lock_irqsave(&c.lock, state);
+        free_block *list = take_locked(c, c.count);
+        spin_unlock_irqrestore(&c.lock, state);
+
+        free_list(list);
+    }
+}
+
+void block_pool::dump() const {
+    size_t cached = 0;
+    for (auto &c : caches_) {
+        cached += __atomic_load_n(&c.count, __ATOMIC_RELAXED);
+    }
+
+    printf("%-14s %6zu bytes, %4zu cached (low %zu high %zu per cpu), %llu hits, %llu misses\n",
+           name_, block_size_, cached, low_water_, high_water_,
+           (unsigned long long)hits_, (unsigned long long)misses_);
+}
+
+} // namespace lkuser
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <sys/types.h>
+#include <lk/cpp.h>
+#include <kernel/spinlock.h>
+#include <kernel/thread.h>
+
+namespace lkuser {
+
+// how many freed objects each cpu keeps for reuse. a cache that grows past
+// its high water mark is trimmed back to the low one.
+#ifndef LKUSER_POOL_LOW_WATER
+#define LKUSER_POOL_LOW_WATER 8
+#endif
+#ifndef LKUSER_POOL_HIGH_WATER
+#define LKUSER_POOL_HIGH_WATER 32
+#endif
+
+// the same for kernel stacks, which are a lot bigger
+#ifndef LKUSER_KSTACK_POOL_LOW_WATER
+#define LKUSER_KSTACK_POOL_LOW_WATER 4
+#endif
+#ifndef LKUSER_KSTACK_POOL_HIGH_WATER
+#define LKUSER_KSTACK_POOL_HIGH_WATER 16
+#endif
+
+// per cpu caches of fixed size blocks from the heap, for the objects created
+// and destroyed with every process and thread
+class block_pool {
+public:
+    block_pool(const char *name, size_t block_size, size_t low_water, size_t high_water);
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(block_pool);
+
+    void *alloc();
+    void free(void *block);
+
+    // give every cached block back to the heap
+    void flush();
+
+    void dump() const;
+
+    // turn caching off or on for every pool, for comparing the two
+    static void set_enabled(bool enabled);
+    static bool enabled();
+
+    // run func on every pool
+    template <typename F>
+    static void for_every_pool(F func) {
+        for (block_pool *p = pools_; p; p = p->next_) {
+            func(p);
+        }
+    }
+
+private:
+    struct free_block {
+        free_block *next;
+    };
+
+    struct cpu_cache {
+        spin_lock_t lock = SPIN_LOCK_INITIAL_VALUE;
+        free_block *head = nullptr;
+        size_t count = 0;
+    };
+
+    // unlink up to count blocks from the cache, to be freed without the lock
+    static free_block *take_locked(cpu_cache &c, size_t count);
+    static void free_list(free_block *list);
+
+    const char *name_;
+    size_t block_size_;
+    size_t low_water_;
+    size_t high_water_;
+
+    cpu_cache caches_[SMP_MAX_CPUS];
+
+    // allocations served from a cache and from the heap
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+
+    block_pool *next_ = nullptr;
+    static block_pool *pools_;
+};
+
+// kernel stacks for lkuser threads, DEFAULT_STACK_SIZE each
+extern block_pool kstack_pool;
+
+} // namespace lkuser
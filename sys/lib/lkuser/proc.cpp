@@ -22,32 +22,74 @@
  */
 #include "proc.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <lk/err.h>
 #include <lk/init.h>
 #include <lk/trace.h>
+#include <kernel/mp.h>
 #include <kernel/vm.h>
-
+#include <platform.h>
+
+#include "aspace.h"
+#include "console.h"
+#include "image.h"
+#include "kdata.h"
+#include "pid.h"
+#include "pool.h"
+#include "template.h"
 #include "thread.h"
+#include "uring.h"
 #include "lkuser_priv.h"
 
 #define LOCAL_TRACE 0
 
 namespace lkuser {
 
-// event to kick off a pass of the reaper thread
-event_t reap_event = EVENT_INITIAL_VALUE(reap_event, false, EVENT_FLAG_AUTOUNSIGNAL);
+namespace {
+
+// dead processes waiting to be torn down by one of the reaper threads. an
+// exiting process pushes itself onto the queue of the cpu it is running on
+// without taking a lock, and the reaper takes the whole queue in one go.
+struct reap_queue {
+    proc *head = nullptr;
+    event_t event = EVENT_INITIAL_VALUE(event, false, EVENT_FLAG_AUTOUNSIGNAL);
+};
+
+reap_queue reap_queues[SMP_MAX_CPUS];
 
-// list of processes
-list_node proc_list = LIST_INITIAL_VALUE(proc_list);
-Mutex proc_list_lock;
+void queue_for_reaping(proc *p) {
+    reap_queue &q = reap_queues[arch_curr_cpu_num()];
 
-void add_to_global_list(proc *p) {
-    AutoLock guard(proc_list_lock);
-    list_add_head(&proc_list, &p->node);
+    proc *head = __atomic_load_n(&q.head, __ATOMIC_RELAXED);
+    do {
+        p->reap_next = head;
+    } while (!__atomic_compare_exchange_n(&q.head, &head, p, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    event_signal(&q.event, false);
 }
 
+block_pool proc_pool("proc", sizeof(proc), LKUSER_POOL_LOW_WATER, LKUSER_POOL_HIGH_WATER);
+
+} // namespace
+
 proc::proc() = default;
-proc::~proc() = default;
+
+proc::~proc() {
+    free(args_);
+    event_destroy(&exit_event_);
+    event_destroy(&child_event_);
+}
+
+void *proc::operator new(size_t size) noexcept {
+    DEBUG_ASSERT(size == sizeof(proc));
+    return proc_pool.alloc();
+}
+
+void proc::operator delete(void *ptr) {
+    proc_pool.free(ptr);
+}
 
 proc *proc::create() {
     proc *p = new proc;
@@ -56,33 +98,373 @@ proc *proc::create() {
         return NULL;
     }
 
-    /* create an address space for it */
-    if (vmm_create_aspace(&p->aspace_, "lkuser", 0) < 0) {
-        TRACEF("error creating address space\n");
+    /* enter it in the pid table, where it can be looked up from now on */
+    int pid = pid_alloc(p);
+    if (pid < 0) {
+        TRACEF("out of pids\n");
         delete p;
         return NULL;
     }
+    p->pid_ = pid;
+
+    /* reuse the address space of a dead process if there is one, with the
+     * kernel data pages already mapped in it */
+    vm_page_t *kdata_page;
+    if (aspace_cache_get(&p->aspace_, &kdata_page)) {
+        kdata_reuse(p, kdata_page);
+    } else {
+        /* create an address space for it */
+        if (vmm_create_aspace(&p->aspace_, "lkuser", 0) < 0) {
+            TRACEF("error creating address space\n");
+            p->abort_create();
+            return NULL;
+        }
 
-    /* add the process to the process list */
-    add_to_global_list(p);
+        /* map the time and process information pages */
+        if (kdata_map(p) < 0) {
+            TRACEF("error mapping kernel data pages\n");
+            vmm_free_aspace(p->aspace_);
+            kdata_unmap(p);
+            p->abort_create();
+            return NULL;
+        }
+    }
+
+    /* hook the standard descriptors up to the console */
+    if (p->fds_.init_console(p) < 0) {
+        TRACEF("error setting up file descriptors\n");
+        vmm_free_aspace(p->aspace_);
+        kdata_unmap(p);
+        p->abort_create();
+        return NULL;
+    }
 
     return p;
 }
 
-status_t proc::add_thread(thread *t) {
+void proc::abort_create() {
+    // a lookup may have got hold of us in the meantime, let it have the last
+    // reference
+    pid_free(this);
+    release();
+}
+
+status_t proc::clone(proc *parent, proc **out) {
+    proc *p = create();
+    if (!p) {
+        return ERR_NO_MEMORY;
+    }
+
+    status_t err = parent->fds_.clone(p, p->fds_);
+    if (err >= 0 && parent->loader_.image) {
+        err = parent->loader_.image->clone(parent, p, &p->loader_.image);
+    }
+    if (err >= 0) {
+        err = parent->heap_.clone(parent, p, p->heap_);
+    }
+    if (err >= 0) {
+        err = parent->mappings_.clone(parent, p, p->mappings_);
+    }
+    if (err < 0) {
+        // never started, mark it dead and let the reaper have it
+        p->exit(err);
+        return err;
+    }
+
+    p->affinity_ = parent->affinity_;
+    p->stack_size_ = parent->stack_size_;
+    p->loader_.entry = parent->loader_.entry;
+    p->loader_.loaded = parent->loader_.loaded;
+
+    *out = p;
+    return NO_ERROR;
+}
+
+status_t proc::page_fault(vaddr_t addr, uint flags) {
+    if (flags & LKUSER_PF_FLAG_WRITE) {
+        status_t err = cow_fault(this, addr);
+        if (err != ERR_NOT_FOUND) {
+            return err;
+        }
+    }
+
+    // stacks growing into their reserved range
+    status_t err = mappings_.fault(this, addr, flags);
+    if (err != ERR_NOT_FOUND) {
+        return err;
+    }
+
+    if (!loader_.image) {
+        return ERR_NOT_FOUND;
+    }
+    return loader_.image->fault(this, addr, flags);
+}
+
+void proc::acquire() {
+    __atomic_add_fetch(&ref_, 1, __ATOMIC_RELAXED);
+}
+
+void proc::release() {
+    if (__atomic_sub_fetch(&ref_, 1, __ATOMIC_ACQ_REL) == 0) {
+        delete this;
+    }
+}
+
+status_t proc::set_args(const char * const *argv) {
+    int argc = 0;
+    size_t len = 0;
+    for (; argv && argv[argc]; argc++) {
+        if (argc == LKUSER_MAX_ARGS) {
+            return ERR_TOO_BIG;
+        }
+        len += strlen(argv[argc]) + 1;
+        if (len > LKUSER_MAX_ARGS_LEN) {
+            return ERR_TOO_BIG;
+        }
+    }
+
+    char *args = (char *)malloc(len ? len : 1);
+    if (!args) {
+        return ERR_NO_MEMORY;
+    }
+
+    char *pos = args;
+    for (int i = 0; i < argc; i++) {
+        size_t l = strlen(argv[i]) + 1;
+        memcpy(pos, argv[i], l);
+        pos += l;
+    }
+
+    free(args_);
+    args_ = args;
+    args_len_ = len;
+    argc_ = argc;
+
+    return NO_ERROR;
+}
+
+// called on the main thread with the address space active, leaves the stack
+// as argc, argv[0] .. argv[argc - 1], NULL, followed by the strings
+vaddr_t proc::push_args(vaddr_t sp) const {
+    sp -= ROUNDUP(args_len_, sizeof(uintptr_t));
+    char *strings = (char *)sp;
+    if (args_len_) {
+        memcpy(strings, args_, args_len_);
+    }
+
+    sp = ROUNDDOWN(sp - (argc_ + 2) * sizeof(uintptr_t), 16);
+    uintptr_t *vec = (uintptr_t *)sp;
+    vec[0] = argc_;
+    size_t offset = 0;
+    for (int i = 0; i < argc_; i++) {
+        vec[1 + i] = (uintptr_t)(strings + offset);
+        offset += strlen(strings + offset) + 1;
+    }
+    vec[1 + argc_] = 0;
+
+    return sp;
+}
+
+void proc::add_child(proc *child) {
+    {
+        AutoLock guard(children_lock_);
+        list_add_tail(&children_, &child->child_node);
+        __atomic_store_n(&child->parent_pid_, pid_, __ATOMIC_RELEASE);
+    }
+
+    // the child may have exited before it knew who to tell
+    event_signal(&child_event_, true);
+}
+
+int proc::wait_child(int pid, lk_time_t timeout, int *retcode) {
+    const lk_time_t start = current_time();
+
+    for (;;) {
+        proc *found = nullptr;
+        bool any = false;
+        {
+            AutoLock guard(children_lock_);
+
+            proc *c;
+            list_for_every_entry(&children_, c, proc, child_node) {
+                if (pid > 0 && c->get_pid() != (uint32_t)pid) {
+                    continue;
+                }
+                any = true;
+                if (c->exited()) {
+                    list_delete(&c->child_node);
+                    found = c;
+                    break;
+                }
+            }
+        }
+
+        if (found) {
+            int found_pid = found->get_pid();
+            if (retcode) {
+                *retcode = found->get_retcode();
+            }
+            found->release();
+            return found_pid;
+        }
+        if (!any) {
+            return ERR_NOT_FOUND;
+        }
+        if (timeout == 0) {
+            return ERR_NOT_READY;
+        }
+
+        // a child exiting wakes us up to look again
+        lk_time_t wait = INFINITE_TIME;
+        if (timeout != INFINITE_TIME) {
+            lk_time_t elapsed = current_time() - start;
+            if (elapsed >= timeout) {
+                return ERR_TIMED_OUT;
+            }
+            wait = timeout - elapsed;
+        }
+        if (killable_wait(&child_event_, wait) == ERR_CANCELLED) {
+            return ERR_CANCELLED;
+        }
+    }
+}
+
+void proc::child_exited() {
+    event_signal(&child_event_, true);
+}
+
+void proc::kill(int retcode) {
+    int expected = 0;
+    __atomic_compare_exchange_n(&kill_code_, &expected, retcode | kill_pending_flag, false,
+                                __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+
+    // threads blocked in a syscall give up and exit on the way out of it
+    {
+        AutoLock guard(thread_list_lock_);
+        thread *t;
+        list_for_every_entry(&thread_list_, t, thread, node) {
+            t->interrupt();
+        }
+    }
+
+    // threads running user code take the kill at their next interrupt, so
+    // make sure the other cpus get one
+    mp_reschedule(MP_CPU_ALL_BUT_LOCAL, 0);
+}
+
+bool proc::kill_pending(int *retcode) const {
+    int code = __atomic_load_n(&kill_code_, __ATOMIC_SEQ_CST);
+    if (!code) {
+        return false;
+    }
+    *retcode = code & ~kill_pending_flag;
+    return true;
+}
+
+int proc::add_thread(thread *t) {
     /* add the thread to the process */
+    AutoLock guard(thread_list_lock_);
+    list_add_head(&thread_list_, &t->node);
+    live_threads_++;
+
+    return next_tid_++;
+}
+
+thread *proc::take_thread(int tid) {
+    AutoLock guard(thread_list_lock_);
+
+    thread *t;
+    list_for_every_entry(&thread_list_, t, thread, node) {
+        if (t->get_tid() == tid) {
+            list_delete(&t->node);
+            return t;
+        }
+    }
+
+    return nullptr;
+}
+
+status_t proc::set_affinity(int tid, uint32_t mask) {
+    if (!(mask & mp_get_online_mask())) {
+        return ERR_INVALID_ARGS;
+    }
+
+    AutoLock guard(thread_list_lock_);
+
+    thread *t;
+    if (tid == 0) {
+        affinity_ = mask;
+        list_for_every_entry(&thread_list_, t, thread, node) {
+            t->set_affinity(mask);
+        }
+        return NO_ERROR;
+    }
+
+    list_for_every_entry(&thread_list_, t, thread, node) {
+        if (t->get_tid() == tid) {
+            t->set_affinity(mask);
+            return NO_ERROR;
+        }
+    }
+
+    return ERR_NOT_FOUND;
+}
+
+status_t proc::get_affinity(int tid, uint32_t *mask) {
+    AutoLock guard(thread_list_lock_);
+
+    if (tid == 0) {
+        *mask = affinity_ & mp_get_online_mask();
+        return NO_ERROR;
+    }
+
+    thread *t;
+    list_for_every_entry(&thread_list_, t, thread, node) {
+        if (t->get_tid() == tid) {
+            *mask = t->get_affinity();
+            return NO_ERROR;
+        }
+    }
+
+    return ERR_NOT_FOUND;
+}
+
+void proc::set_exit_code(int retcode) {
+    AutoLock guard(thread_list_lock_);
+
+    exit_code_set_ = true;
+    exit_code_ = retcode;
+}
+
+void proc::thread_exit(thread *t, int retcode) {
+    bool last;
+    int proc_retcode = retcode;
     {
         AutoLock guard(thread_list_lock_);
-        list_add_head(&thread_list_, &t->node);
+        last = (--live_threads_ == 0);
+        if (exit_code_set_) {
+            proc_retcode = exit_code_;
+        }
     }
 
-    return NO_ERROR;
+    t->exited(retcode);
+
+    if (last) {
+        exit(proc_retcode);
+    }
 }
 
 void proc::destroy() {
     // TODO: formalize the state machine more
     DEBUG_ASSERT(state_ == PROC_STATE_DEAD);
 
+    // stop anything still consuming the submission ring
+    if (uring_) {
+        uring_->shutdown();
+        delete uring_;
+        uring_ = nullptr;
+    }
+
     // clean up all the threads
     thread *t;
     while ((t = list_remove_head_type(&thread_list_, thread, node))) {
@@ -91,14 +473,36 @@ void proc::destroy() {
         delete t;
     }
 
-    // free everything inside the address space
-    vmm_free_aspace(aspace_);
+    // drop any files the process left open
+    fds_.close_all();
 
-    // no one should be waiting for to us
-    event_destroy(&exit_event_);
+    // children no one waited for carry on without us
+    proc *c;
+    {
+        AutoLock guard(children_lock_);
+        while ((c = list_remove_head_type(&children_, proc, child_node))) {
+            c->release();
+        }
+    }
+
+    // give back our pages, some of which may be shared with clones, then
+    // free everything inside the address space
+    mappings_.clear(this);
+    heap_.clear(this);
+    if (loader_.image) {
+        loader_.image->clear(this);
+    }
+    if (aspace_cache_put(aspace_, kdata_page_)) {
+        kdata_page_ = nullptr;
+    } else {
+        vmm_free_aspace(aspace_);
+        kdata_unmap(this);
+    }
+    aspace_ = nullptr;
 
-    // free any resources in the elf handle
-    elf_close_handle(&get_loader_state().elf);
+    // drop our private copies and the reference to the shared image
+    delete loader_.image;
+    loader_.image = nullptr;
 }
 
 status_t proc::wait() {
@@ -111,43 +515,71 @@ void proc::start() {
 
 void proc::exit(int retcode) {
     state_ = proc::PROC_STATE_DEAD;
-    retcode = retcode;
+    retcode_ = retcode;
+
+    if (loader_.report) {
+        loader_.report->exit_time = current_time_hires();
+        loader_.report->resident_pages = image_resident_pages(this);
+        loader_.report->private_pages = image_private_pages(this);
+        loader_.report->heap_bytes = heap_.get_committed();
+    }
+
+    // a template that never got as far as its ready point
+    if (template_) {
+        template_->exited();
+    }
+
+    // give any output the process queued a bounded amount of time to drain
+    console_flush(LKUSER_CONSOLE_EXIT_FLUSH_MSEC);
+
+    __atomic_store_n(&exited_, true, __ATOMIC_RELEASE);
     event_signal(&exit_event_, true);
+    exit_source_.notify(LKUSER_POLLIN);
+
+    // let a parent waiting on any of its children know
+    uint32_t parent_pid = __atomic_load_n(&parent_pid_, __ATOMIC_ACQUIRE);
+    if (parent_pid) {
+        proc *parent = pid_lookup(parent_pid);
+        if (parent) {
+            parent->child_exited();
+            parent->release();
+        }
+    }
 
-    // TODO: only trigger the reaper when the last thread exits
-    event_signal(&reap_event, true);
+    // we are called once, by the last thread out or on a process that never
+    // started, so the process can be queued for teardown straight away
+    queue_for_reaping(this);
 }
 
-// reaper thread that cleans up dead processes
+// reaper thread that cleans up dead processes, one per cpu
 static int reaper(void *arg) {
+    reap_queue &q = *(reap_queue *)arg;
+
     for (;;) {
-        event_wait(&reap_event);
-
-        for (;;) {
-            proc *found = NULL;
-            {
-                AutoLock guard(proc_list_lock);
-
-                proc *temp;
-                list_for_every_entry(&proc_list, temp, proc, node) {
-                    if (temp->get_state() == proc::PROC_STATE_DEAD) {
-                        list_delete(&temp->node);
-                        found = temp;
-                        break;
-                    }
-                }
-            }
+        event_wait(&q.event);
+
+        // take everything queued so far and put it back in exit order
+        proc *list = __atomic_exchange_n(&q.head, nullptr, __ATOMIC_ACQUIRE);
+        proc *next = nullptr;
+        while (list) {
+            proc *p = list;
+            list = p->reap_next;
+            p->reap_next = next;
+            next = p;
+        }
 
-            if (!found) {
-                break;
-            }
+        while (next) {
+            proc *p = next;
+            next = p->reap_next;
 
-            TRACEF("going to reap process %p\n", found);
+            LTRACEF("going to reap process %p\n", p);
 
-            found->destroy();
+            pid_free(p);
+            p->destroy();
 
-            // delete the process
-            delete found;
+            // drop the reference from create(), anyone still waiting on the
+            // process keeps it around until they are done
+            p->release();
         }
     }
 
@@ -155,7 +587,23 @@ static int reaper(void *arg) {
 }
 
 void lkuser_init(uint level) {
-    thread_detach_and_resume(thread_create("reaper", &reaper, NULL, HIGH_PRIORITY, DEFAULT_STACK_SIZE));
+    console_init();
+    kdata_init();
+
+    for (auto &q : reap_queues) {
+        uint cpu = (uint)(&q - reap_queues);
+        char name[16];
+        snprintf(name, sizeof(name), "reaper %u", cpu);
+        thread_t *t = thread_create(name, &reaper, &q, HIGH_PRIORITY, DEFAULT_STACK_SIZE);
+        if (!t) {
+            panic("error creating reaper thread\n");
+        }
+
+        // keep the teardown on the cpu whose processes queued it, where their
+        // state is still warm in the cache
+        thread_set_pinned_cpu(t, (int)cpu);
+        thread_detach_and_resume(t);
+    }
 }
 
 LK_INIT_HOOK(lkuser, lkuser_init, LK_INIT_LEVEL_THREADING);
@@ -163,3 +611,14 @@ LK_INIT_HOOK(lkuser, lkuser_init, LK_INIT_LEVEL_THREADING);
 
 } // namespace lkuser
 
+status_t lkuser_page_fault(vaddr_t addr, uint flags) {
+    lkuser::thread *t = (lkuser::thread *)tls_get(TLS_ENTRY_LKUSER);
+    if (!t) {
+        return ERR_NOT_FOUND;
+    }
+
+    LTRACEF("addr %#lx, flags %#x\n", addr, flags);
+
+    return t->get_proc()->page_fault(addr, flags);
+}
+
@@ -23,14 +23,34 @@
 #pragma once
 
 #include <lk/list.h>
-#include <lib/elf.h>
 #include <kernel/mutex.h>
 #include <kernel/event.h>
 #include <kernel/vm.h>
 
+#include "console.h"
+#include "cow.h"
+#include "fd.h"
+#include "heap.h"
+#include "mmap.h"
+#include "pid.h"
+#include "poll.h"
+#include "stats.h"
+
 namespace lkuser {
 
+// limits on the arguments passed to a new process, they have to fit on the
+// main thread's stack along with the argv array
+#ifndef LKUSER_MAX_ARGS
+#define LKUSER_MAX_ARGS 32
+#endif
+#ifndef LKUSER_MAX_ARGS_LEN
+#define LKUSER_MAX_ARGS_LEN 1024
+#endif
+
+class image_mapping;
+class proc_template;
 class thread;
+class uring;
 
 class proc {
 private:
@@ -41,22 +61,100 @@ private:
 public:
     ~proc();
 
+    // proc objects come from a per cpu pool rather than the heap
+    static void *operator new(size_t size) noexcept;
+    static void operator delete(void *ptr);
+
     static proc *create();
     void destroy();
 
-    status_t add_thread(thread *t);
+    // create a copy on write clone of parent's address space and files. the
+    // clone has no threads yet.
+    static status_t clone(proc *parent, proc **out);
+
+    // the reaper drops the reference create() returns once the process is
+    // destroyed, anyone else who wants to look at it afterwards holds another
+    void acquire();
+    void release();
+
+    // add a thread to the process, returning its thread id
+    int add_thread(thread *t);
+    // find a thread by id and take it off the thread list, for joining it
+    thread *take_thread(int tid);
+    // called by each thread as it exits, the last one takes the process with it
+    void thread_exit(thread *t, int retcode);
+    // exit code for the process, overriding that of its last thread
+    void set_exit_code(int retcode);
+
+    // cpus the threads of the process may run on. tid 0 means the process
+    // itself, whose mask applies to all of its threads, current and future.
+    status_t set_affinity(int tid, uint32_t mask);
+    status_t get_affinity(int tid, uint32_t *mask);
+    uint32_t get_affinity() const { return affinity_; }
+
     status_t wait(); // wait for process to exit
     void start();
     void exit(int retcode); // must be called by a thread in the process
+    bool exited() const { return __atomic_load_n(&exited_, __ATOMIC_ACQUIRE); }
+    int get_retcode() const { return retcode_; }
+
+    // arguments handed to main(), copied in before the process starts and
+    // laid out on the main thread's stack by push_args()
+    status_t set_args(const char * const *argv);
+    vaddr_t push_args(vaddr_t sp) const;
+
+    // resolve a fault on a user address that is unmapped or read only
+    status_t page_fault(vaddr_t addr, uint flags);
+
+    // processes spawned by this one, each holding a reference until waited for
+    void add_child(proc *child);
+
+    // wait up to timeout for the child with pid to exit, or any child if pid
+    // is -1, and take it off the list. returns its pid and exit code,
+    // ERR_NOT_FOUND with no such child and ERR_NOT_READY if timeout is 0 and
+    // none has exited yet.
+    int wait_child(int pid, lk_time_t timeout, int *retcode);
+
+    // called by a child of ours as it exits
+    void child_exited();
+
+    // ask the process to exit with retcode. each of its threads leaves on its
+    // way out of the kernel: blocked syscalls give up with ERR_CANCELLED, and
+    // threads running user code are stopped at their next interrupt.
+    void kill(int retcode);
+    bool kill_pending(int *retcode) const;
+
+    // pid of the process that will wait for us, 0 if none
+    uint32_t get_parent_pid() const { return __atomic_load_n(&parent_pid_, __ATOMIC_ACQUIRE); }
+
+    // size of the stack made for the main thread
+    size_t get_stack_size() const { return stack_size_; }
+    void set_stack_size(size_t size) { stack_size_ = size; }
+
+    // threads that have not exited yet
+    int get_thread_count() const { return __atomic_load_n(&live_threads_, __ATOMIC_RELAXED); }
 
     // accessors
     vmm_aspace_t *get_aspace() const { return aspace_; }
+    uint32_t get_pid() const { return pid_; }
+
+    // per process kernel data page
+    vm_page_t *get_kdata_page() const { return kdata_page_; }
+    void set_kdata_page(vm_page_t *page) { kdata_page_ = page; }
 
     // state of the loader
     struct loader_state {
-        elf_handle_t elf;
+        image_mapping *image; // the binary mapped into the process
         vaddr_t entry; // entry point to the binary
         bool loaded;
+
+        // if set, filled in when the process exits
+        struct exit_report {
+            lk_bigtime_t exit_time;
+            size_t resident_pages;
+            size_t private_pages;
+            size_t heap_bytes;
+        } *report;
     };
     loader_state &get_loader_state() { return loader_; }
     const loader_state &get_loader_state() const { return loader_; }
@@ -69,37 +167,121 @@ public:
     };
     state get_state() const { return state_; }
 
-    // sbrk state
-    struct sbrk_state {
-        uintptr_t last_sbrk;
-        uintptr_t last_sbrk_top;
-    };
-    sbrk_state &get_sbrk_state() { return sbrk_state_; }
-    const sbrk_state &get_sbrk_state() const { return sbrk_state_; }
+    // sbrk heap
+    heap &get_heap() { return heap_; }
+
+    // buffered console input
+    console_input &get_console_input() { return console_input_; }
+
+    // notified once the process has exited
+    poll_source &get_exit_source() { return exit_source_; }
+
+    // open file descriptors
+    fd_table &get_fds() { return fds_; }
 
-    // list node for the process list
-    list_node node = LIST_INITIAL_CLEARED_VALUE;
+    // regions created with mmap
+    mapping_table &get_mappings() { return mappings_; }
+
+    // pages waiting to be copied on their first write
+    cow_set &get_cow() { return cow_; }
+
+    // set if the process was launched to become a template
+    proc_template *get_template() const { return template_; }
+    void set_template(proc_template *t) { template_ = t; }
+
+    // submission/completion ring, if one was set up
+    uring *get_uring() const { return __atomic_load_n(&uring_, __ATOMIC_ACQUIRE); }
+    // install r unless another thread got there first, returning whether it did
+    bool set_uring(uring *r) {
+        uring *expected = nullptr;
+        return __atomic_compare_exchange_n(&uring_, &expected, r, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    }
+
+    // per process syscall counters
+    syscall_stats &get_syscall_stats() { return syscall_stats_; }
+
+    // list node for our parent's list of children
+    list_node child_node = LIST_INITIAL_CLEARED_VALUE;
+
+    // link in a reaper's queue of dead processes
+    proc *reap_next = nullptr;
 
 private:
+    // back out of a create() that failed after the pid was handed out
+    void abort_create();
+
     loader_state loader_ {};
 
+    int ref_ = 1;
+
+    // packed nul terminated argument strings
+    char *args_ = nullptr;
+    size_t args_len_ = 0;
+    int argc_ = 0;
+
+    list_node children_ = LIST_INITIAL_VALUE(children_);
+    Mutex children_lock_;
+    event_t child_event_ = EVENT_INITIAL_VALUE(child_event_, false, EVENT_FLAG_AUTOUNSIGNAL);
+    uint32_t parent_pid_ = 0;
+
+    // exit code of a pending kill, tagged so that a code of 0 still counts
+    static constexpr int kill_pending_flag = 0x40000000;
+    int kill_code_ = 0;
+
     // our address space
     vmm_aspace_t *aspace_ = nullptr;
 
+    uint32_t pid_ = 0;
+    vm_page_t *kdata_page_ = nullptr;
+
     // list of threads
     list_node thread_list_ = LIST_INITIAL_VALUE(thread_list_);
     Mutex thread_list_lock_;
 
-    int retcode_;
+    int next_tid_ = 1;
+    int live_threads_ = 0;
+
+    // every cpu by default
+    uint32_t affinity_ = ~0U;
+
+    size_t stack_size_ = LKUSER_STACK_SIZE;
+
+    int retcode_ = 0;
+    bool exit_code_set_ = false;
+    int exit_code_ = 0;
     state state_ = PROC_STATE_INITIAL;
+    bool exited_ = false;
 
     event_t exit_event_ = EVENT_INITIAL_VALUE(exit_event_, false, 0);
+    poll_source exit_source_;
+
+    heap heap_;
+
+    console_input console_input_;
+
+    fd_table fds_;
+
+    mapping_table mappings_;
+
+    cow_set cow_;
+
+    proc_template *template_ = nullptr;
+
+    syscall_stats syscall_stats_;
 
-    // sbrk information
-    sbrk_state sbrk_state_;
+    uring *uring_ = nullptr;
 };
 
-void add_to_global_list(proc *p);
+// call func on every process in existence, each with a reference held
+template <typename F>
+void for_every_proc(F func) {
+    uint32_t cursor = 0;
+    proc *p;
+    while ((p = pid_next(&cursor))) {
+        func(p);
+        p->release();
+    }
+}
 
 } // namespace lkuser
 
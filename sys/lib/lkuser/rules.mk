@@ -5,14 +5,43 @@ MODULE := $(LOCAL_DIR)
 GLOBAL_INCLUDES += $(LOCAL_DIR)/include
 
 MODULE_SRCS += $(LOCAL_DIR)/user.cpp
+MODULE_SRCS += $(LOCAL_DIR)/aspace.cpp
+MODULE_SRCS += $(LOCAL_DIR)/clock.cpp
+MODULE_SRCS += $(LOCAL_DIR)/console.cpp
+MODULE_SRCS += $(LOCAL_DIR)/cow.cpp
+MODULE_SRCS += $(LOCAL_DIR)/fault.cpp
+MODULE_SRCS += $(LOCAL_DIR)/fd.cpp
+MODULE_SRCS += $(LOCAL_DIR)/futex.cpp
+MODULE_SRCS += $(LOCAL_DIR)/heap.cpp
+MODULE_SRCS += $(LOCAL_DIR)/image.cpp
+MODULE_SRCS += $(LOCAL_DIR)/kdata.cpp
+MODULE_SRCS += $(LOCAL_DIR)/mmap.cpp
+MODULE_SRCS += $(LOCAL_DIR)/pid.cpp
+MODULE_SRCS += $(LOCAL_DIR)/pipe.cpp
+MODULE_SRCS += $(LOCAL_DIR)/poll.cpp
+MODULE_SRCS += $(LOCAL_DIR)/pool.cpp
 MODULE_SRCS += $(LOCAL_DIR)/proc.cpp
+MODULE_SRCS += $(LOCAL_DIR)/shm.cpp
+MODULE_SRCS += $(LOCAL_DIR)/stats.cpp
 MODULE_SRCS += $(LOCAL_DIR)/syscalls.cpp
+MODULE_SRCS += $(LOCAL_DIR)/template.cpp
 MODULE_SRCS += $(LOCAL_DIR)/thread.cpp
+MODULE_SRCS += $(LOCAL_DIR)/uring.cpp
 
 MODULE_DEPS += lib/bio
+MODULE_DEPS += lib/cbuf
 MODULE_DEPS += lib/elf
 MODULE_DEPS += lib/fs
 
 MODULE_COMPILEFLAGS += -Wno-invalid-offsetof
 
+# lk's fault handlers halt on any abort, so they are wrapped to give
+# lkuser_page_fault() the first look at user page faults, and the irq entry to
+# stop killed threads running user code. only the arch being built has
+# references to wrap, the other names are left alone.
+GLOBAL_LDFLAGS += --wrap=arm_data_abort_handler
+GLOBAL_LDFLAGS += --wrap=arm_prefetch_abort_handler
+GLOBAL_LDFLAGS += --wrap=platform_irq
+GLOBAL_LDFLAGS += --wrap=riscv_exception_handler
+
 include make/module.mk
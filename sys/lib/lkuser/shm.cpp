@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shm.h"
+
+#include <string.h>
+#include <lk/err.h>
+#include <lk/trace.h>
+#include <kernel/mutex.h>
+#include <sys/lkuser_abi.h>
+
+#define LOCAL_TRACE 0
+
+namespace lkuser {
+
+namespace {
+
+// an entry in the list of named objects, which holds a reference to it
+struct shm_name {
+    list_node node;
+    shm_object *shm;
+    char name[LKUSER_SHM_NAME_MAX];
+};
+
+Mutex names_lock;
+list_node names = LIST_INITIAL_VALUE(names);
+
+shm_name *find_locked(const char *name) {
+    shm_name *n;
+    list_for_every_entry(&names, n, shm_name, node) {
+        if (!strcmp(n->name, name)) {
+            return n;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+status_t shm_object::create(size_t size, shm_object **out) {
+    if (size == 0 || size > LKUSER_SHM_MAX) {
+        return ERR_INVALID_ARGS;
+    }
+
+    shm_object *shm = new shm_object();
+    if (!shm) {
+        return ERR_NO_MEMORY;
+    }
+
+    const size_t count = ROUNDUP(size, PAGE_SIZE) / PAGE_SIZE;
+    shm->pages_ = new vm_page_t *[count];
+    if (!shm->pages_) {
+        delete shm;
+        return ERR_NO_MEMORY;
+    }
+
+    for (; shm->page_count_ < count; shm->page_count_++) {
+        vm_page_t *page = pmm_alloc_page();
+        if (!page) {
+            shm->release();
+            return ERR_NO_MEMORY;
+        }
+        memset(paddr_to_kvaddr(vm_page_to_paddr(page)), 0, PAGE_SIZE);
+        shm->pages_[shm->page_count_] = page;
+    }
+
+    LTRACEF("shm %p: %zu pages\n", shm, count);
+
+    *out = shm;
+    return NO_ERROR;
+}
+
+shm_object::~shm_object() {
+    for (size_t i = 0; i < page_count_; i++) {
+        pmm_free_page(pages_[i]);
+    }
+    delete[] pages_;
+}
+
+void shm_object::release() {
+    if (__atomic_sub_fetch(&ref_, 1, __ATOMIC_ACQ_REL) == 0) {
+        LTRACEF("shm %p: freeing %zu pages\n", this, page_count_);
+        delete this;
+    }
+}
+
+shm_file::~shm_file() {
+    shm_->release();
+}
+
+ssize_t shm_file::pread(char *buf, size_t len, off_t off) {
+    if (off < 0 || (size_t)off >= shm_->size()) {
+        return 0;
+    }
+    len = MIN(len, shm_->size() - (size_t)off);
+
+    size_t pos = 0;
+    while (pos < len) {
+        size_t page_off = (off + pos) % PAGE_SIZE;
+        size_t chunk = MIN(len - pos, PAGE_SIZE - page_off);
+        const char *src = (const char *)paddr_to_kvaddr(shm_->page_paddr((off + pos) / PAGE_SIZE));
+        memcpy(buf + pos, src + page_off, chunk);
+        pos += chunk;
+    }
+
+    return pos;
+}
+
+status_t shm_file::stat(lkuser_stat *st) {
+    st->mode = LKUSER_S_IFREG;
+    st->size = shm_->size();
+    return NO_ERROR;
+}
+
+status_t shm_open(const char *name, size_t size, int flags, shm_object **out) {
+    LTRACEF("name '%s', size %#zx, flags %#x\n", name ? name : "", size, flags);
+
+    if (!name) {
+        return shm_object::create(size, out);
+    }
+    if (strlen(name) >= LKUSER_SHM_NAME_MAX || !name[0]) {
+        return ERR_INVALID_ARGS;
+    }
+
+    AutoLock guard(names_lock);
+
+    shm_name *n = find_locked(name);
+    if (n) {
+        if ((flags & LKUSER_O_CREAT) && (flags & LKUSER_O_EXCL)) {
+            return ERR_ALREADY_EXISTS;
+        }
+        n->shm->acquire();
+        *out = n->shm;
+        return NO_ERROR;
+    }
+    if (!(flags & LKUSER_O_CREAT)) {
+        return ERR_NOT_FOUND;
+    }
+
+    n = new shm_name;
+    if (!n) {
+        return ERR_NO_MEMORY;
+    }
+    status_t err = shm_object::create(size, &n->shm);
+    if (err < 0) {
+        delete n;
+        return err;
+    }
+    memcpy(n->name, name, strlen(name) + 1);
+    list_add_tail(&names, &n->node);
+
+    n->shm->acquire();
+    *out = n->shm;
+    return NO_ERROR;
+}
+
+status_t shm_unlink(const char *name) {
+    LTRACEF("name '%s'\n", name);
+
+    shm_name *n;
+    {
+        AutoLock guard(names_lock);
+        n = find_locked(name);
+        if (!n) {
+            return ERR_NOT_FOUND;
+        }
+        list_delete(&n->node);
+    }
+
+    n->shm->release();
+    delete n;
+    return NO_ERROR;
+}
+
+} // namespace lkuser
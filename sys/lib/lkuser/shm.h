@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <sys/types.h>
+#include <lk/cpp.h>
+#include <lk/list.h>
+#include <kernel/vm.h>
+
+#include "fd.h"
+
+namespace lkuser {
+
+// largest shared memory object
+#ifndef LKUSER_SHM_MAX
+#define LKUSER_SHM_MAX (16 * 1024 * 1024)
+#endif
+
+// longest name of a shared memory object, including the terminator
+#ifndef LKUSER_SHM_NAME_MAX
+#define LKUSER_SHM_NAME_MAX 32
+#endif
+
+// zeroed pages that any number of processes can map at once. the pages are
+// committed up front and belong to the object, not to the processes mapping
+// them, so they are only freed along with the last reference.
+class shm_object {
+public:
+    static status_t create(size_t size, shm_object **out);
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(shm_object);
+
+    size_t size() const { return page_count_ * PAGE_SIZE; }
+    paddr_t page_paddr(size_t index) const { return vm_page_to_paddr(pages_[index]); }
+
+    void acquire() { __atomic_fetch_add(&ref_, 1, __ATOMIC_RELAXED); }
+    void release();
+
+private:
+    shm_object() = default;
+    ~shm_object();
+
+    vm_page_t **pages_ = nullptr;
+    size_t page_count_ = 0;
+    int ref_ = 1;
+};
+
+// a descriptor for a shared memory object, mapped with mmap
+class shm_file final : public file {
+public:
+    // takes over the caller's reference to shm
+    explicit shm_file(shm_object *shm) : shm_(shm) {}
+    ~shm_file() override;
+
+    // reads copy out of the object, for private mappings of it
+    ssize_t pread(char *buf, size_t len, off_t off) override;
+    status_t stat(lkuser_stat *st) override;
+    shm_object *as_shm() override { return shm_; }
+
+private:
+    shm_object *shm_;
+};
+
+// open the object called name, creating it with size bytes if flags has
+// LKUSER_O_CREAT. a null name makes an anonymous one. the name stays until
+// shm_unlink(), the object until the last descriptor and mapping are gone.
+status_t shm_open(const char *name, size_t size, int flags, shm_object **out);
+status_t shm_unlink(const char *name);
+
+} // namespace lkuser
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "stats.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <arch/ops.h>
+#include <kernel/thread.h>
+
+#include "proc.h"
+#include "thread.h"
+
+#define LOCAL_TRACE 0
+
+namespace lkuser {
+
+namespace {
+
+// global counters, one copy per cpu to keep the cache lines local
+struct percpu_stats {
+    syscall_stats stats;
+} __ALIGNED(CACHE_LINE);
+
+percpu_stats global_stats[SMP_MAX_CPUS];
+
+inline uint cycles_to_bucket(uint32_t cycles) {
+    return cycles ? 31 - __builtin_clz(cycles) : 0;
+}
+
+} // namespace
+
+void syscall_stats::record(size_t num, uint32_t cycles) {
+    syscall_counter &c = counters_[num];
+
+    __atomic_fetch_add(&c.count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&c.total_cycles, cycles, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&c.hist[cycles_to_bucket(cycles)], 1, __ATOMIC_RELAXED);
+
+    uint64_t max = __atomic_load_n(&c.max_cycles, __ATOMIC_RELAXED);
+    while (cycles > max) {
+        if (__atomic_compare_exchange_n(&c.max_cycles, &max, cycles, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+}
+
+void syscall_stats::reset() {
+    for (auto &c : counters_) {
+        __atomic_store_n(&c.count, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&c.total_cycles, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&c.max_cycles, 0, __ATOMIC_RELAXED);
+        for (auto &h : c.hist) {
+            __atomic_store_n(&h, 0, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+void syscall_stats::accumulate(syscall_stats &dest) const {
+    for (size_t i = 0; i < countof(counters_); i++) {
+        const syscall_counter &src = counters_[i];
+        syscall_counter &d = dest.counters_[i];
+
+        d.count += __atomic_load_n(&src.count, __ATOMIC_RELAXED);
+        d.total_cycles += __atomic_load_n(&src.total_cycles, __ATOMIC_RELAXED);
+        d.max_cycles = MAX(d.max_cycles, __atomic_load_n(&src.max_cycles, __ATOMIC_RELAXED));
+        for (size_t b = 0; b < countof(src.hist); b++) {
+            d.hist[b] += __atomic_load_n(&src.hist[b], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+void syscall_stats::dump() const {
+    for (size_t i = 0; i < countof(counters_); i++) {
+        const syscall_counter &c = counters_[i];
+        if (c.count == 0) {
+            continue;
+        }
+
+        printf("\t%-12s count %10llu avg %8llu max %10llu cycles\n", syscall_name(i),
+               (unsigned long long)c.count, (unsigned long long)(c.total_cycles / c.count),
+               (unsigned long long)c.max_cycles);
+
+        // print the non empty buckets as <lower bound>:<count>
+        printf("\t%-12s", "");
+        for (size_t b = 0; b < countof(c.hist); b++) {
+            if (c.hist[b]) {
+                printf(" %u:%u", b ? (1u << b) : 0, c.hist[b]);
+            }
+        }
+        printf("\n");
+    }
+}
+
+void record_syscall(size_t num, uint32_t cycles) {
+    global_stats[arch_curr_cpu_num()].stats.record(num, cycles);
+
+    thread *t = (thread *)tls_get(TLS_ENTRY_LKUSER);
+    if (t) {
+        t->get_proc()->get_syscall_stats().record(num, cycles);
+    }
+}
+
+void dump_syscall_stats(bool reset) {
+    // the sum is too large to comfortably put on the stack
+    static syscall_stats total;
+    total.reset();
+    for (auto &s : global_stats) {
+        s.stats.accumulate(total);
+        if (reset) {
+            s.stats.reset();
+        }
+    }
+
+    printf("syscall stats, all processes:\n");
+    total.dump();
+
+    for_every_proc([reset](proc *p) {
+        printf("syscall stats, pid %u:\n", p->get_pid());
+        p->get_syscall_stats().dump();
+        if (reset) {
+            p->get_syscall_stats().reset();
+        }
+    });
+}
+
+} // namespace lkuser
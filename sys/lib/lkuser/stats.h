@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "syscall_table.h"
+
+namespace lkuser {
+
+// log2 buckets of syscall latency in cycles
+#define LKUSER_STATS_HIST_BUCKETS 32
+
+struct syscall_counter {
+    uint64_t count;
+    uint64_t total_cycles;
+    uint64_t max_cycles;
+    uint32_t hist[LKUSER_STATS_HIST_BUCKETS];
+};
+
+// one set of counters per syscall number, updated without locks
+class syscall_stats {
+public:
+    void record(size_t num, uint32_t cycles);
+    void reset();
+
+    // add our counters into another set, used to sum up the per cpu copies
+    void accumulate(syscall_stats &dest) const;
+
+    void dump() const;
+
+private:
+    syscall_counter counters_[syscall_count()] {};
+};
+
+// record a completed syscall against the current cpu and process
+void record_syscall(size_t num, uint32_t cycles);
+
+// print (and optionally clear) the global and per process counters
+void dump_syscall_stats(bool reset);
+
+} // namespace lkuser
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/* Templates to build the syscall dispatch table out of _syscalls.h.
+ *
+ * Every syscall gets a thunk that pulls exactly as many arguments out of the
+ * saved argument registers as its declaration takes, converts each one to the
+ * declared type, calls the handler through its real signature and widens the
+ * declared return type into the 64 bit value handed back to user space.
+ */
+namespace lkuser {
+
+// raw argument registers as saved by the trap handler
+struct syscall_args {
+    unsigned long a[4];
+};
+
+typedef uint64_t (*syscall_thunk_t)(const syscall_args &args);
+
+// one past the highest syscall number declared in _syscalls.h
+constexpr size_t syscall_count() {
+    size_t count = 0;
+#define LK_SYSCALL_DEF(n, ret, name, args...) \
+    count = ((n) + 1 > count) ? (n) + 1 : count;
+#include <sys/_syscalls.h>
+#undef LK_SYSCALL_DEF
+    return count;
+}
+
+inline const char *syscall_name(size_t num) {
+    switch (num) {
+#define LK_SYSCALL_DEF(n, ret, name, args...) \
+        case n: return #name;
+#include <sys/_syscalls.h>
+#undef LK_SYSCALL_DEF
+        default: return "invalid";
+    }
+}
+
+namespace internal {
+
+template <size_t... I> struct index_sequence {};
+template <size_t N, size_t... I> struct make_index_sequence : make_index_sequence<N - 1, N - 1, I...> {};
+template <size_t... I> struct make_index_sequence<0, I...> {
+    typedef index_sequence<I...> type;
+};
+
+// convert an argument register to the declared parameter type
+template <typename T>
+inline T arg_from_reg(unsigned long val) {
+    static_assert(sizeof(T) <= sizeof(unsigned long), "syscall argument wider than a register");
+    return (T)val;
+}
+
+// widen a return value, sign extending signed integers
+template <typename T>
+inline uint64_t ret_to_reg(T val) {
+    return (uint64_t)(int64_t)val;
+}
+
+template <typename T>
+inline uint64_t ret_to_reg(T *val) {
+    return (uintptr_t)val;
+}
+
+} // namespace internal
+
+template <typename F, F *func>
+struct syscall_thunk;
+
+template <typename R, typename... A, R (*func)(A...)>
+struct syscall_thunk<R(A...), func> {
+    static_assert(sizeof...(A) <= 4, "syscalls take at most 4 arguments");
+
+    template <size_t... I>
+    static uint64_t invoke(const syscall_args &args, internal::index_sequence<I...>) {
+        return internal::ret_to_reg(func(internal::arg_from_reg<A>(args.a[I])...));
+    }
+
+    static uint64_t call(const syscall_args &args) {
+        return invoke(args, typename internal::make_index_sequence<sizeof...(A)>::type());
+    }
+};
+
+template <typename... A, void (*func)(A...)>
+struct syscall_thunk<void(A...), func> {
+    static_assert(sizeof...(A) <= 4, "syscalls take at most 4 arguments");
+
+    template <size_t... I>
+    static uint64_t invoke(const syscall_args &args, internal::index_sequence<I...>) {
+        func(internal::arg_from_reg<A>(args.a[I])...);
+        return 0;
+    }
+
+    static uint64_t call(const syscall_args &args) {
+        return invoke(args, typename internal::make_index_sequence<sizeof...(A)>::type());
+    }
+};
+
+} // namespace lkuser
@@ -27,6 +27,7 @@
 #include <string.h>
 #include <lk/trace.h>
 #include <lk/list.h>
+#include <arch/ops.h>
 #include <kernel/vm.h>
 #include <kernel/thread.h>
 #include <lk/err.h>
@@ -34,46 +35,298 @@
 #include <lib/bio.h>
 #include <sys/lkuser_syscalls.h>
 
+#include "clock.h"
+#include "console.h"
+#include "fd.h"
+#include "futex.h"
+#include "kdata.h"
 #include "lkuser_priv.h"
+#include "pid.h"
+#include "pipe.h"
+#include "poll.h"
+#include "shm.h"
+#include "stats.h"
+#include "syscall_table.h"
+#include "template.h"
+#include "uring.h"
 
 #define LOCAL_TRACE 0
 
 using namespace lkuser;
 
+/* the user side translates these back into errno values */
+static_assert(LKUSER_ERR_NOT_FOUND == ERR_NOT_FOUND, "");
+static_assert(LKUSER_ERR_NOT_READY == ERR_NOT_READY, "");
+static_assert(LKUSER_ERR_NO_MEMORY == ERR_NO_MEMORY, "");
+static_assert(LKUSER_ERR_INVALID_ARGS == ERR_INVALID_ARGS, "");
+static_assert(LKUSER_ERR_TIMED_OUT == ERR_TIMED_OUT, "");
+static_assert(LKUSER_ERR_ALREADY_EXISTS == ERR_ALREADY_EXISTS, "");
+static_assert(LKUSER_ERR_NOT_SUPPORTED == ERR_NOT_SUPPORTED, "");
+static_assert(LKUSER_ERR_TOO_BIG == ERR_TOO_BIG, "");
+static_assert(LKUSER_ERR_CANCELLED == ERR_CANCELLED, "");
+static_assert(LKUSER_ERR_NO_RESOURCES == ERR_NO_RESOURCES, "");
+static_assert(LKUSER_ERR_BAD_HANDLE == ERR_BAD_HANDLE, "");
+static_assert(LKUSER_ERR_ACCESS_DENIED == ERR_ACCESS_DENIED, "");
+
+namespace {
+
+/* holds a reference to the file behind a descriptor of the current process */
+class file_ref {
+public:
+    explicit file_ref(int fd) : f_(get_lkuser_thread()->get_proc()->get_fds().get(fd)) {}
+    ~file_ref() {
+        if (f_) {
+            f_->release();
+        }
+    }
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(file_ref);
+
+    explicit operator bool() const { return f_ != nullptr; }
+    lkuser::file *operator->() const { return f_; }
+
+private:
+    lkuser::file *f_;
+};
+
+} // namespace
+
 void sys_exit(int retcode) {
     LTRACEF("retcode %d\n", retcode);
 
     auto *t = get_lkuser_thread();
     DEBUG_ASSERT(t);
 
-    // XXX check that we're the last thread in this process
-    t->get_proc()->exit(retcode);
+    // the process goes away with its last thread, and takes this exit code
+    // rather than that of whichever thread happens to be last
+    proc *p = t->get_proc();
+    p->set_exit_code(retcode);
+    p->thread_exit(t, retcode);
+
+    thread_exit(retcode);
+}
+
+void sys_thread_exit(int retcode) {
+    LTRACEF("retcode %d\n", retcode);
+
+    auto *t = get_lkuser_thread();
+    DEBUG_ASSERT(t);
+
+    t->get_proc()->thread_exit(t, retcode);
 
     thread_exit(retcode);
 }
 
+int sys_thread_create(void *entry, void *stack_top, void *tls) {
+    LTRACEF("entry %p, stack_top %p, tls %p\n", entry, stack_top, tls);
+
+    if (!entry || !stack_top || !IS_ALIGNED((vaddr_t)stack_top, 16)) {
+        return ERR_INVALID_ARGS;
+    }
+
+    proc *p = get_lkuser_thread()->get_proc();
+    lkuser::thread *t = lkuser::thread::create(p, (vaddr_t)entry, (vaddr_t)stack_top, (vaddr_t)tls);
+    if (!t) {
+        return ERR_NO_MEMORY;
+    }
+
+    int tid = t->get_tid();
+    t->resume();
+
+    return tid;
+}
+
+int sys_thread_join(int tid, int *retcode) {
+    LTRACEF("tid %d, retcode %p\n", tid, retcode);
+
+    auto *self = get_lkuser_thread();
+    if (tid == self->get_tid()) {
+        return ERR_INVALID_ARGS;
+    }
+
+    // taking the thread off the process's list makes us its only joiner
+    lkuser::thread *t = self->get_proc()->take_thread(tid);
+    if (!t) {
+        return ERR_NOT_FOUND;
+    }
+
+    int ret;
+    t->wait_exit(&ret);
+
+    // reap the lk thread before freeing the object it is embedded in
+    t->join();
+    delete t;
+
+    if (retcode) {
+        *retcode = ret;
+    }
+
+    return NO_ERROR;
+}
+
+int sys_spawn(const char *path, const char * const *argv) {
+    LTRACEF("path '%s', argv %p\n", path, argv);
+
+    proc *child;
+    status_t err = lkuser_spawn(path, argv, &child);
+    if (err < 0) {
+        return err;
+    }
+
+    // the reference from spawn belongs to us until the child is waited for
+    int pid = child->get_pid();
+    get_lkuser_thread()->get_proc()->add_child(child);
+
+    return pid;
+}
+
+int sys_waitpid(int pid, int *retcode, unsigned int timeout_msec) {
+    LTRACEF("pid %d, retcode %p, timeout %u\n", pid, retcode, timeout_msec);
+
+    if (pid == 0 || pid < LKUSER_WAIT_ANY) {
+        return ERR_INVALID_ARGS;
+    }
+
+    lk_time_t timeout = (timeout_msec == LKUSER_WAIT_INFINITE) ? INFINITE_TIME : timeout_msec;
+    return get_lkuser_thread()->get_proc()->wait_child(pid, timeout, retcode);
+}
+
+int sys_kill(int pid, int sig) {
+    LTRACEF("pid %d, sig %d\n", pid, sig);
+
+    if (pid <= 0 || sig < 0 || sig >= LKUSER_KILL_EXIT_BASE) {
+        return ERR_INVALID_ARGS;
+    }
+
+    proc *p = pid_lookup(pid);
+    if (!p) {
+        return ERR_NOT_FOUND;
+    }
+
+    // signal 0 only checks that the process is there
+    if (sig) {
+        p->kill(LKUSER_KILL_EXIT_BASE + sig);
+    }
+    p->release();
+
+    return NO_ERROR;
+}
+
+int sys_fork(void *entry, void *stack_top) {
+    LTRACEF("entry %p, stack_top %p\n", entry, stack_top);
+
+    // the child cannot resume from our register state, it starts over at
+    // entry on stack_top in its copy of our address space
+    if (!entry || !stack_top || !IS_ALIGNED((vaddr_t)stack_top, 16)) {
+        return ERR_INVALID_ARGS;
+    }
+
+    // the child's only thread carries on as the one that called us
+    auto *self = get_lkuser_thread();
+    proc *p = self->get_proc();
+    proc *child;
+    status_t err = lkuser_clone(p, (vaddr_t)entry, (vaddr_t)stack_top, self->get_user_tls(), &child);
+    if (err < 0) {
+        return err;
+    }
+
+    // the reference from the clone belongs to us until the child is waited for
+    int pid = child->get_pid();
+    p->add_child(child);
+
+    return pid;
+}
+
+int sys_ready(void *entry, void *stack_top) {
+    LTRACEF("entry %p, stack_top %p\n", entry, stack_top);
+
+    if (!entry || !stack_top || !IS_ALIGNED((vaddr_t)stack_top, 16)) {
+        return ERR_INVALID_ARGS;
+    }
+
+    // an ordinary process just carries on
+    proc_template *tmpl = get_lkuser_thread()->get_proc()->get_template();
+    if (!tmpl) {
+        return 0;
+    }
+
+    // copies start at entry, the template itself goes no further
+    tmpl->park((vaddr_t)entry, (vaddr_t)stack_top);
+    sys_exit(0);
+}
+
+int sys_set_affinity(int tid, unsigned int mask) {
+    LTRACEF("tid %d, mask %#x\n", tid, mask);
+
+    return get_lkuser_thread()->get_proc()->set_affinity(tid, mask);
+}
+
+int sys_get_affinity(int tid, unsigned int *mask) {
+    LTRACEF("tid %d, mask %p\n", tid, mask);
+
+    uint32_t m;
+    status_t err = get_lkuser_thread()->get_proc()->get_affinity(tid, &m);
+    if (err < 0) {
+        return err;
+    }
+
+    *mask = m;
+    return NO_ERROR;
+}
+
+int sys_futex_wait(int *addr, int value, unsigned int timeout_msec) {
+    LTRACEF("addr %p, value %d, timeout %u\n", addr, value, timeout_msec);
+
+    lk_time_t timeout = (timeout_msec == LKUSER_FUTEX_INFINITE) ? INFINITE_TIME : timeout_msec;
+
+    return futex_wait(get_lkuser_thread()->get_proc(), (vaddr_t)addr, value, timeout);
+}
+
+int sys_futex_wake(int *addr, int count) {
+    LTRACEF("addr %p, count %d\n", addr, count);
+
+    if (count <= 0) {
+        return 0;
+    }
+
+    return futex_wake(get_lkuser_thread()->get_proc(), (vaddr_t)addr, count);
+}
+
 int sys_write(int file, const char *ptr, int len) {
     LTRACEF("file %d, ptr %p, len %d\n", file, ptr, len);
 
-    if (file == 1 || file == 2) {
-        for (int i = 0; i < len; i++) {
-            fputc(ptr[i], stdout);
-        }
+    if (len <= 0)
+        return 0;
+
+    file_ref f(file);
+    if (!f) {
+        return ERR_BAD_HANDLE;
     }
 
-    return len;
+    return f->write(ptr, len);
 }
 
 int sys_open(const char *name, int flags, int mode) {
     LTRACEF("name '%s', flags 0x%x, mode 0x%x\n", name, flags, mode);
 
-    return -1;
+    lkuser::file *f;
+    status_t err = fs_file::open(name, flags, &f);
+    if (err < 0) {
+        return err;
+    }
+
+    int fd = get_lkuser_thread()->get_proc()->get_fds().install(f);
+    if (fd < 0) {
+        f->release();
+    }
+
+    return fd;
 }
 
 int sys_close(int file) {
     LTRACEF("file %d\n", file);
 
-    return -1;
+    return get_lkuser_thread()->get_proc()->get_fds().close(file);
 }
 
 int sys_read(int file, char *ptr, int len) {
@@ -82,129 +335,443 @@ int sys_read(int file, char *ptr, int len) {
     if (len <= 0)
         return 0;
 
-    if (file == 0) {
-        /* trying to read from stdin */
-        int c = getchar();
-        if (c >= 0) {
-            /* translate \r -> \n */
-            if (c == '\r') c = '\n';
-
-            ptr[0] = c;
-            return 1;
-        }
-
-        return 0;
-    } else {
-        /* bad file descriptor */
-        return -1;
+    file_ref f(file);
+    if (!f) {
+        return ERR_BAD_HANDLE;
     }
+
+    return f->read(ptr, len);
 }
 
 int sys_lseek(int file, long pos, int whence) {
     LTRACEF("file %d, pos %ld, whence %d\n", file, pos, whence);
 
-    return -1;
+    file_ref f(file);
+    if (!f) {
+        return ERR_BAD_HANDLE;
+    }
+
+    return f->seek(pos, whence);
 }
 
-void *sys_sbrk(long incr) {
-    void *ptr;
+int sys_fstat(int file, struct lkuser_stat *st) {
+    LTRACEF("file %d, st %p\n", file, st);
+
+    file_ref f(file);
+    if (!f) {
+        return ERR_BAD_HANDLE;
+    }
+
+    return f->stat(st);
+}
 
+void *sys_sbrk(long incr) {
     LTRACEF("incr %ld\n", incr);
 
-    auto *t = get_lkuser_thread();
-    proc *p = t->get_proc();
-    auto ss = p->get_sbrk_state();
+    proc *p = get_lkuser_thread()->get_proc();
+    return p->get_heap().sbrk(p, incr);
+}
 
-    if (incr < 0)
-        return NULL;
+int sys_mmap(struct lkuser_mmap_args *args) {
+    LTRACEF("args %p\n", args);
 
-    if (incr == 0)
-        return (void *)ss.last_sbrk;
+    /* work on a snapshot so user space can't change the request under us */
+    lkuser_mmap_args a = *args;
 
-    if (ss.last_sbrk != 0 && ss.last_sbrk + incr <= ss.last_sbrk_top) {
-        LTRACEF("still have space in the last allocation: last_sbrk 0x%lx, last_sbrk_top 0x%lx\n", ss.last_sbrk, ss.last_sbrk_top);
-        ptr = (void *)ss.last_sbrk;
-        ss.last_sbrk += incr;
-        return ptr;
+    proc *p = get_lkuser_thread()->get_proc();
+    status_t err = p->get_mappings().map(p, &a);
+    if (err < 0) {
+        return err;
     }
 
-#define HEAP_ALLOC_CHUNK_SIZE (PAGE_SIZE * 16)
+    args->addr = a.addr;
+    return NO_ERROR;
+}
 
-    /* allocate a new chunk for the heap */
-    size_t alloc_size = ROUNDUP(incr, HEAP_ALLOC_CHUNK_SIZE);
-    status_t err = vmm_alloc(t->get_proc()->get_aspace(), "heap", alloc_size, &ptr, PAGE_SIZE_SHIFT,
-                             0, ARCH_MMU_FLAG_PERM_USER | ARCH_MMU_FLAG_PERM_NO_EXECUTE);
+int sys_munmap(void *addr, unsigned long len) {
+    LTRACEF("addr %p, len %#lx\n", addr, len);
 
-    ss.last_sbrk = (uintptr_t)ptr + incr;
-    ss.last_sbrk_top = (uintptr_t)ptr + HEAP_ALLOC_CHUNK_SIZE;
+    proc *p = get_lkuser_thread()->get_proc();
+    return p->get_mappings().unmap(p, (vaddr_t)addr, len);
+}
 
-    LTRACEF("vmm_alloc returns %d, ptr at %p, last_sbrk now 0x%lx, top 0x%lx\n", err, ptr, ss.last_sbrk, ss.last_sbrk_top);
+int sys_mprotect(void *addr, unsigned long len, int prot) {
+    LTRACEF("addr %p, len %#lx, prot %#x\n", addr, len, prot);
 
-    return (err >= 0) ? ptr : NULL;
+    proc *p = get_lkuser_thread()->get_proc();
+    return p->get_mappings().protect(p, (vaddr_t)addr, len, prot);
 }
 
 int sys_sleep_sec(unsigned long seconds) {
     LTRACEF("seconds %lu\n", seconds);
 
-    thread_sleep(seconds * 1000U);
+    clock_wait(nullptr, kdata_now_ns() + seconds * 1000000000ULL);
     return 0;
 }
 
 int sys_sleep_usec(unsigned long useconds) {
     LTRACEF("useconds %lu\n", useconds);
 
-    thread_sleep(useconds / 1000U);
+    clock_wait(nullptr, kdata_now_ns() + useconds * 1000ULL);
+    return 0;
+}
+
+int sys_nanosleep(int clock, int flags, const uint64_t *ns) {
+    LTRACEF("clock %d, flags %#x, ns %p\n", clock, flags, ns);
+
+    uint64_t deadline;
+    if (flags & LKUSER_TIMER_ABSTIME) {
+        status_t err = clock_to_monotonic(clock, *ns, &deadline);
+        if (err < 0) {
+            return err;
+        }
+    } else {
+        if (clock != LKUSER_CLOCK_MONOTONIC && clock != LKUSER_CLOCK_REALTIME) {
+            return ERR_INVALID_ARGS;
+        }
+        deadline = kdata_now_ns() + *ns;
+    }
+
+    clock_wait(nullptr, deadline);
     return 0;
 }
 
+int sys_timer_create(int clock, int flags) {
+    LTRACEF("clock %d, flags %#x\n", clock, flags);
+
+    if (clock != LKUSER_CLOCK_MONOTONIC && clock != LKUSER_CLOCK_REALTIME) {
+        return ERR_INVALID_ARGS;
+    }
+    if (flags & ~LKUSER_TIMER_NONBLOCK) {
+        return ERR_INVALID_ARGS;
+    }
+
+    lkuser::file *f = new timer_file(clock, flags);
+    if (!f) {
+        return ERR_NO_MEMORY;
+    }
+
+    int fd = get_lkuser_thread()->get_proc()->get_fds().install(f);
+    if (fd < 0) {
+        f->release();
+    }
+
+    return fd;
+}
+
+int sys_timer_set(int file, int flags, const struct lkuser_timer_spec *spec, struct lkuser_timer_spec *old) {
+    LTRACEF("file %d, flags %#x, spec %p, old %p\n", file, flags, spec, old);
+
+    file_ref f(file);
+    if (!f) {
+        return ERR_BAD_HANDLE;
+    }
+    timer_file *t = f->as_timer();
+    if (!t) {
+        return ERR_INVALID_ARGS;
+    }
+
+    lkuser_timer_spec s = *spec;
+    lkuser_timer_spec o;
+    status_t err = t->set(flags, s, old ? &o : nullptr);
+    if (err >= 0 && old) {
+        *old = o;
+    }
+    return err;
+}
+
+int sys_timer_get(int file, struct lkuser_timer_spec *cur) {
+    LTRACEF("file %d, cur %p\n", file, cur);
+
+    file_ref f(file);
+    if (!f) {
+        return ERR_BAD_HANDLE;
+    }
+    timer_file *t = f->as_timer();
+    if (!t) {
+        return ERR_INVALID_ARGS;
+    }
+
+    lkuser_timer_spec c;
+    t->get(&c);
+    *cur = c;
+    return NO_ERROR;
+}
+
+int sys_yield(void) {
+    LTRACE_ENTRY;
+
+    thread_yield();
+    return 0;
+}
+
+int sys_pipe(int *files, int flags) {
+    LTRACEF("files %p, flags %#x\n", files, flags);
+
+    if (flags & ~LKUSER_O_NONBLOCK) {
+        return ERR_INVALID_ARGS;
+    }
+
+    lkuser::file *r, *w;
+    status_t err = pipe_create(flags, &r, &w);
+    if (err < 0) {
+        return err;
+    }
+
+    fd_table &fds = get_lkuser_thread()->get_proc()->get_fds();
+    int rfd = fds.install(r);
+    if (rfd < 0) {
+        r->release();
+        w->release();
+        return rfd;
+    }
+    int wfd = fds.install(w);
+    if (wfd < 0) {
+        w->release();
+        fds.close(rfd);
+        return wfd;
+    }
+
+    files[0] = rfd;
+    files[1] = wfd;
+    return NO_ERROR;
+}
+
+int sys_poll(struct lkuser_pollfd *fds, unsigned int nfds, int timeout_msec) {
+    LTRACEF("fds %p, nfds %u, timeout %d\n", fds, nfds, timeout_msec);
+
+    return poll_fds(get_lkuser_thread()->get_proc(), fds, nfds, timeout_msec);
+}
+
+int sys_epoll_create(int flags) {
+    LTRACEF("flags %#x\n", flags);
+
+    if (flags) {
+        return ERR_INVALID_ARGS;
+    }
+
+    lkuser::file *f = new epoll_file();
+    if (!f) {
+        return ERR_NO_MEMORY;
+    }
+
+    int fd = get_lkuser_thread()->get_proc()->get_fds().install(f);
+    if (fd < 0) {
+        f->release();
+    }
+
+    return fd;
+}
+
+int sys_epoll_ctl(int epfile, int op, int file, const struct lkuser_epoll_event *ev) {
+    LTRACEF("epfile %d, op %d, file %d, ev %p\n", epfile, op, file, ev);
+
+    file_ref f(epfile);
+    if (!f) {
+        return ERR_BAD_HANDLE;
+    }
+    epoll_file *ep = f->as_epoll();
+    if (!ep) {
+        return ERR_INVALID_ARGS;
+    }
+
+    lkuser_epoll_event e {};
+    if (op != LKUSER_EPOLL_CTL_DEL) {
+        e = *ev;
+    }
+    return ep->ctl(get_lkuser_thread()->get_proc(), op, file, &e);
+}
+
+int sys_epoll_wait(int epfile, struct lkuser_epoll_event *events, int max, int timeout_msec) {
+    LTRACEF("epfile %d, events %p, max %d, timeout %d\n", epfile, events, max, timeout_msec);
+
+    if (max <= 0) {
+        return ERR_INVALID_ARGS;
+    }
+
+    file_ref f(epfile);
+    if (!f) {
+        return ERR_BAD_HANDLE;
+    }
+    epoll_file *ep = f->as_epoll();
+    if (!ep) {
+        return ERR_INVALID_ARGS;
+    }
+
+    return ep->wait(events, max, timeout_msec);
+}
+
+int sys_pid_open(int pid) {
+    LTRACEF("pid %d\n", pid);
+
+    proc *p = pid_lookup(pid);
+    if (!p) {
+        return ERR_NOT_FOUND;
+    }
+
+    // the file takes over the reference from the lookup
+    lkuser::file *f = new pid_file(p);
+    if (!f) {
+        p->release();
+        return ERR_NO_MEMORY;
+    }
+
+    int fd = get_lkuser_thread()->get_proc()->get_fds().install(f);
+    if (fd < 0) {
+        f->release();
+    }
+
+    return fd;
+}
+
+int sys_shm_open(const char *name, unsigned long size, int flags) {
+    LTRACEF("name '%s', size %#lx, flags %#x\n", name ? name : "", size, flags);
+
+    shm_object *shm;
+    status_t err = shm_open(name, size, flags, &shm);
+    if (err < 0) {
+        return err;
+    }
+
+    // the file takes over the reference from the open
+    lkuser::file *f = new shm_file(shm);
+    if (!f) {
+        shm->release();
+        return ERR_NO_MEMORY;
+    }
+
+    int fd = get_lkuser_thread()->get_proc()->get_fds().install(f);
+    if (fd < 0) {
+        f->release();
+    }
+
+    return fd;
+}
+
+int sys_shm_unlink(const char *name) {
+    LTRACEF("name '%s'\n", name);
+
+    return shm_unlink(name);
+}
+
+int sys_tty_mode(int file, int mode) {
+    LTRACEF("file %d, mode %d\n", file, mode);
+
+    if (file < 0 || file > 2) {
+        return ERR_INVALID_ARGS;
+    }
+
+    console_input &in = get_lkuser_thread()->get_proc()->get_console_input();
+    if (mode == LKUSER_TTY_MODE_QUERY) {
+        return in.get_mode();
+    }
+
+    return in.set_mode(mode);
+}
+
+int sys_uring_setup(struct lkuser_uring *ring) {
+    LTRACEF("ring %p\n", ring);
+
+    proc *p = get_lkuser_thread()->get_proc();
+    if (p->get_uring()) {
+        return ERR_ALREADY_EXISTS;
+    }
+
+    uring *r;
+    status_t err = uring::create(p, ring, &r);
+    if (err < 0) {
+        return err;
+    }
+
+    // another thread may have set one up while we were building ours
+    if (!p->set_uring(r)) {
+        r->shutdown();
+        delete r;
+        return ERR_ALREADY_EXISTS;
+    }
+
+    return NO_ERROR;
+}
+
+int sys_uring_enter(unsigned int to_submit, unsigned int min_complete, unsigned int flags) {
+    LTRACEF("to_submit %u, min_complete %u, flags %#x\n", to_submit, min_complete, flags);
+
+    uring *r = get_lkuser_thread()->get_proc()->get_uring();
+    if (!r) {
+        return ERR_NOT_READY;
+    }
+
+    return r->enter(to_submit, min_complete, flags);
+}
+
 int sys_invalid_syscall(void) {
     LTRACEF("invalid syscall\n");
     return ERR_INVALID_ARGS;
 }
 
 const struct lkuser_syscall_table lkuser_syscalls = {
-    .exit = &sys_exit,
-    .open = &sys_open,
-    .close = &sys_close,
-    .write = &sys_write,
-    .read = &sys_read,
-    .lseek = &sys_lseek,
-    .sbrk = &sys_sbrk,
-    .sleep_sec = &sys_sleep_sec,
-    .sleep_usec = &sys_sleep_usec,
+#define LK_SYSCALL_DEF(n, ret, name, args...) \
+    .name = &sys_##name,
+#include <sys/_syscalls.h>
+#undef LK_SYSCALL_DEF
 };
 
-#if ARCH_ARM
-extern "C"
-void arm_syscall_handler(struct arm_fault_frame *frame) {
-    /* re-enable interrupts to maintain kernel preemptiveness */
-    arch_enable_ints();
-
-    LTRACEF("arm syscall: r12 %u\n", frame->r[12]);
+namespace {
 
-    /* build a function pointer to call the routine.
-     * the args are jammed into the function independent of if the function
-     * uses them or not, which is safe for simple arg passing.
-     */
-    int64_t (*sfunc)(unsigned long a, unsigned long b, unsigned long c, unsigned long d);
+/* dispatch table indexed by syscall number, generated from _syscalls.h */
+struct syscall_dispatch_table {
+    syscall_thunk_t entry[syscall_count()];
 
-    switch (frame->r[12]) {
+    constexpr syscall_dispatch_table() : entry() {
 #define LK_SYSCALL_DEF(n, ret, name, args...) \
-        case n: sfunc = reinterpret_cast<decltype(sfunc)>((uintptr_t)sys_##name); break;
+        entry[n] = &syscall_thunk<decltype(sys_##name), &sys_##name>::call;
 #include <sys/_syscalls.h>
 #undef LK_SYSCALL_DEF
-        default:
-            sfunc = reinterpret_cast<decltype(sfunc)>((uintptr_t)sys_invalid_syscall);
     }
+};
+
+constexpr syscall_dispatch_table syscall_dispatch;
+
+inline uint64_t dispatch_syscall(unsigned long num, const syscall_args &args) {
+    if (unlikely(num >= countof(syscall_dispatch.entry) || !syscall_dispatch.entry[num])) {
+        return internal::ret_to_reg(sys_invalid_syscall());
+    }
+
+    LTRACEF("syscall %lu, func %p\n", num, syscall_dispatch.entry[num]);
+
+    uint32_t start = arch_cycle_count();
+    uint64_t ret = syscall_dispatch.entry[num](args);
+    record_syscall(num, arch_cycle_count() - start);
+
+    // a killed process loses each of its threads on the way back out
+    int retcode;
+    if (unlikely(get_lkuser_thread()->get_proc()->kill_pending(&retcode))) {
+        sys_exit(retcode);
+    }
+
+    return ret;
+}
+
+} // namespace
+
+#if ARCH_ARM
+extern "C"
+void arm_syscall_handler(struct arm_fault_frame *frame) {
+    /* re-enable interrupts to maintain kernel preemptiveness */
+    arch_enable_ints();
 
-    LTRACEF("func %p\n", sfunc);
+    LTRACEF("arm syscall: r12 %u\n", frame->r[12]);
 
-    /* call the routine */
-    uint64_t ret = sfunc(frame->r[0], frame->r[1], frame->r[2], frame->r[3]);
+    const syscall_args args = {{ frame->r[0], frame->r[1], frame->r[2], frame->r[3] }};
+    uint64_t ret = dispatch_syscall(frame->r[12], args);
 
     /* unpack the 64bit return back into r0 and r1 */
     frame->r[0] = ret & 0xffffffff;
     frame->r[1] = (ret >> 32) & 0xffffffff;
+
+    /* another thread may have run on this cpu while we were in the kernel */
+    arch_disable_ints();
+    get_lkuser_thread()->restore_user_tls();
 }
 #endif
 #if ARCH_RISCV
@@ -216,29 +783,17 @@ void riscv_syscall_handler(struct riscv_short_iframe *frame) {
 
     LTRACEF("riscv syscall: t0 %lu\n", frame->t0);
 
-    /* build a function pointer to call the routine.
-     * the args are jammed into the function independent of if the function
-     * uses them or not, which is safe for simple arg passing.
-     */
-    int64_t (*sfunc)(unsigned long a, unsigned long b, unsigned long c, unsigned long d);
-
-    switch (frame->t0) {
-#define LK_SYSCALL_DEF(n, ret, name, args...) \
-        case n: sfunc = reinterpret_cast<decltype(sfunc)>((uintptr_t)sys_##name); break;
-#include <sys/_syscalls.h>
-#undef LK_SYSCALL_DEF
-        default:
-            sfunc = reinterpret_cast<decltype(sfunc)>((uintptr_t)sys_invalid_syscall);
-    }
-
-    LTRACEF("func %p\n", sfunc);
-
-    /* call the routine */
-    uint64_t ret = sfunc(frame->a0, frame->a1, frame->a2, frame->a3);
+    const syscall_args args = {{ frame->a0, frame->a1, frame->a2, frame->a3 }};
+    uint64_t ret = dispatch_syscall(frame->t0, args);
 
+#if __riscv_xlen == 64
+    /* the whole return value fits in a0 */
+    frame->a0 = ret;
+#else
     /* unpack the 64bit return back into a0 and a1 */
     frame->a0 = ret & 0xffffffff;
     frame->a1 = (ret >> 32) & 0xffffffff;
+#endif
 
     /* bump the PC forward over the ecall */
     frame->epc += 4;
@@ -246,5 +801,3 @@ void riscv_syscall_handler(struct riscv_short_iframe *frame) {
     arch_disable_ints();
 }
 #endif
-
-
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "template.h"
+
+#include <lk/err.h>
+#include <lk/trace.h>
+
+#include "proc.h"
+#include "lkuser_priv.h"
+
+#define LOCAL_TRACE 0
+
+namespace lkuser {
+
+proc_template::~proc_template() {
+    if (proc_) {
+        // let the parked thread go and wait for the template to wind down
+        event_signal(&release_event_, true);
+        proc_->wait();
+        proc_->release();
+    }
+
+    event_destroy(&ready_event_);
+    event_destroy(&release_event_);
+}
+
+status_t proc_template::create(const char *path, const char * const *argv, proc_template **out) {
+    LTRACEF("path '%s'\n", path);
+
+    proc_template *t = new proc_template;
+    if (!t) {
+        return ERR_NO_MEMORY;
+    }
+
+    status_t err = lkuser_spawn(path, argv, &t->proc_, t);
+    if (err < 0) {
+        delete t;
+        return err;
+    }
+
+    event_wait(&t->ready_event_);
+    if (!t->ready_) {
+        TRACEF("%s exited before it was ready\n", path);
+        delete t;
+        return ERR_NOT_READY;
+    }
+
+    LTRACEF("ready, entry %#lx, stack %#lx\n", t->entry_, t->stack_top_);
+
+    *out = t;
+    return NO_ERROR;
+}
+
+status_t proc_template::spawn(proc **out) {
+    DEBUG_ASSERT(ready_);
+
+    return lkuser_clone(proc_, entry_, stack_top_, user_tls_, out);
+}
+
+void proc_template::park(vaddr_t entry, vaddr_t stack_top) {
+    entry_ = entry;
+    stack_top_ = stack_top;
+    user_tls_ = get_lkuser_thread()->get_user_tls();
+    ready_ = true;
+    event_signal(&ready_event_, true);
+
+    // a kill lets the parked thread go and exit like any other
+    killable_wait(&release_event_);
+}
+
+void proc_template::exited() {
+    event_signal(&ready_event_, true);
+}
+
+} // namespace lkuser
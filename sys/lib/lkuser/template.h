@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <sys/types.h>
+#include <lk/cpp.h>
+#include <kernel/event.h>
+
+namespace lkuser {
+
+class proc;
+
+// a process started once and run up to the point where it calls ready, then
+// parked so that fresh copies of it can be stamped out copy on write instead
+// of loading and initializing the binary each time. the template should be
+// single threaded when it gets there.
+class proc_template {
+private:
+    proc_template() = default;
+
+public:
+    ~proc_template();
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(proc_template);
+
+    // launch the binary at path as a template and wait for it to reach its
+    // ready point
+    static status_t create(const char *path, const char * const *argv, proc_template **out);
+
+    // start a copy of the template, returned with a reference held for the
+    // caller to wait on and release
+    status_t spawn(proc **out);
+
+    // called by the template's thread at its ready point, copies resume at
+    // entry on stack_top with its user thread pointer. blocks until the
+    // template is destroyed.
+    void park(vaddr_t entry, vaddr_t stack_top);
+
+    // called when the template process exits, whether or not it got ready
+    void exited();
+
+private:
+    proc *proc_ = nullptr;
+    vaddr_t entry_ = 0;
+    vaddr_t stack_top_ = 0;
+    vaddr_t user_tls_ = 0;
+    bool ready_ = false;
+
+    event_t ready_event_ = EVENT_INITIAL_VALUE(ready_event_, false, 0);
+    event_t release_event_ = EVENT_INITIAL_VALUE(release_event_, false, 0);
+};
+
+} // namespace lkuser
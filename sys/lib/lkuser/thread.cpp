@@ -24,32 +24,91 @@
 
 #include <lk/err.h>
 #include <lk/trace.h>
+#include <kernel/mp.h>
 #include <kernel/thread.h>
 #include <kernel/vm.h>
+#if ARCH_ARM
+#include <arch/arm.h>
+#endif
 
+#include "pool.h"
 #include "proc.h"
 
 #define LOCAL_TRACE 0
 
 namespace lkuser {
 
+namespace {
+
+// rotates through the cpus so threads are spread out as they are created
+uint next_cpu;
+
+// pick a cpu out of mask, taking turns with the other threads
+int pick_cpu(uint32_t mask) {
+    uint start = __atomic_fetch_add(&next_cpu, 1, __ATOMIC_RELAXED);
+
+    for (uint i = 0; i < SMP_MAX_CPUS; i++) {
+        uint cpu = (start + i) % SMP_MAX_CPUS;
+        if (mask & (1U << cpu)) {
+            return cpu;
+        }
+    }
+
+    return 0;
+}
+
+block_pool thread_pool("thread", sizeof(thread), LKUSER_POOL_LOW_WATER, LKUSER_POOL_HIGH_WATER);
+
+} // namespace
+
 thread::thread(proc *p) : proc_(p) {}
-thread::~thread() = default;
+
+thread::~thread() {
+    event_destroy(&exit_event_);
+
+    // only called once the lk thread is joined or was never created
+    kstack_pool.free(kstack_);
+}
+
+void *thread::operator new(size_t size) noexcept {
+    DEBUG_ASSERT(size == sizeof(thread));
+    return thread_pool.alloc();
+}
+
+void thread::operator delete(void *ptr) {
+    thread_pool.free(ptr);
+}
 
 int lkuser_start_routine(void *arg) {
     thread *t = (thread *)arg;
 
     /* set our per-thread pointer */
     __tls_set(TLS_ENTRY_LKUSER, (uintptr_t)t);
+    t->restore_user_tls();
+
+    /* the main thread, on the stack we made for it, gets the arguments */
+    vaddr_t sp = t->get_stack_top();
+    if (t->get_stack()) {
+        sp = t->get_proc()->push_args(sp);
+    }
 
     /* switch to user mode and start the thread */
-    arch_enter_uspace(t->get_entry(),
-                      (uintptr_t)t->get_stack() + PAGE_SIZE);
+    arch_enter_uspace(t->get_entry(), sp);
 
     __UNREACHABLE;
 }
 
-thread *thread::create(proc *p, vaddr_t entry) {
+thread *thread::create_kernel(proc *p) {
+    thread *t = new thread(p);
+    if (!t) {
+        TRACEF("error allocating thread state\n");
+        return nullptr;
+    }
+
+    return t;
+}
+
+thread *thread::create(proc *p, vaddr_t entry, vaddr_t stack_top, vaddr_t user_tls) {
     thread *t;
     t = new thread(p);
     if (!t) {
@@ -58,9 +117,34 @@ thread *thread::create(proc *p, vaddr_t entry) {
     }
 
     t->entry_ = entry;
+    t->user_tls_ = user_tls;
+
+    if (stack_top) {
+        t->stack_top_ = stack_top;
+    } else {
+        // reserve the main thread's stack in the mapping range, so it grows
+        // on demand and is carried over when the process is cloned
+        vaddr_t top = 0;
+        status_t err = p->get_mappings().map_stack(p, p->get_stack_size(), &top);
+        LTRACEF("map_stack returns %d, top at %#lx\n", err, top);
+        if (err < 0) {
+            TRACEF("error %d creating user stack\n", err);
+            delete t;
+            return nullptr;
+        }
+        t->user_stack_ = (void *)(top - p->get_stack_size());
+        t->stack_top_ = top;
+    }
 
-    // create the lk side of the thread
-    thread_t *lkthread = thread_create_etc(&t->lkthread, "lkuser", lkuser_start_routine, t, LOW_PRIORITY, NULL, DEFAULT_STACK_SIZE);
+    // create the lk side of the thread, on a recycled kernel stack
+    t->kstack_ = kstack_pool.alloc();
+    if (!t->kstack_) {
+        TRACEF("error allocating kernel stack\n");
+        delete t;
+        return nullptr;
+    }
+    thread_t *lkthread = thread_create_etc(&t->lkthread, "lkuser", lkuser_start_routine, t, LOW_PRIORITY,
+                                           t->kstack_, DEFAULT_STACK_SIZE);
     if (!lkthread) {
         TRACEF("error creating thread\n");
         delete t;
@@ -71,22 +155,96 @@ thread *thread::create(proc *p, vaddr_t entry) {
     // set the address space for this thread
     t->lkthread.aspace = p->get_aspace();
 
-    // create a user stack for the new thread
-    // TODO: move this logic elsewhere and/or generally make it a user space problem
-    status_t err = vmm_alloc(p->get_aspace(), "lkuser_user_stack", PAGE_SIZE, &t->user_stack_, PAGE_SIZE_SHIFT,
-                             0, ARCH_MMU_FLAG_PERM_USER | ARCH_MMU_FLAG_PERM_NO_EXECUTE);
-    LTRACEF("vmm_alloc returns %d, stack at %p\n", err, t->user_stack_);
-    DEBUG_ASSERT(err >= NO_ERROR);
+    // place it on one of the cpus the process may run on
+    t->set_affinity(p->get_affinity());
 
     // add ourselves to the parent process
-    err = p->add_thread(t);
+    t->tid_ = p->add_thread(t);
+
+    return t;
+}
+
+void thread::set_affinity(uint32_t mask) {
+    mask &= mp_get_online_mask();
+    if (!mask) {
+        mask = mp_get_online_mask();
+    }
+    affinity_ = mask;
+
+    // a thread already on an allowed cpu stays put rather than migrating
+    int cpu = lkthread.pinned_cpu;
+    if (cpu < 0 || !(mask & (1U << cpu))) {
+        cpu = pick_cpu(mask);
+    }
+
+    LTRACEF("thread %p, mask %#x, cpu %d\n", this, mask, cpu);
+
+    thread_set_pinned_cpu(&lkthread, cpu);
+}
+
+void thread::restore_user_tls() const {
+#if ARCH_ARM
+    // TPIDRURO is read only to user code and lk does not switch it with the
+    // thread, so it is loaded again on every way out of the kernel
+    arm_write_tpidruro(user_tls_);
+#endif
+    // riscv's tp is saved and restored with the rest of the user frame
+}
+
+void thread::exited(int retcode) {
+    retcode_ = retcode;
+    event_signal(&exit_event_, true);
+}
+
+status_t thread::wait_exit(int *retcode) {
+    status_t err = killable_wait(&exit_event_);
     if (err < 0) {
-        // XXX clean up the LK thread
-        panic("failed addition of thread to process\n");
-        return nullptr;
+        return err;
+    }
+    if (retcode) {
+        *retcode = retcode_;
     }
+    return NO_ERROR;
+}
 
-    return t;
+status_t thread::wait(event_t *event, lk_time_t timeout) {
+    waiter_ = get_current_thread();
+    __atomic_store_n(&waiting_on_, event, __ATOMIC_SEQ_CST);
+
+    // a kill either shows up here or finds us in the wait and ends it
+    int retcode;
+    status_t err;
+    if (proc_->kill_pending(&retcode)) {
+        err = ERR_CANCELLED;
+    } else {
+        err = event_wait_timeout(event, timeout);
+    }
+
+    __atomic_store_n(&waiting_on_, nullptr, __ATOMIC_RELEASE);
+    return err;
+}
+
+void thread::interrupt() {
+    for (;;) {
+        {
+            THREAD_LOCK(state);
+            event_t *event = __atomic_load_n(&waiting_on_, __ATOMIC_SEQ_CST);
+            if (!event) {
+                THREAD_UNLOCK(state);
+                return;
+            }
+            if (waiter_->state == THREAD_BLOCKED && waiter_->blocking_wait_queue == &event->wait) {
+                thread_unblock_from_wait_queue(waiter_, ERR_CANCELLED);
+                THREAD_UNLOCK(state);
+                return;
+            }
+            THREAD_UNLOCK(state);
+        }
+
+        // it checked for the kill before we set it and is on its way into
+        // the wait, or just out of it. give it the cpu to get there.
+        thread_sleep(1);
+    }
 }
 
 } // namespace lkuser
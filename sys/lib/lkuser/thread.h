@@ -23,6 +23,7 @@
 #pragma once
 
 #include <lk/list.h>
+#include <kernel/event.h>
 #include <kernel/thread.h>
 #include <sys/lkuser_syscalls.h>
 
@@ -38,26 +39,81 @@ private:
 public:
     ~thread();
 
-    // factory to build threads
-    static thread *create(proc *p, vaddr_t entry);
+    // thread objects come from a per cpu pool rather than the heap
+    static void *operator new(size_t size) noexcept;
+    static void operator delete(void *ptr);
+
+    // factory to build threads. with no stack_top a stack is allocated in the
+    // process, otherwise the thread runs on the one user space handed us.
+    // user_tls is the thread's value of the user thread pointer.
+    static thread *create(proc *p, vaddr_t entry, vaddr_t stack_top = 0, vaddr_t user_tls = 0);
+
+    // a thread that never runs user code, for kernel threads working on
+    // behalf of p to install as their identity so syscall handlers find the
+    // process. it is not counted among p's threads and is deleted by its owner.
+    static thread *create_kernel(proc *p);
 
     // accessors
     proc *get_proc() const { return proc_; }
+    int get_tid() const { return tid_; }
     vaddr_t get_entry() const { return entry_; }
+    vaddr_t get_stack_top() const { return stack_top_; }
+    // the stack the kernel made for the thread, null if user space supplied one
     void *get_stack() const { return user_stack_; }
+    vaddr_t get_user_tls() const { return user_tls_; }
+
+    // put the user thread pointer back before returning to user code, called
+    // on the thread with interrupts disabled
+    void restore_user_tls() const;
+
+    // restrict the thread to the cpus in mask, pinning it to one of them
+    void set_affinity(uint32_t mask);
+    uint32_t get_affinity() const { return affinity_; }
 
     // operations on our thread
     void resume() { thread_resume(&lkthread); }
     void join() { thread_join(&lkthread, NULL, INFINITE_TIME); }
 
+    // record the exit code and wake up anyone joining, called on the thread
+    void exited(int retcode);
+
+    // wait for the thread to exit
+    status_t wait_exit(int *retcode);
+
+    // block on event like event_wait_timeout(), except that a kill of the
+    // process ends the wait early with ERR_CANCELLED. called on the thread
+    // whose identity this is.
+    status_t wait(event_t *event, lk_time_t timeout);
+
+    // end a wait() in progress with ERR_CANCELLED, called once the process
+    // has a kill pending
+    void interrupt();
+
     // public for proc to maintain a list
     list_node node = LIST_INITIAL_CLEARED_VALUE;
 
 private:
     proc *proc_ = nullptr;
+    int tid_ = 0;
     vaddr_t entry_ {};
 
     void *user_stack_ = nullptr;
+    vaddr_t stack_top_ = 0;
+    vaddr_t user_tls_ = 0;
+
+    // kernel stack from the pool, handed to lk to run on
+    void *kstack_ = nullptr;
+
+    uint32_t affinity_ = 0;
+
+    int retcode_ = 0;
+    event_t exit_event_ = EVENT_INITIAL_VALUE(exit_event_, false, 0);
+
+    // the event a wait() is blocked on and the lk thread blocking on it. only
+    // compared against the lk thread's wait queue, never dereferenced, by
+    // interrupt().
+    event_t *waiting_on_ = nullptr;
+    thread_t *waiter_ = nullptr;
 
     thread_t lkthread {};
 };
@@ -68,4 +124,11 @@ static inline thread *get_lkuser_thread() {
     return t;
 }
 
+// block on behalf of a syscall, giving up with ERR_CANCELLED if the calling
+// process is killed. kernel threads with no process wait as usual.
+static inline status_t killable_wait(event_t *event, lk_time_t timeout = INFINITE_TIME) {
+    thread *t = (thread *)tls_get(TLS_ENTRY_LKUSER);
+    return t ? t->wait(event, timeout) : event_wait_timeout(event, timeout);
+}
+
 } // namespace lkuser
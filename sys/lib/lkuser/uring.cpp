@@ -0,0 +1,323 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "uring.h"
+
+#include <lk/err.h>
+#include <lk/trace.h>
+#include <kernel/thread.h>
+#include <platform.h>
+
+#include "clock.h"
+#include "kdata.h"
+#include "lkuser_priv.h"
+
+#define LOCAL_TRACE 0
+
+namespace lkuser {
+
+uring::uring(proc *p, lkuser_uring *shared) : proc_(p), shared_(shared) {
+    ready_entry_.wake = &uring::ready_wake;
+}
+
+uring::~uring() {
+    DEBUG_ASSERT(!poller_);
+    delete poller_identity_;
+    event_destroy(&cq_event_);
+    event_destroy(&sq_event_);
+    event_destroy(&ready_event_);
+    event_destroy(&cancel_event_);
+}
+
+status_t uring::create(proc *p, lkuser_uring *shared, uring **out) {
+    LTRACEF("proc %p, shared %p\n", p, shared);
+
+    if (!shared) {
+        return ERR_INVALID_ARGS;
+    }
+
+    uint32_t sq_entries = shared->sq_entries;
+    uint32_t cq_entries = shared->cq_entries;
+    auto is_pow2 = [](uint32_t x) { return x && !(x & (x - 1)); };
+    if (!is_pow2(sq_entries) || !is_pow2(cq_entries) ||
+            sq_entries > LKUSER_URING_MAX_ENTRIES || cq_entries > LKUSER_URING_MAX_ENTRIES) {
+        return ERR_INVALID_ARGS;
+    }
+    if (!shared->sqes || !shared->cqes) {
+        return ERR_INVALID_ARGS;
+    }
+
+    uring *r = new uring(p, shared);
+    if (!r) {
+        return ERR_NO_MEMORY;
+    }
+
+    r->sqes_ = (lkuser_uring_sqe *)(uintptr_t)shared->sqes;
+    r->cqes_ = (lkuser_uring_cqe *)(uintptr_t)shared->cqes;
+    r->sq_mask_ = sq_entries - 1;
+    r->cq_mask_ = cq_entries - 1;
+
+    shared->sq_head = shared->sq_tail;
+    shared->cq_tail = shared->cq_head;
+    shared->sq_flags = 0;
+    if (shared->sq_idle_msec == 0) {
+        shared->sq_idle_msec = LKUSER_URING_DEFAULT_IDLE_MSEC;
+    }
+
+    if (shared->flags & LKUSER_URING_SETUP_SQPOLL) {
+        // the poller belongs to the process rather than the thread that set
+        // up the ring, which may exit long before the process does
+        r->poller_identity_ = thread::create_kernel(p);
+        if (!r->poller_identity_) {
+            delete r;
+            return ERR_NO_MEMORY;
+        }
+
+        r->poller_ = thread_create("lkuser uring", &uring::poll_thread, r, LOW_PRIORITY, DEFAULT_STACK_SIZE);
+        if (!r->poller_) {
+            delete r;
+            return ERR_NO_MEMORY;
+        }
+
+        // run inside the process's address space so user pointers resolve
+        r->poller_->aspace = p->get_aspace();
+        thread_resume(r->poller_);
+    }
+
+    *out = r;
+    return NO_ERROR;
+}
+
+void uring::shutdown() {
+    if (!poller_) {
+        return;
+    }
+
+    stopping_ = true;
+    event_signal(&cancel_event_, false);
+    event_signal(&ready_event_, false);
+    event_signal(&sq_event_, true);
+    thread_join(poller_, NULL, INFINITE_TIME);
+    poller_ = nullptr;
+}
+
+bool uring::sq_empty() const {
+    return __atomic_load_n(&shared_->sq_tail, __ATOMIC_ACQUIRE) == shared_->sq_head;
+}
+
+void uring::ready_wake(poll_entry *e, uint32_t events) {
+    uring *r = containerof(e, uring, ready_entry_);
+    event_signal(&r->ready_event_, false);
+}
+
+// on the polling thread, wait until fd has one of events ready or the ring is
+// shut down. a descriptor that cannot be waited on is left to the request.
+status_t uring::wait_ready(int fd, uint32_t events) {
+    file *f = proc_->get_fds().get(fd);
+    if (!f) {
+        return NO_ERROR;
+    }
+
+    events |= LKUSER_POLLERR | LKUSER_POLLHUP;
+    poll_source *source = f->get_poll_source();
+    if (source) {
+        source->add(&ready_entry_);
+    }
+
+    status_t err = NO_ERROR;
+    while (!(f->poll_events() & events)) {
+        if (stopping_) {
+            err = ERR_CANCELLED;
+            break;
+        }
+        if (!source) {
+            break;
+        }
+        event_wait(&ready_event_);
+    }
+
+    if (source) {
+        source->remove(&ready_entry_);
+    }
+    f->release();
+    return err;
+}
+
+int32_t uring::execute(const lkuser_uring_sqe &sqe) {
+    LTRACEF("op %u, fd %d, addr %#llx, len %u, off %#llx\n", sqe.opcode, sqe.fd,
+            (unsigned long long)sqe.addr, sqe.len, (unsigned long long)sqe.off);
+
+    // the polling thread only goes into requests that can complete, so that
+    // shutdown never waits on input or a sleep that may never end. another
+    // thread of the process reading the same descriptor can still win the race.
+    const bool polling = (get_current_thread() == poller_);
+
+    switch (sqe.opcode) {
+        case LKUSER_URING_OP_NOP:
+            return 0;
+        case LKUSER_URING_OP_READ:
+            if (polling) {
+                status_t err = wait_ready(sqe.fd, LKUSER_POLLIN);
+                if (err < 0) {
+                    return err;
+                }
+            }
+            return sys_read(sqe.fd, (char *)(uintptr_t)sqe.addr, sqe.len);
+        case LKUSER_URING_OP_WRITE:
+            if (polling) {
+                status_t err = wait_ready(sqe.fd, LKUSER_POLLOUT);
+                if (err < 0) {
+                    return err;
+                }
+            }
+            return sys_write(sqe.fd, (const char *)(uintptr_t)sqe.addr, sqe.len);
+        case LKUSER_URING_OP_SLEEP:
+            if (polling) {
+                status_t err = clock_wait(&cancel_event_, kdata_now_ns() + sqe.off * 1000ULL);
+                return (err == ERR_TIMED_OUT) ? 0 : ERR_CANCELLED;
+            }
+            return sys_sleep_usec(sqe.off);
+        case LKUSER_URING_OP_OPEN:
+            return sys_open((const char *)(uintptr_t)sqe.addr, sqe.len, sqe.off);
+        case LKUSER_URING_OP_CLOSE:
+            return sys_close(sqe.fd);
+        case LKUSER_URING_OP_LSEEK:
+            return sys_lseek(sqe.fd, sqe.off, sqe.len);
+        default:
+            return ERR_NOT_SUPPORTED;
+    }
+}
+
+// consume up to max sqes, never posting more completions than the cq has room for
+uint uring::submit(uint max) {
+    AutoLock guard(submit_lock_);
+
+    uint32_t head = shared_->sq_head;
+    uint32_t tail = __atomic_load_n(&shared_->sq_tail, __ATOMIC_ACQUIRE);
+    uint32_t cq_tail = shared_->cq_tail;
+
+    uint count = 0;
+    while (count < max && head != tail) {
+        uint32_t cq_head = __atomic_load_n(&shared_->cq_head, __ATOMIC_ACQUIRE);
+        if (cq_tail - cq_head > cq_mask_) {
+            // completion ring is full, the rest waits until user space catches up
+            break;
+        }
+
+        const lkuser_uring_sqe sqe = sqes_[head & sq_mask_];
+        head++;
+        __atomic_store_n(&shared_->sq_head, head, __ATOMIC_RELEASE);
+
+        lkuser_uring_cqe &cqe = cqes_[cq_tail & cq_mask_];
+        cqe.user_data = sqe.user_data;
+        cqe.res = execute(sqe);
+        cqe.flags = 0;
+        cq_tail++;
+        __atomic_store_n(&shared_->cq_tail, cq_tail, __ATOMIC_RELEASE);
+
+        count++;
+    }
+
+    if (count > 0) {
+        event_signal(&cq_event_, true);
+    }
+
+    LTRACEF("submitted %u\n", count);
+    return count;
+}
+
+int uring::enter(uint to_submit, uint min_complete, uint flags) {
+    LTRACEF("to_submit %u, min_complete %u, flags %#x\n", to_submit, min_complete, flags);
+
+    int submitted = 0;
+    if (poller_) {
+        if (flags & LKUSER_URING_ENTER_SQ_WAKEUP) {
+            event_signal(&sq_event_, true);
+        }
+    } else if (to_submit > 0) {
+        submitted = submit(to_submit);
+    }
+
+    if (flags & LKUSER_URING_ENTER_GETEVENTS) {
+        if (min_complete > shared_->cq_entries) {
+            min_complete = shared_->cq_entries;
+        }
+        for (;;) {
+            event_unsignal(&cq_event_);
+
+            uint32_t ready = __atomic_load_n(&shared_->cq_tail, __ATOMIC_ACQUIRE) -
+                             __atomic_load_n(&shared_->cq_head, __ATOMIC_ACQUIRE);
+            if (ready >= min_complete) {
+                break;
+            }
+
+            // completions are posted synchronously, so with nothing left to
+            // submit there is nothing more to wait for
+            if (!poller_ && sq_empty()) {
+                break;
+            }
+
+            if (killable_wait(&cq_event_) == ERR_CANCELLED) {
+                break;
+            }
+        }
+    }
+
+    return submitted;
+}
+
+int uring::poll_thread(void *arg) {
+    uring *r = (uring *)arg;
+
+    // let the syscall handlers find the process
+    __tls_set(TLS_ENTRY_LKUSER, (uintptr_t)r->poller_identity_);
+
+    return r->poll_loop();
+}
+
+int uring::poll_loop() {
+    lk_time_t last_work = current_time();
+
+    while (!stopping_) {
+        if (submit(UINT32_MAX) > 0) {
+            last_work = current_time();
+            continue;
+        }
+
+        if (current_time() - last_work < shared_->sq_idle_msec) {
+            thread_yield();
+            continue;
+        }
+
+        // go idle, rechecking the ring after publishing the flag to avoid missing a submission
+        __atomic_or_fetch(&shared_->sq_flags, LKUSER_URING_SQ_NEED_WAKEUP, __ATOMIC_SEQ_CST);
+        if (sq_empty()) {
+            event_wait(&sq_event_);
+        }
+        __atomic_and_fetch(&shared_->sq_flags, ~LKUSER_URING_SQ_NEED_WAKEUP, __ATOMIC_SEQ_CST);
+        last_work = current_time();
+    }
+
+    return 0;
+}
+
+} // namespace lkuser
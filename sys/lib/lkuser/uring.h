@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <sys/types.h>
+#include <lk/cpp.h>
+#include <kernel/event.h>
+#include <kernel/mutex.h>
+#include <kernel/thread.h>
+#include <sys/lkuser_abi.h>
+
+#include "poll.h"
+
+namespace lkuser {
+
+class proc;
+class thread;
+
+// default time the polling thread spins on an empty ring before going idle
+#ifndef LKUSER_URING_DEFAULT_IDLE_MSEC
+#define LKUSER_URING_DEFAULT_IDLE_MSEC 10
+#endif
+
+// kernel side of a process's submission/completion ring pair
+class uring {
+private:
+    uring(proc *p, lkuser_uring *shared);
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(uring);
+
+public:
+    ~uring();
+
+    // validate the user supplied ring of process p and start consuming it
+    static status_t create(proc *p, lkuser_uring *shared, uring **out);
+
+    // submit and/or wait for completions on behalf of the calling thread
+    int enter(uint to_submit, uint min_complete, uint flags);
+
+    // stop the polling thread, cancelling a request it is blocked on. must be
+    // called before the address space goes away.
+    void shutdown();
+
+private:
+    uint submit(uint max);
+    int32_t execute(const lkuser_uring_sqe &sqe);
+    bool sq_empty() const;
+    status_t wait_ready(int fd, uint32_t events);
+    static void ready_wake(poll_entry *e, uint32_t events);
+
+    static int poll_thread(void *arg);
+    int poll_loop();
+
+    proc *proc_;
+    lkuser_uring *shared_;
+    lkuser_uring_sqe *sqes_ = nullptr;
+    lkuser_uring_cqe *cqes_ = nullptr;
+    uint32_t sq_mask_ = 0;
+    uint32_t cq_mask_ = 0;
+
+    // only one thread consumes the submission ring at a time
+    Mutex submit_lock_;
+
+    // signalled every time completions are posted
+    event_t cq_event_ = EVENT_INITIAL_VALUE(cq_event_, false, 0);
+
+    // wakes up an idle polling thread
+    event_t sq_event_ = EVENT_INITIAL_VALUE(sq_event_, false, EVENT_FLAG_AUTOUNSIGNAL);
+
+    // the polling thread, and the identity it runs syscall handlers under
+    thread_t *poller_ = nullptr;
+    thread *poller_identity_ = nullptr;
+    volatile bool stopping_ = false;
+
+    // let the polling thread wait for a descriptor to be ready, or for
+    // shutdown, rather than block inside a read or write that may never end
+    poll_entry ready_entry_;
+    event_t ready_event_ = EVENT_INITIAL_VALUE(ready_event_, false, EVENT_FLAG_AUTOUNSIGNAL);
+
+    // signaled by shutdown to cut a sleep short
+    event_t cancel_event_ = EVENT_INITIAL_VALUE(cancel_event_, false, 0);
+};
+
+} // namespace lkuser
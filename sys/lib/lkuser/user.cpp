@@ -30,6 +30,7 @@
 #include <lk/list.h>
 #include <lk/trace.h>
 #include <lk/err.h>
+#include <kernel/mp.h>
 #include <kernel/vm.h>
 #include <kernel/thread.h>
 #include <kernel/mutex.h>
@@ -38,102 +39,64 @@
 #include <lib/elf.h>
 #include <lib/fs.h>
 #include <lk/init.h>
+#include <platform.h>
 #include <sys/lkuser_syscalls.h>
 
+#include "aspace.h"
+#include "console.h"
+#include "image.h"
+#include "pool.h"
+#include "stats.h"
+#include "template.h"
+
 #define LOCAL_TRACE 0
 
 namespace lkuser {
 
-static ssize_t elf_read_hook_file(struct elf_handle *handle, void *buf, uint64_t offset, size_t len) {
-    filehandle *fhandle = (filehandle *)handle->read_hook_arg;
-
-    LTRACEF("handle %p, buf %p, offset %llu, len %#zx\n", handle, buf, offset, len);
-
-    return fs_read_file(fhandle, buf, offset, len);
-}
-
-static status_t elf_mem_alloc(struct elf_handle *handle, void **ptr, size_t len, uint num, uint flags) {
-    LTRACEF("handle %p, ptr %p [%p], size %#zx, num %u, flags %#x\n", handle, ptr, *ptr, len, num, flags);
-
-    proc *p = (proc *)handle->mem_alloc_hook_arg;
-
-    char name[16];
-    snprintf(name, sizeof(name), "lkuser%u", num);
-
-    // round the allocations down and up to page boundaries
-    uintptr_t va = (uintptr_t)*ptr;
-    uintptr_t newva = ROUNDDOWN(va, PAGE_SIZE);
-    ptrdiff_t aligndiff = va - newva;
-    len += aligndiff;
-    va = newva;
-
-    // round the size up to the next boundary
-    len = ROUNDUP(len, PAGE_SIZE);
-
-    LTRACEF("aligned va %#lx size %#zx\n", va, len);
+static status_t lkuser_load_file(proc *proc, const char *file_name, bool lazy, size_t heap_limit) {
+    LTRACEF("proc %p, file '%s', lazy %d, heap limit %#zx\n", proc, file_name, lazy, heap_limit);
 
-    void *vaptr = (void *)va;
-    status_t err = vmm_alloc(p->get_aspace(), name, len, &vaptr, 0, VMM_FLAG_VALLOC_SPECIFIC, ARCH_MMU_FLAG_PERM_USER);
-    LTRACEF("vmm_alloc returns %d, ptr %p\n", err, vaptr);
-
-    *ptr = (void *)((uintptr_t)vaptr + aligndiff);
-    LTRACEF("returning ptr %p\n", *ptr);
-
-    return err;
-}
-
-static status_t lkuser_load_file(proc *proc, const char *file_name) {
-    status_t err;
-
-    LTRACE;
-
-    /* switch to the address space we're loading into */
-    vmm_set_active_aspace(proc->get_aspace());
-
-    filehandle *handle;
-    err = fs_open_file(file_name, &handle);
+    /* find or create the shared image of the binary */
+    elf_image *img;
+    status_t err = elf_image::get(file_name, &img);
     if (err < 0) {
-        TRACEF("failed to open file %s\n", file_name);
+        TRACEF("failed to load elf file %s\n", file_name);
         return err;
     }
 
+    /* map it into the process, paging it in on demand if asked to */
     proc::loader_state &ls = proc->get_loader_state();
-
-    /* create an elf handle */
-    err = elf_open_handle(&ls.elf, &elf_read_hook_file, handle, false);
-    LTRACEF("elf_open_handle returns %d\n", err);
+    err = image_mapping::create(proc, img, lazy, &ls.image);
+    LTRACEF("image_mapping::create returns %d\n", err);
     if (err < 0) {
-        TRACEF("failed to open elf handle\n");
-        goto err;
+        TRACEF("failed to map elf file %s\n", file_name);
+        return err;
     }
 
-    /* register a memory allocation callback */
-    ls.elf.mem_alloc_hook = &elf_mem_alloc;
-    ls.elf.mem_alloc_hook_arg = proc;
+    /* reserve the heap past the end of the binary, leaving a guard page */
+    err = proc->get_heap().init(proc, img->get_end() + PAGE_SIZE, heap_limit);
+    if (err < 0) {
+        TRACEF("failed to reserve heap\n");
+        return err;
+    }
 
-    /* try to load the binary */
-    err = elf_load(&ls.elf);
-    LTRACEF("elf_load returns %d\n", err);
+    /* and the range mmap carves mappings out of past that */
+    err = proc->get_mappings().init(proc, proc->get_heap().get_end() + PAGE_SIZE, LKUSER_MMAP_LIMIT);
     if (err < 0) {
-        TRACEF("failed to load elf file\n");
-        goto err;
+        TRACEF("failed to reserve mmap range\n");
+        return err;
+    }
+
+    /* the binary may ask for a bigger or smaller main thread stack */
+    if (img->get_stack_size()) {
+        proc->set_stack_size(img->get_stack_size());
     }
 
     /* the binary loaded properly */
-    ls.entry = ls.elf.entry;
+    ls.entry = img->get_entry();
     ls.loaded = true;
 
-    fs_close_file(handle);
-    vmm_set_active_aspace(NULL);
-
     return NO_ERROR;
-
-err:
-    if (handle) {
-        fs_close_file(handle);
-    }
-    vmm_set_active_aspace(NULL);
-    return err;
 }
 
 status_t lkuser_start_binary(proc *p, bool wait) {
@@ -155,17 +118,368 @@ status_t lkuser_start_binary(proc *p, bool wait) {
     /* we're ready to run now */
     p->start();
 
+    /* keep the process around until we are done waiting on it */
+    if (wait) {
+        p->acquire();
+    }
+
     /* resume */
     LTRACEF("resuming main thread\n");
     t->resume();
 
     if (wait) {
         p->wait();
+        p->release();
+    }
+
+    return NO_ERROR;
+}
+
+status_t lkuser_spawn(const char *path, const char * const *argv, proc **out, proc_template *tmpl) {
+    LTRACEF("path '%s'\n", path);
+
+    proc *p = proc::create();
+    if (!p) {
+        return ERR_NO_MEMORY;
+    }
+    p->set_template(tmpl);
+
+    // page the binary in on demand, most of a launch is otherwise spent
+    // copying pages that may never be touched
+    status_t err = p->set_args(argv);
+    if (err >= 0) {
+        err = lkuser_load_file(p, path, true, LKUSER_HEAP_LIMIT);
+    }
+    if (err >= 0) {
+        p->acquire();
+        err = lkuser_start_binary(p, false);
+        if (err < 0) {
+            p->release();
+        }
+    }
+    if (err < 0) {
+        // never started, mark it dead and let the reaper have it
+        p->exit(err);
+        return err;
     }
 
+    *out = p;
     return NO_ERROR;
 }
 
+status_t lkuser_clone(proc *parent, vaddr_t entry, vaddr_t stack_top, vaddr_t user_tls, proc **out) {
+    LTRACEF("parent %p, entry %#lx, stack %#lx\n", parent, entry, stack_top);
+
+    proc *p;
+    status_t err = proc::clone(parent, &p);
+    if (err < 0) {
+        return err;
+    }
+
+    thread *t = thread::create(p, entry, stack_top, user_tls);
+    if (!t) {
+        p->exit(ERR_NO_MEMORY);
+        return ERR_NO_MEMORY;
+    }
+
+    p->acquire();
+    p->start();
+    t->resume();
+
+    *out = p;
+    return NO_ERROR;
+}
+
+// launch count copies of a binary from several loader threads at once,
+// reporting how long each launch took and how many launches a second we
+// manage overall
+namespace {
+
+struct spawn_bench {
+    const char *path;
+    proc_template *tmpl;
+    uint count;
+    uint next;
+    proc **procs;
+    lk_bigtime_t *latency;
+};
+
+int spawn_bench_worker(void *arg) {
+    auto *b = (spawn_bench *)arg;
+    const char *argv[] = { b->path, nullptr };
+
+    for (;;) {
+        uint i = __atomic_fetch_add(&b->next, 1, __ATOMIC_RELAXED);
+        if (i >= b->count) {
+            break;
+        }
+
+        lk_bigtime_t start = current_time_hires();
+        status_t err;
+        if (b->tmpl) {
+            err = b->tmpl->spawn(&b->procs[i]);
+        } else {
+            err = lkuser_spawn(b->path, argv, &b->procs[i]);
+        }
+        b->latency[i] = current_time_hires() - start;
+        if (err < 0) {
+            printf("error %d spawning %s\n", err, b->path);
+            b->procs[i] = nullptr;
+        }
+    }
+
+    return 0;
+}
+
+int compare_time(const void *a, const void *b) {
+    lk_bigtime_t x = *(const lk_bigtime_t *)a;
+    lk_bigtime_t y = *(const lk_bigtime_t *)b;
+    return (x > y) - (x < y);
+}
+
+} // namespace
+
+static void spawn_benchmark(const char *path, uint count, uint loaders, bool use_template) {
+    if (count == 0) {
+        count = 1;
+    }
+    if (loaders == 0) {
+        loaders = __builtin_popcount(mp_get_online_mask());
+    }
+    loaders = MIN(loaders, count);
+
+    spawn_bench b {};
+    b.path = path;
+    b.count = count;
+    b.procs = new proc *[count];
+    b.latency = new lk_bigtime_t[count];
+    thread_t **workers = new thread_t *[loaders];
+    if (!b.procs || !b.latency || !workers) {
+        printf("error allocating benchmark state\n");
+        delete[] b.procs;
+        delete[] b.latency;
+        delete[] workers;
+        return;
+    }
+
+    // the template is made ahead of time, what we measure is stamping copies
+    if (use_template) {
+        const char *argv[] = { path, nullptr };
+        status_t err = proc_template::create(path, argv, &b.tmpl);
+        if (err < 0) {
+            printf("error %d creating template of %s\n", err, path);
+            delete[] b.procs;
+            delete[] b.latency;
+            delete[] workers;
+            return;
+        }
+    }
+
+    lk_bigtime_t start = current_time_hires();
+    uint started = 0;
+    for (uint i = 0; i < loaders; i++) {
+        workers[i] = thread_create("spawn bench", &spawn_bench_worker, &b, DEFAULT_PRIORITY, DEFAULT_STACK_SIZE);
+        if (workers[i]) {
+            thread_resume(workers[i]);
+            started++;
+        }
+    }
+    for (uint i = 0; i < loaders; i++) {
+        if (workers[i]) {
+            thread_join(workers[i], NULL, INFINITE_TIME);
+        }
+    }
+    lk_bigtime_t launched = current_time_hires() - start;
+
+    uint ok = 0;
+    for (uint i = 0; i < count; i++) {
+        if (b.procs[i]) {
+            b.procs[i]->wait();
+            b.procs[i]->release();
+            ok++;
+        }
+    }
+    lk_bigtime_t finished = current_time_hires() - start;
+
+    qsort(b.latency, count, sizeof(b.latency[0]), &compare_time);
+    printf("%u of %u launched by %u loaders in %llu usec (%llu per sec), all exited after %llu usec\n",
+           ok, count, started, (unsigned long long)launched,
+           launched ? (unsigned long long)ok * 1000000 / launched : 0ULL,
+           (unsigned long long)finished);
+    printf("launch latency usec: p50 %llu p90 %llu p99 %llu max %llu\n",
+           (unsigned long long)b.latency[count * 50 / 100],
+           (unsigned long long)b.latency[count * 90 / 100],
+           (unsigned long long)b.latency[count * 99 / 100],
+           (unsigned long long)b.latency[count - 1]);
+
+    delete b.tmpl;
+    delete[] b.procs;
+    delete[] b.latency;
+    delete[] workers;
+}
+
+// time full spawn and exit cycles of a binary one after another, with the
+// object pools off and then on. a trivial binary leaves mostly the cost of
+// building and tearing down the process itself.
+static void create_benchmark(const char *path, uint count) {
+    if (count == 0) {
+        count = 100;
+    }
+    const char *argv[] = { path, nullptr };
+
+    const bool was_enabled = block_pool::enabled();
+    for (int pass = 0; pass < 2; pass++) {
+        const bool enabled = (pass == 1);
+        block_pool::set_enabled(enabled);
+        if (!enabled) {
+            block_pool::for_every_pool([](block_pool *pool) { pool->flush(); });
+        }
+
+        lk_bigtime_t total = 0;
+        lk_bigtime_t spawn_total = 0;
+        lk_bigtime_t worst = 0;
+        uint ok = 0;
+        for (uint i = 0; i < count; i++) {
+            lk_bigtime_t start = current_time_hires();
+            proc *p;
+            status_t err = lkuser_spawn(path, argv, &p);
+            if (err < 0) {
+                printf("error %d spawning %s\n", err, path);
+                break;
+            }
+            lk_bigtime_t spawned = current_time_hires();
+            p->wait();
+            p->release();
+            lk_bigtime_t elapsed = current_time_hires() - start;
+
+            total += elapsed;
+            spawn_total += spawned - start;
+            worst = MAX(worst, elapsed);
+            ok++;
+
+            // let the reaper hand the pieces back to the pools before the next one
+            thread_yield();
+        }
+
+        printf("pools %s: %u spawn and exit cycles, %llu usec average (%llu to spawn), %llu usec worst\n",
+               enabled ? "on" : "off", ok, ok ? (unsigned long long)(total / ok) : 0ULL,
+               ok ? (unsigned long long)(spawn_total / ok) : 0ULL, (unsigned long long)worst);
+    }
+    block_pool::set_enabled(was_enabled);
+}
+
+// list every process without holding up any of them
+static void dump_procs() {
+    static const char *state_names[] = { "initial", "running", "dead" };
+
+    printf("%6s %6s %-8s %7s %10s %6s\n", "pid", "ppid", "state", "threads", "heap", "exit");
+    for_every_proc([](proc *p) {
+        printf("%6u %6u %-8s %7d %10zu ", p->get_pid(), p->get_parent_pid(),
+               state_names[p->get_state()], p->get_thread_count(), p->get_heap().get_committed());
+        if (p->exited()) {
+            printf("%6d\n", p->get_retcode());
+        } else {
+            printf("%6s\n", "-");
+        }
+    });
+}
+
+// load and run a binary both eagerly and on demand, comparing how long it
+// takes to get going and how much of it ends up resident
+static void load_benchmark(const char *path) {
+    for (int lazy = 0; lazy < 2; lazy++) {
+        proc *p = proc::create();
+        if (!p) {
+            printf("error creating process\n");
+            return;
+        }
+
+        proc::loader_state::exit_report report {};
+        p->get_loader_state().report = &report;
+
+        lk_bigtime_t start = current_time_hires();
+        status_t err = lkuser_load_file(p, path, lazy, LKUSER_HEAP_LIMIT);
+        lk_bigtime_t loaded = current_time_hires();
+        if (err < 0) {
+            printf("error %d loading %s\n", err, path);
+            return;
+        }
+        size_t load_pages = image_resident_pages(p);
+        size_t load_private = image_private_pages(p);
+
+        err = lkuser_start_binary(p, true);
+        if (err < 0) {
+            printf("error %d starting %s\n", err, path);
+            return;
+        }
+
+        printf("%-6s: load %llu usec (%zu pages resident, %zu private), "
+               "load to exit %llu usec (%zu pages resident, %zu private, %zu heap bytes)\n",
+               lazy ? "lazy" : "eager", (unsigned long long)(loaded - start), load_pages, load_private,
+               (unsigned long long)(report.exit_time - start), report.resident_pages, report.private_pages,
+               report.heap_bytes);
+    }
+}
+
+// run a cpu bound binary in 1, 2, 4 ... up to max_procs processes at once,
+// comparing the aggregate throughput against a single process
+static void cpu_benchmark(const char *path, uint max_procs) {
+    if (max_procs == 0) {
+        max_procs = __builtin_popcount(mp_get_online_mask());
+    }
+
+    proc **procs = new proc *[max_procs];
+    if (!procs) {
+        printf("error allocating process array\n");
+        return;
+    }
+
+    lk_bigtime_t single = 0;
+    for (uint n = 1; n <= max_procs; n *= 2) {
+        uint loaded = 0;
+        for (; loaded < n; loaded++) {
+            procs[loaded] = proc::create();
+            if (!procs[loaded]) {
+                printf("error creating process\n");
+                break;
+            }
+            status_t err = lkuser_load_file(procs[loaded], path, false, LKUSER_HEAP_LIMIT);
+            if (err < 0) {
+                printf("error %d loading %s\n", err, path);
+                // never started, mark it dead and let the reaper have it
+                procs[loaded]->exit(err);
+                break;
+            }
+        }
+
+        // start them all together so they overlap as much as possible
+        lk_bigtime_t start = current_time_hires();
+        for (uint i = 0; i < loaded; i++) {
+            procs[i]->acquire();
+            lkuser_start_binary(procs[i], false);
+        }
+        for (uint i = 0; i < loaded; i++) {
+            procs[i]->wait();
+            procs[i]->release();
+        }
+        lk_bigtime_t elapsed = current_time_hires() - start;
+
+        if (loaded < n) {
+            break;
+        }
+
+        if (n == 1) {
+            single = elapsed;
+        }
+        // n copies of the work in the time one took is a speedup of n
+        uint speedup_x100 = elapsed ? (uint)(single * n * 100 / elapsed) : 0;
+        printf("%2u procs: %llu usec, speedup %u.%02u\n", n, (unsigned long long)elapsed,
+               speedup_x100 / 100, speedup_x100 % 100);
+    }
+
+    delete[] procs;
+}
+
 } // namespace lkuser
 
 #if defined(WITH_LIB_CONSOLE)
@@ -178,22 +492,58 @@ static int cmd_lkuser(int argc, const console_cmd_args *argv) {
 notenoughargs:
         printf("not enough arguments:\n");
 usage:
-        printf("%s load <path to binary>\n", argv[0].str);
+        printf("%s load [-l] [-h <heap limit>] [-a <cpu mask>] <path to binary>\n", argv[0].str);
         printf("%s run [&]\n", argv[0].str);
+        printf("%s spawn <path to binary> [-n <count>] [-j <loaders>] [-t]\n", argv[0].str);
+        printf("%s ps\n", argv[0].str);
+        printf("%s kill <pid>\n", argv[0].str);
+        printf("%s pools [on | off | flush]\n", argv[0].str);
+        printf("%s aspace [flush]\n", argv[0].str);
+        printf("%s stats [reset]\n", argv[0].str);
+        printf("%s cache [flush | budget <bytes>]\n", argv[0].str);
+        printf("%s bench console [bytes]\n", argv[0].str);
+        printf("%s bench load <path to binary>\n", argv[0].str);
+        printf("%s bench cpu <path to binary> [max procs]\n", argv[0].str);
+        printf("%s bench create <path to binary> [count]\n", argv[0].str);
         return -1;
     }
 
     static lkuser::proc *proc;
     if (!strcmp(argv[1].str, "load")) {
-        if (argc < 3) {
+        /* -l pages the binary in on demand rather than reading it all up front,
+         * -h sets the limit of the process's heap,
+         * -a restricts the process to the cpus in a mask */
+        bool lazy = false;
+        size_t heap_limit = LKUSER_HEAP_LIMIT;
+        uint32_t affinity = ~0U;
+        int path_arg = 2;
+        for (; path_arg < argc && argv[path_arg].str[0] == '-'; path_arg++) {
+            if (!strcmp(argv[path_arg].str, "-l")) {
+                lazy = true;
+            } else if (!strcmp(argv[path_arg].str, "-h") && path_arg + 1 < argc) {
+                heap_limit = argv[++path_arg].u;
+            } else if (!strcmp(argv[path_arg].str, "-a") && path_arg + 1 < argc) {
+                affinity = argv[++path_arg].u;
+            } else {
+                goto usage;
+            }
+        }
+        if (argc <= path_arg) {
             goto notenoughargs;
         }
         if (!proc) {
             proc = lkuser::proc::create();
         }
-        status_t err;
-        err = lkuser_load_file(proc, argv[2].str);
-        printf("lkuser_load_file() returns %d, entry at %#lx\n", err, proc->get_loader_state().entry);
+        if (proc->set_affinity(0, affinity) < 0) {
+            printf("no online cpus in mask %#x\n", affinity);
+            return -1;
+        }
+        lk_bigtime_t start = current_time_hires();
+        status_t err = lkuser_load_file(proc, argv[path_arg].str, lazy, heap_limit);
+        lk_bigtime_t elapsed = current_time_hires() - start;
+        printf("lkuser_load_file() returns %d, entry at %#lx, %llu usec, %zu pages resident, %zu private\n",
+               err, proc->get_loader_state().entry, (unsigned long long)elapsed, lkuser::image_resident_pages(proc),
+               lkuser::image_private_pages(proc));
     } else if (!strcmp(argv[1].str, "run")) {
         if (!proc) {
             printf("no loaded binary\n");
@@ -208,6 +558,97 @@ usage:
         status_t err = lkuser_start_binary(proc, wait);
         printf("lkuser_start_binary() returns %d\n", err);
         proc = NULL;
+    } else if (!strcmp(argv[1].str, "spawn")) {
+        if (argc < 3) {
+            goto notenoughargs;
+        }
+
+        /* -n launches that many copies, -j from that many loader threads,
+         * -t stamps them out of a template rather than loading each one */
+        uint count = 1;
+        uint loaders = 0;
+        bool use_template = false;
+        for (int i = 3; i < argc; i++) {
+            if (!strcmp(argv[i].str, "-n") && i + 1 < argc) {
+                count = argv[++i].u;
+            } else if (!strcmp(argv[i].str, "-j") && i + 1 < argc) {
+                loaders = argv[++i].u;
+            } else if (!strcmp(argv[i].str, "-t")) {
+                use_template = true;
+            } else {
+                goto usage;
+            }
+        }
+        lkuser::spawn_benchmark(argv[2].str, count, loaders, use_template);
+    } else if (!strcmp(argv[1].str, "ps")) {
+        lkuser::dump_procs();
+    } else if (!strcmp(argv[1].str, "kill")) {
+        if (argc < 3) {
+            goto notenoughargs;
+        }
+        lkuser::proc *p = lkuser::pid_lookup(argv[2].u);
+        if (!p) {
+            printf("no process with pid %lu\n", argv[2].u);
+            return -1;
+        }
+        /* as SIGKILL would */
+        p->kill(LKUSER_KILL_EXIT_BASE + 9);
+        p->release();
+    } else if (!strcmp(argv[1].str, "pools")) {
+        if (argc > 2 && !strcmp(argv[2].str, "on")) {
+            lkuser::block_pool::set_enabled(true);
+        } else if (argc > 2 && !strcmp(argv[2].str, "off")) {
+            lkuser::block_pool::set_enabled(false);
+        }
+        if (argc > 2 && strcmp(argv[2].str, "on")) {
+            lkuser::block_pool::for_every_pool([](lkuser::block_pool *pool) { pool->flush(); });
+        }
+        printf("object pools %s\n", lkuser::block_pool::enabled() ? "on" : "off");
+        lkuser::block_pool::for_every_pool([](lkuser::block_pool *pool) { pool->dump(); });
+    } else if (!strcmp(argv[1].str, "aspace")) {
+        if (argc > 2 && !strcmp(argv[2].str, "flush")) {
+            lkuser::aspace_cache_flush();
+        }
+        lkuser::dump_aspace_cache();
+    } else if (!strcmp(argv[1].str, "stats")) {
+        bool reset = (argc > 2 && !strcmp(argv[2].str, "reset"));
+        lkuser::dump_syscall_stats(reset);
+    } else if (!strcmp(argv[1].str, "cache")) {
+        if (argc > 2 && !strcmp(argv[2].str, "flush")) {
+            lkuser::image_cache_flush();
+        } else if (argc > 2 && !strcmp(argv[2].str, "budget")) {
+            if (argc < 4) {
+                goto notenoughargs;
+            }
+            lkuser::image_cache_set_budget(argv[3].u);
+        }
+        lkuser::dump_image_cache();
+    } else if (!strcmp(argv[1].str, "bench")) {
+        if (argc < 3) {
+            goto notenoughargs;
+        }
+        if (!strcmp(argv[2].str, "console")) {
+            size_t len = (argc > 3) ? argv[3].u : 16384;
+            lkuser::console_benchmark(len);
+        } else if (!strcmp(argv[2].str, "load")) {
+            if (argc < 4) {
+                goto notenoughargs;
+            }
+            lkuser::load_benchmark(argv[3].str);
+        } else if (!strcmp(argv[2].str, "create")) {
+            if (argc < 4) {
+                goto notenoughargs;
+            }
+            lkuser::create_benchmark(argv[3].str, (argc > 4) ? argv[4].u : 0);
+        } else if (!strcmp(argv[2].str, "cpu")) {
+            if (argc < 4) {
+                goto notenoughargs;
+            }
+            lkuser::cpu_benchmark(argv[3].str, (argc > 4) ? argv[4].u : 0);
+        } else {
+            printf("unrecognized benchmark\n");
+            goto usage;
+        }
     } else {
         printf("unrecognized subcommand\n");
         goto usage;